@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <png.h>
+#include "commons.h"
+#include "lanczos.h"
+#include "asciifier.h"
+#include "decoder.h"
+#include "input.h"
+#include "output.h"
+#include "parallel.h"
+
+#define BENCH_MAX_VALUES 16
+#define BENCH_DEFAULT_REPEAT 5
+#define BENCH_DEFAULT_JSON "bench.json"
+
+/*
+ * BenchStage one timed stage of the pipeline.
+ * - name:           Stage name as reported ("decode", "scale", ...).
+ * - size:           Width and height of the synthetic source image.
+ * - scale_factor:   Scale factor of the run, 1 for decode.
+ * - input_pixels:   Pixels read by the stage, used for MPix/s.
+ * - output_cells:   Glyph cells of the rendered frame, used for ns/cell.
+ * - samples:        Wall time of every repetition, in nanoseconds.
+ * - repeat:         Number of samples.
+ */
+typedef struct BenchStage{
+	const char* name;
+	int size, scale_factor;
+	double input_pixels, output_cells;
+	double* samples;
+	int repeat;
+} BenchStage;
+
+/*
+ * Benchmark configuration, set from the command line.
+ */
+static int g_sizes[BENCH_MAX_VALUES] = { 256, 2048, 8192 };
+static int g_size_count = 3;
+static int g_scales[BENCH_MAX_VALUES] = { 2, 4, 8 };
+static int g_scale_count = 3;
+static int g_repeat = BENCH_DEFAULT_REPEAT;
+static int g_threads = 0;
+static LanczosVariant g_variant = LANCZOS_AUTO;
+static Palette g_palette = BRAILLE;
+static const char* g_json_path = BENCH_DEFAULT_JSON;
+
+static const char* variant_names[LANCZOS_VARIANT_COUNT] = { "auto", "scalar", "sse2", "avx2", "fixed" };
+
+/*
+ * now_ns returns the monotonic clock in nanoseconds.
+ */
+static double now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+/*
+ * compare_double orders doubles for qsort.
+ */
+static int compare_double(const void* a, const void* b){
+	double x = *(const double*) a, y = *(const double*) b;
+	return (x > y) - (x < y);
+}
+
+/*
+ * percentile returns the nearest-rank percentile of a sorted sample array.
+ */
+static double percentile(const double* sorted, int count, double rank){
+	int index = (int) (rank * count + 0.999999) - 1;
+	if(index < 0) index = 0;
+	if(index >= count) index = count - 1;
+	return sorted[index];
+}
+
+/*
+ * synthetic_image fills a deterministic RGBA test image.
+ * - size: Width and height in pixels.
+ *
+ * Smooth gradients with concentric rings and a fixed xorshift noise: exercises every
+ * luminance level and compresses like a photograph rather than a flat logo.
+ *
+ * Returns: A newly allocated image, or NULL on allocation failure.
+ */
+static Pixel* synthetic_image(int size){
+	Pixel* image = (Pixel*) malloc(sizeof(Pixel) * (size_t) size * size);
+	uint32_t state = 0x9E3779B9u;
+
+	if(!image) return NULL;
+
+	for(int y = 0; y < size; y++){
+		for(int x = 0; x < size; x++){
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+
+			int dx = x - size / 2, dy = y - size / 2;
+			int ring = (int) (((int64_t) dx * dx + (int64_t) dy * dy) * 64 / ((int64_t) size * size / 4 + 1));
+			Pixel* pixel = image + (size_t) y * size + x;
+
+			pixel->red	= (uint8_t) ((x * 255) / size + (state & 7));
+			pixel->green	= (uint8_t) ((y * 255) / size + ((state >> 3) & 7));
+			pixel->blue	= (uint8_t) ((ring & 1) ? 230 : 25);
+			pixel->alpha	= (uint8_t) (255 - ((state >> 8) & 15));
+		}
+	}
+
+	return image;
+}
+
+/*
+ * write_png encodes an RGBA image to a PNG file.
+ *
+ * Returns: false on failure.
+ */
+static bool write_png(const char* path, const Pixel* image, int size){
+	FILE* file_ptr = fopen(path, "wb");
+	if(!file_ptr) return false;
+
+	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+
+	if(!png_ptr || !info_ptr || setjmp(png_jmpbuf(png_ptr))){
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		fclose(file_ptr);
+		return false;
+	}
+
+	png_init_io(png_ptr, file_ptr);
+	png_set_compression_level(png_ptr, 3);
+	png_set_IHDR(png_ptr, info_ptr, size, size, 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
+		PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png_ptr, info_ptr);
+	for(int row = 0; row < size; row++) png_write_row(png_ptr, (png_const_bytep) (image + (size_t) row * size));
+	png_write_end(png_ptr, NULL);
+
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	return fclose(file_ptr) == 0;
+}
+
+/*
+ * stage_report prints one stage to stdout and appends it to the JSON report.
+ */
+static void stage_report(BenchStage* stage, FILE* json, bool* first){
+	qsort(stage->samples, stage->repeat, sizeof(double), compare_double);
+
+	double median	= percentile(stage->samples, stage->repeat, 0.5);
+	double p95	= percentile(stage->samples, stage->repeat, 0.95);
+	double mpix	= stage->input_pixels / (median / 1e9) / 1e6;
+	double per_cell	= median / stage->output_cells;
+
+	printf("%6d  %5d  %-8s %12.3f %12.3f %10.1f %10.2f\n", stage->size, stage->scale_factor, stage->name,
+		median / 1e6, p95 / 1e6, mpix, per_cell);
+
+	if(!json) return;
+	fprintf(json, "%s\n    {\"size\": %d, \"scale\": %d, \"stage\": \"%s\", \"median_ms\": %.4f, \"p95_ms\": %.4f, "
+		"\"mpix_per_s\": %.3f, \"ns_per_cell\": %.4f, \"input_pixels\": %.0f, \"output_cells\": %.0f}",
+		*first ? "" : ",", stage->size, stage->scale_factor, stage->name, median / 1e6, p95 / 1e6, mpix, per_cell,
+		stage->input_pixels, stage->output_cells);
+	*first = false;
+}
+
+/*
+ * parse_list parses a comma separated list of positive integers.
+ *
+ * Returns: The number of values, or 0 if the list is invalid.
+ */
+static int parse_list(const char* text, int* values){
+	int count = 0;
+	char* endptr;
+
+	while(count < BENCH_MAX_VALUES){
+		long value = strtol(text, &endptr, 10);
+		if(endptr == text || value < 1 || value > 65535) return 0;
+		values[count++] = (int) value;
+		if(*endptr == '\0') return count;
+		if(*endptr != ',') return 0;
+		text = endptr + 1;
+	}
+	return 0;
+}
+
+/*
+ * args_parser parses the benchmark options, exiting on invalid input.
+ *  - "--sizes": comma separated square image sizes (default 256,2048,8192).
+ *  - "--scales": comma separated scale factors (default 2,4,8).
+ *  - "-r" / "--repeat": repetitions per stage (default 5).
+ *  - "-j" / "--threads": worker threads (default: online CPUs).
+ *  - "--simd": scaler implementation ('auto', 'scalar', 'sse2', 'avx2', 'fixed').
+ *  - "--json": path of the JSON report (default bench.json, "-" disables it).
+ */
+static void args_parser(int argc, char* argv[]){
+	for(int i = 1; i < argc; i++){
+		char* arg = argv[i];
+
+		if(i + 1 >= argc){
+			fprintf(stderr, "Unknown option or missing value: %s\n", arg);
+			exit(EXIT_FAILURE);
+		}
+
+		char* value = argv[++i];
+		char* endptr;
+
+		if(strcmp(arg, "--sizes") == 0){
+			g_size_count = parse_list(value, g_sizes);
+			if(!g_size_count){
+				fprintf(stderr, "Invalid size list %s\n", value);
+				exit(EXIT_FAILURE);
+			}
+		}else if(strcmp(arg, "--scales") == 0){
+			g_scale_count = parse_list(value, g_scales);
+			if(!g_scale_count){
+				fprintf(stderr, "Invalid scale list %s\n", value);
+				exit(EXIT_FAILURE);
+			}
+		}else if(strcmp(arg, "-r") == 0 || strcmp(arg, "--repeat") == 0){
+			g_repeat = (int) strtol(value, &endptr, 10);
+			if(*endptr != '\0' || g_repeat < 1 || g_repeat > 10000){
+				fprintf(stderr, "Invalid repeat count %s\n", value);
+				exit(EXIT_FAILURE);
+			}
+		}else if(strcmp(arg, "-j") == 0 || strcmp(arg, "--threads") == 0){
+			g_threads = (int) strtol(value, &endptr, 10);
+			if(*endptr != '\0' || g_threads < 1 || g_threads > 1024){
+				fprintf(stderr, "Invalid thread count %s\n", value);
+				exit(EXIT_FAILURE);
+			}
+		}else if(strcmp(arg, "--simd") == 0){
+			if(strcmp(value, "auto") == 0) g_variant = LANCZOS_AUTO;
+			else if(strcmp(value, "scalar") == 0) g_variant = LANCZOS_SCALAR;
+			else if(strcmp(value, "sse2") == 0) g_variant = LANCZOS_SSE2;
+			else if(strcmp(value, "avx2") == 0) g_variant = LANCZOS_AVX2;
+			else if(strcmp(value, "fixed") == 0) g_variant = LANCZOS_FIXED;
+			else{
+				fprintf(stderr, "Unknown SIMD variant: %s\n", value);
+				exit(EXIT_FAILURE);
+			}
+		}else if(strcmp(arg, "--json") == 0){
+			g_json_path = strcmp(value, "-") == 0 ? NULL : value;
+		}else{
+			fprintf(stderr, "Unknown option: %s\n", arg);
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/*
+ * bench_size runs every stage on one synthetic image size.
+ *
+ * Stages are timed separately on the same input, so each one can be compared
+ * across commits on its own:
+ *  - decode:   decode_png of the encoded synthetic image.
+ *  - scale:    lanczos_scale to the scaled RGBA image.
+ *  - asciify:  asciify_image of the scaled image.
+ *  - output:   UTF-8 encoding and write() of the glyphs to /dev/null.
+ *  - fused:    asciify_scaled, the scale + asciify path the CLI actually runs.
+ *
+ * Returns: false on failure.
+ */
+static bool bench_size(int size, const char* directory, FILE* json, bool* first){
+	char path[4096];
+	double* samples = (double*) malloc(sizeof(double) * g_repeat);
+	Pixel* pixels = synthetic_image(size);
+	bool success = false;
+
+	snprintf(path, sizeof(path), "%s/yascii-bench-%d.png", directory, size);
+	if(!samples || !pixels || !write_png(path, pixels, size)){
+		fprintf(stderr, "Cannot prepare the %dx%d synthetic image\n", size, size);
+		free(samples);
+		free(pixels);
+		return false;
+	}
+	free(pixels);
+
+	AsciiImageObject* image = NULL;
+	BenchStage stage = { "decode", size, 1, (double) size * size, (double) size * size, samples, g_repeat };
+
+	for(int run = 0; run < g_repeat; run++){
+		image_struct_free(image);
+		double start = now_ns();
+		image = decode_png(path);
+		samples[run] = now_ns() - start;
+		if(!image) goto done;
+	}
+	stage_report(&stage, json, first);
+
+	OutputBuffer output;
+	if(!output_open(&output, open("/dev/null", O_WRONLY), OUTPUT_BUFFER_SIZE)) goto done;
+	if(output.fd < 0){
+		output_close(&output);
+		goto done;
+	}
+
+	for(int s = 0; s < g_scale_count; s++){
+		int factor	= g_scales[s];
+		int height	= size / factor;
+		int width	= size / factor;
+		double cells	= (double) height * width;
+		Pixel* scaled	= NULL;
+		wchar_t* ascii	= NULL;
+
+		if(cells <= 0) continue;
+
+		stage = (BenchStage) { "scale", size, factor, (double) size * size, cells, samples, g_repeat };
+		for(int run = 0; run < g_repeat; run++){
+			free(scaled);
+			double start = now_ns();
+			scaled = lanczos_scale(image, factor, g_threads, g_variant);
+			samples[run] = now_ns() - start;
+		}
+		stage_report(&stage, json, first);
+
+		stage = (BenchStage) { "asciify", size, factor, cells, cells, samples, g_repeat };
+		for(int run = 0; scaled && run < g_repeat; run++){
+			free(ascii);
+			double start = now_ns();
+			ascii = asciify_image(scaled, height, width, g_palette, g_threads);
+			samples[run] = now_ns() - start;
+		}
+		if(ascii) stage_report(&stage, json, first);
+
+		stage = (BenchStage) { "output", size, factor, cells, cells, samples, g_repeat };
+		for(int run = 0; ascii && run < g_repeat; run++){
+			double start = now_ns();
+			output_glyph_rows(&output, ascii, height, width);
+			output_flush(&output);
+			samples[run] = now_ns() - start;
+		}
+		if(ascii) stage_report(&stage, json, first);
+
+		stage = (BenchStage) { "fused", size, factor, (double) size * size, cells, samples, g_repeat };
+		for(int run = 0; run < g_repeat; run++){
+			free(ascii);
+			double start = now_ns();
+			ascii = asciify_scaled(image, factor, g_palette, g_threads, g_variant);
+			samples[run] = now_ns() - start;
+		}
+		if(ascii) stage_report(&stage, json, first);
+
+		free(scaled);
+		free(ascii);
+	}
+
+	output_close(&output);
+	close(output.fd);
+	success = true;
+
+done:
+	if(!success) fprintf(stderr, "Benchmark of the %dx%d image failed\n", size, size);
+	image_struct_free(image);
+	unlink(path);
+	free(samples);
+	return success;
+}
+
+int main(int argc, char* argv[]){
+	args_parser(argc, argv);
+	if(g_threads == 0) g_threads = online_cpu_count();
+
+	const char* directory = getenv("TMPDIR");
+	if(!directory || !*directory) directory = "/tmp";
+
+	FILE* json = NULL;
+	if(g_json_path){
+		json = fopen(g_json_path, "w");
+		if(!json){
+			perror(g_json_path);
+			return EXIT_FAILURE;
+		}
+		fprintf(json, "{\n  \"threads\": %d,\n  \"simd\": \"%s\",\n  \"repeat\": %d,\n  \"results\": [",
+			g_threads, variant_names[lanczos_resolve_variant(g_variant)], g_repeat);
+	}
+
+	printf("%6s  %5s  %-8s %12s %12s %10s %10s\n", "size", "scale", "stage", "median ms", "p95 ms", "MPix/s", "ns/cell");
+
+	bool first = true, success = true;
+	for(int i = 0; i < g_size_count; i++) success &= bench_size(g_sizes[i], directory, json, &first);
+
+	if(json){
+		fprintf(json, "\n  ]\n}\n");
+		fclose(json);
+	}
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Alignment of every arena allocation: a cache line, enough for any SIMD load.
+ */
+#define ARENA_ALIGNMENT 64
+
+/*
+ * Smallest block an Arena allocates.
+ */
+#define ARENA_BLOCK_SIZE ((size_t) 1 << 20)
+
+/*
+ * Largest reservation arena_reset keeps: the memory of a bigger image is given back.
+ */
+#define ARENA_RETAIN_LIMIT ((size_t) 64 << 20)
+
+/*
+ * arena_reset shrinks an Arena reserving more than this many times what the last image used.
+ */
+#define ARENA_TRIM_FACTOR 4
+
+/*
+ * Arena bump allocator for the buffers of one render, reused from image to image.
+ * -blocks:      Blocks allocated so far, the one being carved first.
+ * -reserved:    Total capacity of blocks, in bytes.
+ *
+ * Allocations are never freed one by one: arena_reset drops them all at once and keeps
+ * the memory, so a batch or a daemon connection renders image after image without a
+ * malloc/free pair per buffer and without faulting the pages of fresh large buffers in
+ * again. What it keeps is trimmed to the last image (see arena_reset), so a single huge
+ * image does not stay pinned. An Arena is not thread-safe: use one per worker.
+ */
+typedef struct Arena{
+	struct ArenaBlock* blocks;
+	size_t reserved;
+} Arena;
+
+/*
+ * arena_init prepares an empty Arena; nothing is allocated until the first arena_alloc.
+ */
+void arena_init(Arena* arena);
+
+/*
+ * arena_alloc carves a buffer out of an Arena.
+ * - arena:  Arena to carve from, or NULL to malloc the buffer instead.
+ * - size:   Size in bytes; 0 is accepted.
+ *
+ * Returns: An ARENA_ALIGNMENT aligned buffer valid until arena_reset (or arena_free when
+ *          arena is NULL), or NULL on allocation failure.
+ */
+void* arena_alloc(Arena* arena, size_t size);
+
+/*
+ * arena_free releases a buffer returned by arena_alloc with the same arena.
+ *
+ * A no-op for an Arena, whose buffers go away at arena_reset; free() when arena is NULL.
+ */
+void arena_free(Arena* arena, void* buffer);
+
+/*
+ * arena_reset discards every allocation of an Arena and keeps its memory for the next image.
+ *
+ * The memory is released when the last image needed more than ARENA_RETAIN_LIMIT, and
+ * shrunk to what it used when the arena reserves ARENA_TRIM_FACTOR times more.
+ */
+void arena_reset(Arena* arena);
+
+/*
+ * arena_release frees all the memory of an Arena, which is left empty and reusable.
+ */
+void arena_release(Arena* arena);
+
+#endif
@@ -18,8 +18,12 @@
 #ifndef ASCIIFIER_H
 #define ASCIIFIER_H
 
+#include <stdint.h>
 #include <wchar.h>
+#include <stdbool.h>
 #include "commons.h"
+#include "lanczos.h"
+#include "arena.h"
 
 /*
  * Conversion constants for greyscale calculation (Rec. 709 luminance weights).
@@ -33,6 +37,66 @@
 #define GREEN_CONVERSION_CONSTANT 	0.7152
 #define BLUE_CONVERSION_CONSTANT 	0.0722
 
+/*
+ * Fixed point luminance used by the glyph lookup tables.
+ *
+ * LUMA_BITS:         Luminance 1.0 is represented as 1 << LUMA_BITS.
+ * LUMA_LEVEL_SHIFT:  Low bits dropped to index the per-palette level table.
+ * LUMA_LEVELS:       Number of entries of the level table (one extra for exact 1.0).
+ */
+#define LUMA_BITS		24
+#define LUMA_LEVEL_SHIFT	12
+#define LUMA_LEVELS		((1 << (LUMA_BITS - LUMA_LEVEL_SHIFT)) + 1)
+
+/*
+ * GlyphMap precomputed integer mapping from a pixel to a palette glyph.
+ * -luma:            Per channel luminance contribution of each 8-bit value, in LUMA_BITS fixed point.
+ * -level_glyph:     Glyph of each luminance level, or 0 when the level straddles a palette boundary.
+ * -palette_string:  Glyphs of the palette.
+ * -palette_size:    Number of glyphs in the palette.
+ *
+ * The three table entries add up to the luminance with at most 1.5 units of rounding
+ * error, so a level is only marked ambiguous when a boundary of the double precision
+ * mapping falls inside it (plus that margin). Those rare pixels go through
+ * glyph_reference, which makes the table path produce exactly the same glyphs.
+ */
+typedef struct GlyphMap{
+	uint32_t luma[3][256];
+	wchar_t level_glyph[LUMA_LEVELS];
+	const wchar_t* palette_string;
+	int palette_size;
+} GlyphMap;
+
+/*
+ * glyph_map returns the lookup tables of a palette.
+ * -palette:  Palette enum value.
+ *
+ * Tables of every palette are built once, on first use, and are safe to share between threads.
+ */
+const GlyphMap* glyph_map(Palette palette);
+
+/*
+ * glyph_reference maps a pixel to a glyph with the double precision luminance formula.
+ * -map:    Lookup tables of the palette.
+ * -pixel:  Pixel to map.
+ */
+wchar_t glyph_reference(const GlyphMap* map, Pixel pixel);
+
+/*
+ * glyph_lookup maps a pixel to a glyph with three table loads, two adds and a shift.
+ * -map:    Lookup tables of the palette.
+ * -pixel:  Pixel to map.
+ *
+ * Returns the same glyph as glyph_reference.
+ */
+static inline wchar_t glyph_lookup(const GlyphMap* map, Pixel pixel){
+	uint32_t luma = map->luma[0][pixel.red] + map->luma[1][pixel.green] + map->luma[2][pixel.blue];
+	uint32_t level = luma >> LUMA_LEVEL_SHIFT;
+	wchar_t glyph = map->level_glyph[level < LUMA_LEVELS ? level : LUMA_LEVELS - 1];
+
+	return glyph ? glyph : glyph_reference(map, pixel);
+}
+
 /*
 * ascii_palettes array of wide-character strings representing symbol sets
  *                used to map greyscale values to ASCII art.
@@ -46,12 +110,26 @@
  */
 extern const wchar_t* ascii_palettes[]; 
 
+/*
+ * asciify_into converts an image to an ASCII representation into a caller-provided buffer.
+ * -image:    Pointer to the array of pixels (input image data).
+ * -height:   Number of rows in the image.
+ * -width:    Number of columns in the image.
+ * -palette:  Palette enum value specifying which character set to use for mapping.
+ * -output:   Destination buffer of at least height * width wchar_t.
+ * -threads:  Number of worker threads the rows are split across.
+ *
+ * Same mapping as asciify_image, without allocating.
+ */
+void asciify_into(const Pixel* image, int height, int width, Palette palette, wchar_t* output, int threads);
+
 /*
  * asciify_image converts an image to an ASCII representation using a given palette.
  * -image:    Pointer to the array of pixels (input image data).
  * -height:   Number of rows in the image.
  * -width:    Number of columns in the image.
  * -palette:  Palette enum value specifying which character set to use for mapping.
+ * -threads:  Number of worker threads the rows are split across.
  *
  * This function maps each pixel's greyscale value to a corresponding
  * character from the selected wide-character palette in 'ascii_palettes'.
@@ -59,6 +137,119 @@ extern const wchar_t* ascii_palettes[];
  *
  * Returns: Pointer to a newly allocated buffer on success, or NULL on failure.
  *          The caller is responsible for freeing the returned buffer.
- */wchar_t* asciify_image(Pixel* image, int height, int width, Palette palette);
+ */
+wchar_t* asciify_image(Pixel* image, int height, int width, Palette palette, int threads);
+
+/*
+ * asciify_scaled_into downscales an image and converts it to ASCII into a caller-provided buffer.
+ * -sample:        Source image; only original_image is read.
+ * -scale_factor:  Integer factor by which the image will be downscaled.
+ * -palette:       Palette enum value specifying which character set to use for mapping.
+ * -output:        Destination of at least (height / scale_factor) * (width / scale_factor) wchar_t.
+ * -threads:       Number of worker threads the rows are split across.
+ * -variant:       Scaler implementation to use.
+ *
+ * Same fused pass as asciify_scaled, without allocating the glyph buffer.
+ *
+ * Returns: true on success, false on memory allocation failure.
+ */
+bool asciify_scaled_into(AsciiImageObject* sample, int scale_factor, Palette palette, wchar_t* output, int threads, LanczosVariant variant);
+
+/*
+ * asciify_scaled downscales an image and converts it to ASCII in a single fused pass.
+ * -sample:        Source image; only original_image is read.
+ * -scale_factor:  Integer factor by which the image will be downscaled.
+ * -palette:       Palette enum value specifying which character set to use for mapping.
+ * -threads:       Number of worker threads the rows are split across.
+ * -variant:       Scaler implementation to use.
+ *
+ * Equivalent to asciify_image(lanczos_scale(...)), but every scaled row is turned into
+ * glyphs while it is still in cache: the scaled RGBA image is never allocated and the
+ * second pass over it disappears. Use the unfused functions when the scaled pixels are
+ * needed themselves.
+ *
+ * Returns: Pointer to a newly allocated buffer of (height / scale_factor) * (width / scale_factor)
+ *          glyphs on success, or NULL on failure. The caller is responsible for freeing it.
+ */
+wchar_t* asciify_scaled(AsciiImageObject* sample, int scale_factor, Palette palette, int threads, LanczosVariant variant);
+
+/*
+ * resample_size returns the output size along one axis for a possibly fractional scale.
+ */
+static inline int resample_size(int size, double scale){
+	return (int) (size / scale);
+}
+
+/*
+ * resample_resolve_filter maps RESAMPLE_AUTO to the filter used for a scale factor.
+ */
+ResampleFilter resample_resolve_filter(ResampleFilter filter, double scale);
+
+/*
+ * asciify_resampled_into downscales an image by any factor and converts it to ASCII into caller-provided buffers.
+ * -sample:    Source image; its pyramid is extended if a missing level is needed.
+ * -scale:     Downscale factor, at least 1; may be fractional.
+ * -palette:   Palette enum value specifying which character set to use for mapping.
+ * -output:    Destination of resample_size(height, scale) * resample_size(width, scale) glyphs.
+ * -colors:    Optional destination of one scaled pixel per glyph, or NULL.
+ * -threads:   Number of worker threads the rows are split across.
+ * -variant:   Lanczos implementation to use.
+ * -filter:    Resampling filter, RESAMPLE_AUTO picks one from the scale.
+ * -pyramid:   Resample Lanczos from the nearest pyramid level instead of original_image.
+ *
+ * With an integer scale, the Lanczos filter and no pyramid the glyphs are exactly
+ * those of asciify_scaled.
+ *
+ * Returns: true on success, false on memory allocation failure.
+ */
+bool asciify_resampled_into(AsciiImageObject* sample, double scale, Palette palette, wchar_t* output, Pixel* colors,
+		int threads, LanczosVariant variant, ResampleFilter filter, bool pyramid);
+
+/*
+ * asciify_shapes_into downscales an image and picks every glyph by the shape of its cell.
+ * -sample:    Source image; its pyramid is extended if a missing level is needed.
+ * -scale:     Downscale factor, at least 1; may be fractional.
+ * -palette:   Palette enum value specifying which character set to use for mapping.
+ * -output:    Destination of resample_size(height, scale) * resample_size(width, scale) glyphs.
+ * -colors:    Optional destination of the mean colour of every cell, or NULL.
+ * -threads, variant, filter, pyramid: As in asciify_resampled_into.
+ * -arena:     Arena the sub-cell grid is carved from, or NULL for the heap.
+ *
+ * Returns: true on success, false on memory allocation failure.
+ */
+bool asciify_shapes_into(AsciiImageObject* sample, double scale, Palette palette, wchar_t* output, Pixel* colors,
+		int threads, LanczosVariant variant, ResampleFilter filter, bool pyramid, Arena* arena);
+
+/*
+ * Braille dot mode geometry: every cell is a 2x4 block of dots.
+ */
+#define DOTS_CELL_WIDTH		2
+#define DOTS_CELL_HEIGHT	4
+
+/*
+ * dots_cells returns the number of cells covering a number of dots along one axis.
+ */
+static inline int dots_cells(int dots, int cell_size){
+	return (dots + cell_size - 1) / cell_size;
+}
+
+/*
+ * asciify_dots downscales an image and converts it to Braille dot patterns, 2x4 pixels per cell.
+ * -sample:     Source image; its pyramid is extended if a missing level is needed.
+ * -scale:      Downscale factor of the dot grid, at least 1; may be fractional.
+ * -threads:    Number of worker threads the rows are split across.
+ * -variant:    Lanczos implementation to use.
+ * -filter:     Resampling filter, RESAMPLE_AUTO picks one from the scale.
+ * -pyramid:    Resample Lanczos from the nearest pyramid level instead of original_image.
+ * -threshold:  8-bit luminance below which a dot is raised, like the dark end of the BRAILLE palette.
+ * -colors:     Optional destination of the mean colour of every cell, or NULL.
+ * -arena:      Arena the masks and the dot rows are carved from, or NULL for the heap.
+ *
+ * Returns: Pointer to a newly allocated buffer of dots_cells(height, DOTS_CELL_HEIGHT) *
+ *          dots_cells(width, DOTS_CELL_WIDTH) masks, bit k set for Braille dot k + 1,
+ *          or NULL on failure. Release it with arena_free(arena, masks).
+ */
+uint8_t* asciify_dots(AsciiImageObject* sample, double scale, int threads, LanczosVariant variant,
+		ResampleFilter filter, bool pyramid, int threshold, Pixel* colors, Arena* arena);
 
-#endif 
+#endif
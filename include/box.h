@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOX_H
+#define BOX_H
+
+#include <stdbool.h>
+#include "commons.h"
+#include "lanczos.h"
+
+/*
+ * Scale factor from which RESAMPLE_AUTO switches from Lanczos to the box filter.
+ * Past this point the fixed 5x5 Lanczos footprint reads less than 1/2.5 of each
+ * cell's source pixels and starts to alias.
+ */
+#define BOX_AUTO_SCALE 8.0
+
+/*
+ * box_resize_rows downscales an image by area averaging, row by row like lanczos_scale_rows.
+ * - sample:    Pointer to an AsciiImageObject containing the original image data.
+ * - width:     Number of output columns, between 1 and sample->width.
+ * - height:    Number of output rows, between 1 and sample->height.
+ * - threads:   Number of worker threads the output rows are split across.
+ * - sink:      Callback receiving each output row as soon as it is computed.
+ * - context:   Opaque pointer forwarded to sink.
+ *
+ * Returns: true on success, false on allocation failure.
+ */
+bool box_resize_rows(AsciiImageObject* sample, int width, int height, int threads, LanczosRowSink sink, void* context);
+
+/*
+ * box_resize downscales an image by area averaging.
+ * - sample, width, height, threads: As in box_resize_rows.
+ *
+ * Returns: A newly allocated width * height image, or NULL on allocation failure.
+ */
+Pixel* box_resize(AsciiImageObject* sample, int width, int height, int threads);
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "output.h"
+
+#define CACHE_DIRECTORY_NAME "yascii"
+#define CACHE_DEFAULT_MAX_SIZE ((uint64_t) 64 << 20)
+
+/*
+ * cache_default_dir returns the default render cache directory.
+ *
+ * $XDG_CACHE_HOME/yascii, or $HOME/.cache/yascii when XDG_CACHE_HOME is unset or empty.
+ *
+ * Returns: A newly allocated path, or NULL if neither variable is set or on allocation failure.
+ */
+char* cache_default_dir(void);
+
+/*
+ * cache_hash computes a 64-bit multiply-xorshift hash over a memory block.
+ * - seed:    Previous hash value, chaining several blocks into one key.
+ * - bytes:   Data to hash.
+ * - length:  Number of bytes.
+ *
+ * Returns: The updated hash.
+ */
+uint64_t cache_hash(uint64_t seed, const void* bytes, size_t length);
+
+/*
+ * cache_key computes the render cache key of an input file.
+ * - input_path:   Path of the input image.
+ * - parameters:   Every rendering parameter that changes the output.
+ * - size:         Size of parameters in bytes.
+ * - key:          Receives the key.
+ *
+ * Returns: false if the file cannot be read.
+ */
+bool cache_key(const char* input_path, const void* parameters, size_t size, uint64_t* key);
+
+/*
+ * cache_entry_path builds <directory>/<key as 16 hex digits>.txt
+ *
+ * Returns: A newly allocated string, or NULL on allocation failure.
+ */
+char* cache_entry_path(const char* directory, uint64_t key);
+
+/*
+ * cache_send writes a cache entry to an OutputBuffer.
+ * - entry_path:  Path of the cache entry.
+ * - out:         Destination buffer.
+ *
+ * Returns: false if the entry does not exist (a cache miss) or cannot be mapped.
+ */
+bool cache_send(const char* entry_path, OutputBuffer* out);
+
+/*
+ * cache_create opens a new temporary file inside the cache directory, creating the directory if needed.
+ * - directory:   Cache directory.
+ * - temp_path:   Receives the newly allocated path of the temporary file.
+ *
+ * Returns: The file descriptor, or -1 on failure.
+ */
+int cache_create(const char* directory, char** temp_path);
+
+/*
+ * cache_commit atomically publishes a fully written temporary file as a cache entry.
+ *
+ * Returns: false if the rename failed; the temporary file is removed either way.
+ */
+bool cache_commit(char* temp_path, const char* entry_path);
+
+/*
+ * cache_touch marks a cache entry as just used, so pruning removes it last.
+ */
+void cache_touch(const char* entry_path);
+
+/*
+ * cache_prune removes the least recently used entries until the cache fits a size budget.
+ * - directory:   Cache directory.
+ * - max_size:    Budget, in bytes, for every entry together.
+ */
+void cache_prune(const char* directory, uint64_t max_size);
+
+#endif
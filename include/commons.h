@@ -19,10 +19,17 @@
 #define COMMONS_H
 
 #include<stdint.h>
+#include <stdbool.h>
 #include <wchar.h>
 
 #define PNG_HEADER_SIZE 8
 
+/*
+ * Program version. Part of the render cache key: bump it whenever the rendered output
+ * of an unchanged image and option set changes.
+ */
+#define YASCII_VERSION "0.2.0"
+
 /**
  * struct Pixel Represents a single pixel with RGBA color components.
  * - red:   Red component (0–255).
@@ -39,6 +46,16 @@ typedef struct Pixel{
 	uint8_t alpha;
 } Pixel;
 
+/*
+ * PyramidLevel one level of an image pyramid.
+ * -height, width:  Level size in pixels.
+ * -pixels:         Level pixel data (RGBA), row-major.
+ */
+typedef struct PyramidLevel{
+	int height, width;
+	Pixel* pixels;
+} PyramidLevel;
+
 /*
  * AsciiImageObject represents an image and its ASCII conversion state.
  * -height:          Image height in pixels.
@@ -47,6 +64,12 @@ typedef struct Pixel{
  * -original_image:  Pointer to the original pixel data (RGBA).
  * -edited_image:    Pointer to the last version of the modified image.
  * -ascii_image:     Pointer to the ASCII art representation (wchar_t array).
+ * -pyramid:         Successive 2x reductions of original_image, built lazily; pyramid[k] is 1/2^(k+1) of it.
+ * -pyramid_levels:  Number of levels built so far.
+ * -mapping:         Read-only mmap of the input file that original_image points into, or NULL
+ *                   when original_image is a heap buffer (see mapped_input_image).
+ * -mapping_size:    Size of mapping in bytes.
+ * -borrowed:        original_image was carved from an Arena and is not freed with the image.
  *
  * This struct encapsulates both the source image and any derived
  * representations, enabling the program to keep original and transformed
@@ -58,6 +81,11 @@ typedef struct AsciiImageObject{
 	Pixel* original_image;
 	Pixel* edited_image;
 	wchar_t* ascii_image;
+	PyramidLevel* pyramid;
+	int pyramid_levels;
+	void* mapping;
+	size_t mapping_size;
+	bool borrowed;
 } AsciiImageObject;
 
 /*
@@ -80,5 +108,20 @@ typedef enum {
 	PALETTE_COUNT
 } Palette;
 
+/*
+ * ResampleFilter - Downscaling filters selectable with --filter.
+ *
+ * -RESAMPLE_LANCZOS: Separable 5-tap Lanczos around one source point per cell (default).
+ * -RESAMPLE_BOX:     Mean of every source pixel of the cell, from a summed-area table.
+ * -RESAMPLE_AUTO:    Lanczos for small scale factors, box from BOX_AUTO_SCALE on.
+ * -RESAMPLE_FILTER_COUNT: Total number of entries; not a filter itself.
+ */
+typedef enum {
+	RESAMPLE_LANCZOS,
+	RESAMPLE_BOX,
+	RESAMPLE_AUTO,
+	RESAMPLE_FILTER_COUNT
+} ResampleFilter;
+
 
 #endif 
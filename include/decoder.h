@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <stdio.h>
+#include <png.h>
+#include "commons.h"
+#include "arena.h"
+
+/*
+ * png_normalize_rgba registers the libpng transformations that turn any PNG into 8-bit RGBA.
+ * - png_ptr:    A pointer to the libpng read struct.
+ * - info_ptr:   A pointer to the libpng info struct, already filled by png_read_info.
+ *
+ * Returns: The number of passes png_read_row must be called for (1, or 7 for Adam7).
+ */
+int png_normalize_rgba(png_structp png_ptr, png_infop info_ptr);
+
+/*
+ * image_struct_free releases an AsciiImageObject and every buffer it owns.
+ * - image: Object to release; NULL is accepted.
+ */
+void image_struct_free(AsciiImageObject* image);
+
+/*
+ * image_struct_alloc allocates an AsciiImageObject and its RGBA buffer.
+ * - width:      The width of the image in pixels.
+ * - height:     The height of the image in pixels.
+ * - arena:      Arena the RGBA buffer is carved from, or NULL for the heap.
+ *
+ * Returns: A pointer to the new object, or NULL on memory allocation failure.
+ */
+AsciiImageObject* image_struct_alloc(int width, int height, Arena* arena);
+
+/*
+ *image_struct_init fills an AsciiImageObject with PNG image data.
+ * - image:      Object returned by image_struct_alloc with the PNG dimensions.
+ * - png_ptr:    A pointer to the libpng read struct, after png_read_info.
+ * - info_ptr:   A pointer to the libpng info struct.
+ *
+ * libpng errors longjmp out of this function: the caller owns image and must release it.
+ */
+void image_struct_init(AsciiImageObject* image, png_structp png_ptr, png_infop info_ptr);
+
+/*
+ * png_adam7_reduction returns the Adam7 lattice an interlaced PNG can be decoded on for a scale factor.
+ * - png_ptr:    A pointer to the libpng read struct, after png_read_info.
+ * - info_ptr:   A pointer to the libpng info struct.
+ * - scale:      Downscale factor the image will be rendered at.
+ *
+ * Returns: 8, 4 or 2 (one pixel every that many along each axis), or 1 if the whole
+ *          image must be decoded: not interlaced, or a scale below 4.
+ */
+int png_adam7_reduction(png_structp png_ptr, png_infop info_ptr, double scale);
+
+/*
+ * image_struct_init_passes fills an AsciiImageObject with one Adam7 lattice of an interlaced PNG.
+ * - image:      Object returned by image_struct_alloc with the lattice size, ceil(width / reduction)
+ *               by ceil(height / reduction) of the PNG size.
+ * - png_ptr:    A pointer to the libpng read struct, after png_read_info.
+ * - info_ptr:   A pointer to the libpng info struct.
+ * - reduction:  Lattice step returned by png_adam7_reduction: 8, 4 or 2.
+ * - scratch:    Row buffer of at least image->width pixels.
+ *
+ * libpng errors longjmp out of this function: the caller owns image and scratch and must release them.
+ */
+void image_struct_init_passes(AsciiImageObject* image, png_structp png_ptr, png_infop info_ptr, int reduction, Pixel* scratch);
+
+/*
+ * image_struct_crop keeps the top left width x height pixels of an image, in place.
+ * - image:          Image without pyramid; its rows are packed to the new width.
+ * - width, height:  New size, at most the current one.
+ */
+void image_struct_crop(AsciiImageObject* image, int width, int height);
+
+#endif
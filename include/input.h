@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "commons.h"
+#include "arena.h"
+#include "decoder.h"
+
+/*
+ * MappedInput a PPM (P6) or headerless raw RGBA image held in memory undecoded.
+ * -width, height:   Image size in pixels.
+ * -channels:        Bytes per pixel: 3 for PPM, 4 for raw RGBA.
+ * -maxval:          Largest sample value (PPM maxval, 255 for raw RGBA).
+ * -pixels:          First byte of the first pixel; rows are width * channels bytes apart.
+ * -data, size:      The whole input, mapped from the file or read into the heap.
+ * -mapped:          true if data is an mmap to release with munmap, false if it is a heap buffer.
+ */
+typedef struct MappedInput{
+	int width, height;
+	int channels;
+	int maxval;
+	const uint8_t* pixels;
+	void* data;
+	size_t size;
+	bool mapped;
+} MappedInput;
+
+/* 
+ * input_validator attempts to validate a file as a PNG image.
+ * - input_path: Path of the file to validate.
+ *
+ * Returns: A FILE* positioned after the 8-byte signature, or NULL (a message is printed on stderr).
+ */
+FILE* input_validator(const char* input_path);
+
+/*
+ * decode_png reads a whole PNG file into a new AsciiImageObject.
+ * - input_path: Path of the PNG file.
+ *
+ * Returns: The decoded image, or NULL on failure (a message naming the file is printed on stderr).
+ */
+AsciiImageObject* decode_png(const char* input_path);
+
+/*
+ * mapped_input_open maps a PPM (P6) or raw RGBA input without decoding it.
+ * - input_path: Path of the file, or "-" for stdin.
+ * - raw_width:  Width of a headerless raw RGBA input (--size), 0 to only accept PPM.
+ * - raw_height: Height of a headerless raw RGBA input, 0 to only accept PPM.
+ * - input:      Receives the mapping; zero-filled when 0 or -1 is returned.
+ *
+ * Returns: 1 if input was filled, 0 if the file is neither (the caller decodes it as PNG),
+ *          -1 on failure (a message naming the file is printed on stderr).
+ */
+int mapped_input_open(const char* input_path, int raw_width, int raw_height, MappedInput* input);
+
+/*
+ * mapped_input_row returns one row of a MappedInput as RGBA.
+ * - input:      Input filled by mapped_input_open.
+ * - row:        Row index, between 0 and input->height - 1.
+ * - scratch:    Buffer of input->width pixels used when the row has to be expanded.
+ *
+ * Returns: A pointer into the mapping for raw RGBA, scratch holding the expanded row otherwise.
+ */
+const Pixel* mapped_input_row(const MappedInput* input, int row, Pixel* scratch);
+
+/*
+ * mapped_input_image turns a MappedInput into an AsciiImageObject and releases the input.
+ * - input:      Input filled by mapped_input_open; zero-filled on return.
+ * - threads:    Number of worker threads the PPM rows are expanded on.
+ * - arena:      Arena the expanded PPM is carved from, or NULL for the heap.
+ *
+ * Returns: The image, or NULL on memory allocation failure.
+ */
+AsciiImageObject* mapped_input_image(MappedInput* input, int threads, Arena* arena);
+
+/*
+ * mapped_input_close releases a MappedInput; a zero-filled one is accepted.
+ */
+void mapped_input_close(MappedInput* input);
+
+#endif
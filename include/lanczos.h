@@ -19,6 +19,7 @@
 #define LANCZOS_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include "commons.h" 
 
@@ -41,54 +42,198 @@ static const double lanczos_kernel[SAMPLE_SIZE] = {
 };
 
 /*
- * neighbor_offset relative (row, col) offsets forming a SAMPLE_SIZE × SAMPLE_SIZE grid.
+ * Argument scale of the Lanczos-2 kernel used at fractional phases: its support is
+ * then +-(KERNEL_RADIUS + 0.5) samples, and its integer samples are close to lanczos_kernel.
+ */
+#define LANCZOS_PHASE_STRETCH 0.8
+
+/*
+ * LanczosTaps precomputed 1D filter footprint of a single output coordinate.
+ * - count:   Number of valid taps (at most SAMPLE_SIZE).
+ * - index:   Source coordinate of each valid tap, in ascending order.
+ * - weight:  Lanczos coefficient applied to the corresponding source coordinate.
+ * - weightf: Single precision copy of weight, used by the SIMD variants.
+ * - weightq: Q14 fixed point copy of weight, used by the integer variant.
+ *
+ * Taps falling outside the source image are dropped when the table is built,
+ * which is equivalent to zero padding the borders but keeps the bounds check
+ * out of the convolution loops.
+ */
+typedef struct LanczosTaps{
+    int count;
+    int index[SAMPLE_SIZE];
+    double weight[SAMPLE_SIZE];
+    float weightf[SAMPLE_SIZE];
+    int16_t weightq[SAMPLE_SIZE];
+} LanczosTaps;
+
+/*
+ * LanczosVariant - Enumeration of the available implementations of the scaler.
  *
- * These offsets are used to collect pixel values from a neighborhood centered at
- * a given coordinate during Lanczos filtering. Each entry represents the offset
- * from the center pixel, where:
- *   neighbor_offset[i][0] = row offset
- *   neighbor_offset[i][1] = column offset
+ * -LANCZOS_AUTO:   Pick the widest variant supported by the running CPU.
+ * -LANCZOS_SCALAR: Portable double precision reference implementation.
+ * -LANCZOS_SSE2:   Single precision SSE2 kernel, one RGBA pixel per vector.
+ * -LANCZOS_AVX2:   Single precision AVX2 kernel, two RGBA pixels per vector.
+ * -LANCZOS_FIXED:  Portable integer kernel, Q14 weights and 16-bit intermediates.
+ * -LANCZOS_VARIANT_COUNT: Total number of entries; not a variant itself.
+ */
+typedef enum {
+    LANCZOS_AUTO,
+    LANCZOS_SCALAR,
+    LANCZOS_SSE2,
+    LANCZOS_AVX2,
+    LANCZOS_FIXED,
+    LANCZOS_VARIANT_COUNT
+} LanczosVariant;
+
+/*
+ * lanczos_variant_supported reports whether a kernel variant can run on the current CPU.
+ * - variant: Variant to check. LANCZOS_AUTO, LANCZOS_SCALAR and LANCZOS_FIXED are always supported.
  *
- * The grid is assumed to be square and symmetric.
+ * The SIMD variants are detected at runtime through cpuid, so a single binary built for
+ * a generic x86-64 target still uses AVX2 where available.
  */
-static const int neighbor_offset[SAMPLE_SIZE*SAMPLE_SIZE][2] = {
-    { -2, -2 }, { -2, -1 }, { -2,  0 }, { -2,  1 }, { -2,  2 },
-    { -1, -2 }, { -1, -1 }, { -1,  0 }, { -1,  1 }, { -1,  2 },
-    {  0, -2 }, {  0, -1 }, {  0,  0 }, {  0,  1 }, {  0,  2 },
-    {  1, -2 }, {  1, -1 }, {  1,  0 }, {  1,  1 }, {  1,  2 },
-    {  2, -2 }, {  2, -1 }, {  2,  0 }, {  2,  1 }, {  2,  2 }
-};
+bool lanczos_variant_supported(LanczosVariant variant);
 
 /*
- * is_inbound checks whether given matrix coordinates are within bounds.
- * - row:   row index to check
- * - col:   col index to check
- * - rows:  total numbers of rows in the matrix
- * - cols:  total numbers of cols in the matrix
+ * lanczos_resolve_variant maps a requested variant to the one that will actually run.
+ * - variant: Requested variant.
  *
- * return true iff (row, col) is a valid coordinate in in matrix of size rows x cols
+ * LANCZOS_AUTO picks the widest supported SIMD variant, or the integer variant on CPUs
+ * without one; an unsupported request falls back to the scalar reference.
  */
-static inline bool is_inbound(int row, int col, int rows, int cols){
-    return (row >= 0 && col >= 0 && col < cols && row < rows); 
-}
+LanczosVariant lanczos_resolve_variant(LanczosVariant variant);
 
 /*
  * lanczos_scale rescale an image using Lanczos interpolation.
  * - sample:        Pointer to an AsciiImageObject containing the original image data.
  * - scale_factor:  Integer factor by which the image will be downscaled.
+ * - threads:       Number of worker threads the output rows are split across.
+ * - variant:       Kernel implementation to use, resolved through lanczos_resolve_variant.
+ *
+ * The function perform a downscaling of an RGBA image as two separable Lanczos passes
+ * 1. Build one LanczosTaps table per output column and one per output row
+ * 2. Horizontal pass: each needed source row is convolved once into an intermediate row buffer
+ *    holding SAMPLE_SIZE rows, shared by all the output rows that overlap it
+ * 3. Vertical pass: each output row combines up to SAMPLE_SIZE intermediate rows
+ * 4. Convoluted values are clamped to the [0:255] range as per 8bit using Integer
  *
- * The function perform a downscaling of an RGBA image using separable Lanczos lanczos_point_convulution
- * 1. Allocate new buffer of Pixel structures to store the rescaled original_image
- * 2. For each Pixel in the output it identifies the corresponding floating point source coordinates and 
- * gathers the SAMPLE_SIZE * SAMPLE_SIZE neighbour around it
- * 3. Convoluted values are clamped to the [0:255] range as per 8bit using Integer
+ * The convultion is zero padded for pixel outside the borders, the padding is folded
+ * into the tap tables so the inner loops carry no bounds check
  *
- * The convultion is zero padded for pixel outside the borders
+ * Output rows are split in contiguous bands, one per thread. The result does not
+ * depend on the number of threads. The scalar variant is the double precision
+ * reference, the SIMD and integer variants match it within 1 LSB per channel.
  *
  * return the pointer to the newly created Pixel struct array representing the scaled image
  *
  * The caller is responsible for freeing the returned memory.
  */
-Pixel* lanczos_scale(AsciiImageObject* src, int scale_factor);
+Pixel* lanczos_scale(AsciiImageObject* src, int scale_factor, int threads, LanczosVariant variant);
+
+/*
+ * LanczosRowSink consumer of scaled rows produced by lanczos_scale_rows.
+ * - context:  Caller supplied state.
+ * - row:      Index of the output row.
+ * - pixels:   The width scaled Pixel of that row, only valid during the call.
+ * - width:    Number of output columns.
+ *
+ * Called concurrently from every worker thread, each time with a different row.
+ */
+typedef void (*LanczosRowSink)(void* context, int row, const Pixel* pixels, int width);
+
+/*
+ * lanczos_scale_rows rescale an image like lanczos_scale without materializing the result.
+ * - sample:        Pointer to an AsciiImageObject containing the original image data.
+ * - scale_factor:  Integer factor by which the image will be downscaled.
+ * - threads:       Number of worker threads the output rows are split across.
+ * - variant:       Kernel implementation to use.
+ * - sink:          Callback receiving each output row as soon as it is computed.
+ * - context:       Opaque pointer forwarded to sink.
+ *
+ * Each band computes its rows into a private, cache resident row buffer and hands it to
+ * the sink, so consumers that only need a derived value per pixel (e.g. a glyph) never
+ * pay for a full RGBA intermediate image and a second pass over it.
+ *
+ * Returns: true on success, false on allocation failure.
+ */
+bool lanczos_scale_rows(AsciiImageObject* sample, int scale_factor, int threads, LanczosVariant variant,
+                        LanczosRowSink sink, void* context);
+
+/*
+ * lanczos_resize_rows rescale an image to an explicit size, row by row like lanczos_scale_rows.
+ * - sample:        Pointer to an AsciiImageObject containing the original image data.
+ * - width:         Number of output columns, at most sample->width.
+ * - height:        Number of output rows, at most sample->height.
+ * - threads:       Number of worker threads the output rows are split across.
+ * - variant:       Kernel implementation to use.
+ * - sink:          Callback receiving each output row as soon as it is computed.
+ * - context:       Opaque pointer forwarded to sink.
+ *
+ * Returns: true on success, false on allocation failure.
+ */
+bool lanczos_resize_rows(AsciiImageObject* sample, int width, int height, int threads, LanczosVariant variant,
+                         LanczosRowSink sink, void* context);
+
+/*
+ * LanczosStream incremental scaler fed one source row at a time.
+ * - src_width, src_height:  Size of the source image.
+ * - width, height:          Size of the scaled image.
+ * - pushed:                 Number of source rows received so far.
+ * - next_row:               Next output row to be emitted.
+ * - kernels:                Passes of the selected variant.
+ * - row_taps, col_taps:     Tap tables, as in lanczos_scale.
+ * - ring:                   SAMPLE_SIZE horizontally filtered source rows.
+ * - row_bytes:              Size of one ring row.
+ *
+ * Produces exactly the same rows as lanczos_scale with the same variant, but only ever
+ * holds SAMPLE_SIZE filtered rows, so memory is O(width) instead of O(width * height).
+ * The source rows themselves are never retained: the caller may reuse its row buffer
+ * right after lanczos_stream_push returns.
+ */
+typedef struct LanczosStream{
+    int src_width, src_height;
+    int width, height;
+    int pushed;
+    int next_row;
+    const struct LanczosKernels* kernels;
+    LanczosTaps* row_taps;
+    LanczosTaps* col_taps;
+    unsigned char* ring;
+    size_t row_bytes;
+} LanczosStream;
+
+/*
+ * lanczos_stream_create prepares a row-by-row scaler for a source image of known size.
+ * - src_width, src_height:  Size of the source image.
+ * - scale_factor:           Integer factor by which the image will be downscaled.
+ * - variant:                Kernel implementation to use.
+ *
+ * Returns: A newly allocated LanczosStream, or NULL on allocation failure or when the
+ *          scaled image would be empty. Release it with lanczos_stream_destroy.
+ */
+LanczosStream* lanczos_stream_create(int src_width, int src_height, int scale_factor, LanczosVariant variant);
+
+/*
+ * lanczos_stream_push feeds the next source row to a LanczosStream.
+ * - stream:   Stream created by lanczos_stream_create.
+ * - src_row:  src_width Pixel of source row number stream->pushed.
+ */
+void lanczos_stream_push(LanczosStream* stream, const Pixel* src_row);
+
+/*
+ * lanczos_stream_pull emits the next output row if its whole neighbourhood was pushed.
+ * - stream:   Stream created by lanczos_stream_create.
+ * - dst_row:  Destination of stream->width Pixel.
+ *
+ * Call it in a loop after every push until it returns false.
+ * Returns: true if dst_row was written, false otherwise.
+ */
+bool lanczos_stream_pull(LanczosStream* stream, Pixel* dst_row);
+
+/*
+ * lanczos_stream_destroy releases a LanczosStream and every buffer it owns.
+ */
+void lanczos_stream_destroy(LanczosStream* stream);
 
 #endif
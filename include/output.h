@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <wchar.h>
+#include "commons.h"
+
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+#define UTF8_MAX_BYTES 4
+
+/*
+ * ColorMode - Colour output selectable with --color.
+ *
+ * -COLOR_NONE:      Glyphs only (default).
+ * -COLOR_TRUECOLOR: 24-bit foreground SGR sequences, ESC[38;2;R;G;Bm.
+ * -COLOR_256:       xterm 256-colour foreground SGR sequences, ESC[38;5;Nm.
+ * -COLOR_MODE_COUNT: Total number of entries; not a mode itself.
+ */
+typedef enum {
+	COLOR_NONE,
+	COLOR_TRUECOLOR,
+	COLOR_256,
+	COLOR_MODE_COUNT
+} ColorMode;
+
+/*
+ * OutputBuffer byte buffer in front of a file descriptor.
+ * - fd:        Destination file descriptor.
+ * - data:      Buffered bytes not yet written.
+ * - length:    Number of buffered bytes.
+ * - capacity:  Size of data; the buffer is flushed whenever it would overflow.
+ * - failed:    Set once a write() failed; further output is discarded.
+ *
+ * Replaces per-glyph stdio calls: glyphs are encoded to UTF-8 without going through
+ * the locale and the frame is handed to the kernel in as few write() calls as possible.
+ */
+typedef struct OutputBuffer{
+	int fd;
+	char* data;
+	size_t length;
+	size_t capacity;
+	bool failed;
+} OutputBuffer;
+
+/*
+ * utf8_encode encodes a single code point as UTF-8.
+ * - glyph:  Code point to encode. Invalid code points are encoded as U+FFFD.
+ * - bytes:  Destination of at least UTF8_MAX_BYTES bytes.
+ *
+ * Returns: Number of bytes written (1 to 4).
+ */
+size_t utf8_encode(wchar_t glyph, char* bytes);
+
+/*
+ * output_open initializes an OutputBuffer.
+ * - out:       Buffer to initialize.
+ * - fd:        Destination file descriptor.
+ * - capacity:  Size of the byte buffer, at least UTF8_MAX_BYTES.
+ *
+ * Returns: true on success, false on allocation failure.
+ */
+bool output_open(OutputBuffer* out, int fd, size_t capacity);
+
+/*
+ * output_write appends raw bytes, flushing first if they do not fit.
+ */
+void output_write(OutputBuffer* out, const void* bytes, size_t length);
+
+/*
+ * output_glyph_rows appends an ASCII image as UTF-8, one line per row.
+ * - out:    Destination buffer.
+ * - ascii:  Row-major buffer of rows * width glyphs.
+ * - rows:   Number of rows.
+ * - width:  Number of glyphs per row.
+ */
+void output_glyph_rows(OutputBuffer* out, const wchar_t* ascii, int rows, int width);
+
+/*
+ * output_braille_rows appends Braille dot patterns as UTF-8, one line per row.
+ * - out:    Destination buffer.
+ * - masks:  Row-major buffer of rows * width dot masks, U+2800 + mask being the glyph.
+ * - rows:   Number of rows.
+ * - width:  Number of cells per row.
+ */
+void output_braille_rows(OutputBuffer* out, const uint8_t* masks, int rows, int width);
+
+/*
+ * ansi256_index returns the xterm 256-colour palette entry closest to a pixel.
+ * - pixel:  Colour to quantize; alpha is ignored.
+ *
+ * Returns: An index of the 6x6x6 colour cube (16-231) or of the grey ramp (232-255).
+ */
+uint8_t ansi256_index(Pixel pixel);
+
+/*
+ * output_cells appends a run of glyphs, with a foreground colour per glyph if colours are given.
+ * - out:      Destination buffer.
+ * - glyphs:   count glyphs.
+ * - colors:   count colours, one per glyph, or NULL for plain glyphs.
+ * - count:    Number of glyphs.
+ * - mode:     COLOR_TRUECOLOR or COLOR_256; ignored without colours.
+ * - current:  Colour in effect, UINT32_MAX if none; updated as sequences are written.
+ *
+ * A colour sequence is only emitted when the colour differs from *current (exactly in
+ * truecolor mode, by palette entry in 256-colour mode); blank glyphs keep the current colour.
+ */
+void output_cells(OutputBuffer* out, const wchar_t* glyphs, const Pixel* colors, int count, ColorMode mode, uint32_t* current);
+
+/*
+ * output_color_rows appends an ASCII image as UTF-8 with a foreground colour per glyph.
+ * - out:     Destination buffer.
+ * - ascii:   Row-major buffer of rows * width glyphs.
+ * - colors:  Row-major buffer of rows * width colours, one per glyph.
+ * - rows:    Number of rows.
+ * - width:   Number of glyphs per row.
+ * - mode:    COLOR_TRUECOLOR or COLOR_256.
+ *
+ * A colour sequence is only emitted when the colour differs from the one in effect
+ * (exactly in truecolor mode, by palette entry in 256-colour mode); blank glyphs keep
+ * the current colour. A row that set a colour ends with a reset, so rows can be printed on their own.
+ */
+void output_color_rows(OutputBuffer* out, const wchar_t* ascii, const Pixel* colors, int rows, int width, ColorMode mode);
+
+/*
+ * output_flush writes every buffered byte to the file descriptor.
+ *
+ * Returns: false if any write failed since the buffer was opened.
+ */
+bool output_flush(OutputBuffer* out);
+
+/*
+ * output_close flushes and releases an OutputBuffer.
+ *
+ * Returns: false if any write failed since the buffer was opened.
+ */
+bool output_close(OutputBuffer* out);
+
+#endif
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/*
+ * Number of polls a RowQueue waiter spins for before it sleeps on the condition variable.
+ */
+#define ROW_QUEUE_SPINS 256
+
+/*
+ * RowBandFunction callback processing a contiguous band of output rows.
+ * - context:    Caller supplied state shared by every band.
+ * - row_begin:  First row of the band (inclusive).
+ * - row_end:    Last row of the band (exclusive).
+ *
+ * Bands never overlap, so a callback may write its own rows without locking.
+ */
+typedef void (*RowBandFunction)(void* context, int row_begin, int row_end);
+
+/*
+ * online_cpu_count returns the number of online processors, or 1 if it cannot be determined.
+ */
+int online_cpu_count(void);
+
+/*
+ * parallel_rows splits [0, rows) into contiguous bands and runs them on a pool of threads.
+ * - rows:      Total number of rows to process.
+ * - threads:   Number of bands, capped to rows. Values below 2 run inline.
+ * - function:  Callback invoked once per band.
+ * - context:   Opaque pointer forwarded to every callback.
+ *
+ * The bands are queued on a process-wide pool, which is grown to threads - 1 workers
+ * on first use and then reused by every later call. The calling thread claims bands
+ * too, and keeps doing so for other queued jobs while its own are finishing, so calls
+ * nested in a band or made from several threads at once always complete, even if
+ * no worker could be spawned. Every row is processed exactly once.
+ */
+void parallel_rows(int rows, int threads, RowBandFunction function, void* context);
+
+/*
+ * TaskFunction callback processing a single independent task.
+ * - context:  Caller supplied state shared by every task.
+ * - task:     Index of the task, in [0, count).
+ */
+typedef void (*TaskFunction)(void* context, int task);
+
+/*
+ * parallel_tasks runs count independent tasks on a pool of threads.
+ * - count:     Number of tasks.
+ * - threads:   Number of workers to use, capped to count. Values below 2 run inline.
+ * - function:  Callback invoked once per task.
+ * - context:   Opaque pointer forwarded to every callback.
+ *
+ * Unlike parallel_rows, tasks are handed out one at a time from a shared counter, so
+ * workers stay busy when tasks have very different costs (e.g. images of different
+ * sizes). Every task is run exactly once, even if some workers cannot be spawned.
+ */
+void parallel_tasks(int count, int threads, TaskFunction function, void* context);
+
+/*
+ * RowQueue bounded single-producer, single-consumer queue of fixed-size rows.
+ * - rows:       capacity slots of row_bytes each, written and read in place.
+ * - row_bytes:  Size of one slot.
+ * - capacity:   Number of slots.
+ * - head:       Number of rows popped so far, only written by the consumer.
+ * - tail:       Number of rows published so far, only written by the producer.
+ * - closed:     Set by either side: no more rows will be published, or none will be read.
+ * - sleepers:   Threads blocked on wake.
+ * - lock, wake: Used only to sleep when the queue is full or empty for longer than ROW_QUEUE_SPINS polls.
+ *
+ * head and tail live on their own cache lines so the two threads do not bounce them.
+ * Passing a row costs two atomic stores: the mutex is only taken by a side that has to sleep,
+ * and by the other side when it sees a sleeper.
+ */
+typedef struct RowQueue{
+	unsigned char* rows;
+	size_t row_bytes;
+	size_t capacity;
+	_Alignas(64) atomic_size_t head;
+	_Alignas(64) atomic_size_t tail;
+	atomic_bool closed;
+	atomic_int sleepers;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+} RowQueue;
+
+/*
+ * row_queue_init prepares an empty RowQueue.
+ * - queue:      Queue to initialise.
+ * - capacity:   Number of slots, at least 1.
+ * - row_bytes:  Size of one slot.
+ *
+ * Returns: false on allocation failure (nothing to destroy then).
+ */
+bool row_queue_init(RowQueue* queue, size_t capacity, size_t row_bytes);
+
+/*
+ * row_queue_destroy releases the slots and synchronisation objects of a RowQueue.
+ */
+void row_queue_destroy(RowQueue* queue);
+
+/*
+ * row_queue_reserve returns the slot the producer fills next, waiting while the queue is full.
+ *
+ * Returns: The slot, or NULL once the queue is closed.
+ */
+void* row_queue_reserve(RowQueue* queue);
+
+/*
+ * row_queue_publish hands the slot returned by row_queue_reserve to the consumer.
+ */
+void row_queue_publish(RowQueue* queue);
+
+/*
+ * row_queue_front returns the oldest published row, waiting while the queue is empty.
+ *
+ * Returns: The row, valid until row_queue_pop, or NULL once the queue is closed and drained.
+ */
+const void* row_queue_front(RowQueue* queue);
+
+/*
+ * row_queue_pop gives the row returned by row_queue_front back to the producer.
+ */
+void row_queue_pop(RowQueue* queue);
+
+/*
+ * row_queue_close marks a RowQueue closed and wakes both sides.
+ */
+void row_queue_close(RowQueue* queue);
+
+#endif
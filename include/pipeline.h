@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdbool.h>
+#include "commons.h"
+#include "lanczos.h"
+#include "output.h"
+
+#define PIPELINE_SOURCE_ROWS 32
+#define PIPELINE_GLYPH_ROWS 16
+
+/*
+ * PipelineRowReader callback producing the next source row of a pipelined render.
+ * - context:      Caller supplied state.
+ * - row:          Index of the row, rows are requested in order from 0.
+ * - destination:  Buffer of one source row to fill.
+ *
+ * Called on the thread that called pipeline_stream.
+ * Returns: false if the row cannot be read; the render stops there.
+ */
+typedef bool (*PipelineRowReader)(void* context, int row, Pixel* destination);
+
+/*
+ * pipeline_stream renders an image row by row with decode, scale and output on separate threads.
+ * - stream:       Scaler created for the image, nothing pushed yet.
+ * - palette:      Palette of the glyphs.
+ * - reader:       Source of the stream->src_height rows.
+ * - context:      Opaque pointer forwarded to reader.
+ * - output:       Buffered writer receiving the glyph rows; only touched by the writer thread until the call returns.
+ *
+ * The calling thread reads source rows into a queue of PIPELINE_SOURCE_ROWS; a scaler
+ * thread pushes them into the stream and turns every row it can pull into glyphs, in a
+ * queue of PIPELINE_GLYPH_ROWS that a writer thread prints in order. An output row is
+ * scaled as soon as its last source row arrives, so the time of a render approaches that
+ * of its slowest stage instead of the sum of the three. The output is the same as
+ * pulling from the stream on a single thread.
+ *
+ * Returns: 1 on success, 0 if the threads could not be started (no row was read: the
+ *          caller can render on one thread instead), -1 if reader failed.
+ */
+int pipeline_stream(LanczosStream* stream, Palette palette, PipelineRowReader reader, void* context, OutputBuffer* output);
+
+#endif
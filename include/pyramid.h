@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <stdbool.h>
+#include "commons.h"
+#include "lanczos.h"
+
+#define PYRAMID_MAX_LEVELS 16
+
+/*
+ * pyramid_level_for returns the pyramid level an output size is resampled from.
+ * - image:          Source image.
+ * - width, height:  Output size.
+ *
+ * The deepest level that is still at least as large as the output, so the remaining
+ * ratio is in [1, 2).
+ *
+ * Returns: 0 for original_image, k for pyramid[k - 1].
+ */
+int pyramid_level_for(const AsciiImageObject* image, int width, int height);
+
+/*
+ * pyramid_build makes sure the first levels of the pyramid exist.
+ * - image:     Image owning the pyramid.
+ * - levels:    Number of levels wanted; capped to PYRAMID_MAX_LEVELS and to 1x1 pixel.
+ * - threads:   Number of worker threads used for each reduction.
+ * - variant:   Scaler implementation to use.
+ *
+ * Not thread safe: an image shared by several threads must be built before it is shared.
+ *
+ * Returns: false on memory allocation failure; the levels built so far are kept.
+ */
+bool pyramid_build(AsciiImageObject* image, int levels, int threads, LanczosVariant variant);
+
+/*
+ * pyramid_view describes a level as an AsciiImageObject usable by the scalers.
+ * - image:  Image owning the pyramid.
+ * - level:  0 for original_image, k for pyramid[k - 1]; must already be built.
+ * - view:   Receives a view sharing the pixels of the level; it owns nothing.
+ */
+void pyramid_view(const AsciiImageObject* image, int level, AsciiImageObject* view);
+
+/*
+ * pyramid_free releases every pyramid level of an image.
+ */
+void pyramid_free(AsciiImageObject* image);
+
+#endif
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SELFTEST_H
+#define SELFTEST_H
+
+/*
+ * run_self_test checks every supported scaler variant against the scalar reference.
+ * - threads: Number of worker threads used by each scaling call.
+ *
+ * Deterministic synthetic RGBA images of several sizes are downscaled by several
+ * factors with each SIMD variant available on the running CPU. Every output channel
+ * must be within 1 LSB of the double precision scalar result. The integer glyph lookup
+ * tables must also map every RGB value exactly like the double precision formula, and
+ * the box filter must match a naive per-cell mean at integer and fractional factors.
+ * Lanczos at fractional factors must match a direct evaluation of the phase-dependent taps.
+ * libyascii must render the bytes of the CLI pipeline from RGBA and PNG input, report the
+ * required length when the output buffer is too small and reject a truncated PNG.
+ * Scales larger than the image must give an empty frame with the box and auto filters.
+ * The shape lookup must map flat grey cells like the luma tables and pick the glyph
+ * drawing a white band on black.
+ * Frames rendered with -j 1 and with several threads must be byte-identical.
+ *
+ * A line per case is printed to stdout.
+ * Returns: EXIT_SUCCESS if every case passed, EXIT_FAILURE otherwise.
+ */
+int run_self_test(int threads);
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "commons.h"
+#include "lanczos.h"
+
+#define SERVER_DEFAULT_MEMORY ((size_t) 256 << 20)
+#define SERVER_BACKLOG 64
+
+/*
+ * Wire protocol, one request per line, any number of requests per connection:
+ *
+ *     request:   "<palette index> <scale factor, may be fractional> <absolute path>\n"
+ *     response:  "OK <rows>\n" followed by exactly <rows> glyph rows, or
+ *                "ERR <message>\n"
+ *
+ * A glyph row may be blank (a scale wider than the image leaves rows of zero cells),
+ * so the row count, not an empty line, delimits a response.
+ */
+
+/*
+ * serve runs the render daemon on a Unix domain socket; it only returns on setup failure.
+ * - socket_path:   Filesystem path of the listening socket. A stale socket file is replaced.
+ * - memory_limit:  Upper bound, in bytes, on the decoded images kept resident.
+ * - workers:       Number of connections served concurrently.
+ * - variant:       Scaler implementation used for every request.
+ * - filter:        Resampling filter used for every request.
+ * - pyramid:       Keep a 2x reduction pyramid of every image and resample from it.
+ *
+ * Returns: EXIT_FAILURE if the socket cannot be set up.
+ */
+int serve(const char* socket_path, size_t memory_limit, int workers, LanczosVariant variant, ResampleFilter filter, bool pyramid);
+
+/*
+ * serve_request asks a running daemon for a render and copies the glyph rows to stdout.
+ * - socket_path:   Socket of the daemon.
+ * - input_path:    Image to render; relative paths are resolved against the current directory.
+ * - palette:       Palette to render with.
+ * - scale:         Downscale factor, may be fractional.
+ *
+ * Returns: EXIT_SUCCESS, or EXIT_FAILURE if the daemon cannot be reached or reports an error.
+ */
+int serve_request(const char* socket_path, const char* input_path, Palette palette, double scale);
+
+#endif
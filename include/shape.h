@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHAPE_H
+#define SHAPE_H
+
+#include <stdint.h>
+#include <wchar.h>
+#include "commons.h"
+#include "asciifier.h"
+
+/*
+ * Shape matching geometry: every cell is sampled as a 2x3 grid of sub-cells,
+ * stored row by row (top left, top right, middle left, ...).
+ */
+#define SHAPE_COLS		2
+#define SHAPE_ROWS		3
+#define SHAPE_CELLS		(SHAPE_COLS * SHAPE_ROWS)
+
+/*
+ * Shape index layout: a cell is reduced to its mean luminance, the mask of the
+ * sub-cells brighter than that mean and its contrast (mean absolute deviation).
+ *
+ * SHAPE_MEAN_BITS:     Quantization of the mean luminance.
+ * SHAPE_CONTRAST_*:    Mean absolute deviation, in 8-bit luminance, at which contrast
+ *                      levels 1, 2 and 3 start. Level 0 cells are flat.
+ * SHAPE_INDEX_SIZE:    Number of entries of the per-palette table.
+ */
+#define SHAPE_MEAN_BITS		5
+#define SHAPE_CONTRAST_LOW	10
+#define SHAPE_CONTRAST_MID	32
+#define SHAPE_CONTRAST_HIGH	72
+#define SHAPE_INDEX_SIZE	(4 << (SHAPE_CELLS + SHAPE_MEAN_BITS))
+
+/*
+ * ShapeMap precomputed mapping from the sub-cell luminances of a cell to a glyph.
+ * -glyphs:       Brightness tables of the palette, used for flat cells.
+ * -shape_glyph:  Best glyph of each (contrast, mask, mean) index.
+ *
+ * Every glyph has a coverage vector: how much of each sub-cell its strokes ink. Table
+ * entries hold the glyph whose tone-adjusted coverage is closest, in squared error, to
+ * the cell reconstructed from the index.
+ */
+typedef struct ShapeMap{
+	const GlyphMap* glyphs;
+	wchar_t shape_glyph[SHAPE_INDEX_SIZE];
+} ShapeMap;
+
+/*
+ * shape_map returns the shape table of a palette.
+ * -palette:  Palette enum value.
+ *
+ * The table of a palette is built once, on first use of that palette, and is safe to
+ * share between threads.
+ */
+const ShapeMap* shape_map(Palette palette);
+
+/*
+ * shape_luma returns the 8-bit luminance of a pixel from the brightness tables.
+ */
+static inline uint32_t shape_luma(const GlyphMap* map, Pixel pixel){
+	uint32_t luma = map->luma[0][pixel.red] + map->luma[1][pixel.green] + map->luma[2][pixel.blue];
+	return (luma * 255 + (1u << (LUMA_BITS - 1))) >> LUMA_BITS;
+}
+
+/*
+ * shape_lookup maps the sub-cells of a cell to a glyph.
+ * -map:   Shape table of the palette.
+ * -luma:  8-bit luminance of each sub-cell, as returned by shape_luma.
+ * -mean:  Mean pixel of the cell.
+ *
+ * Flat cells map exactly like glyph_lookup(mean), so shape matching only changes the
+ * glyph of cells that actually have an edge or a stroke in them.
+ */
+static inline wchar_t shape_lookup(const ShapeMap* map, const uint32_t luma[SHAPE_CELLS], Pixel mean){
+	uint32_t sum = 0, mask = 0, deviation = 0;
+
+	for(int k = 0; k < SHAPE_CELLS; k++) sum += luma[k];
+
+	// deviations are kept SHAPE_CELLS times larger to stay in integers
+	for(int k = 0; k < SHAPE_CELLS; k++){
+		uint32_t scaled = luma[k] * SHAPE_CELLS;
+		mask |= (uint32_t) (scaled > sum) << k;
+		deviation += scaled > sum ? scaled - sum : sum - scaled;
+	}
+
+	if(deviation < SHAPE_CONTRAST_LOW * SHAPE_CELLS * SHAPE_CELLS) return glyph_lookup(map->glyphs, mean);
+
+	uint32_t contrast = deviation >= SHAPE_CONTRAST_HIGH * SHAPE_CELLS * SHAPE_CELLS ? 3 :
+			    deviation >= SHAPE_CONTRAST_MID * SHAPE_CELLS * SHAPE_CELLS ? 2 : 1;
+	uint32_t level = (sum << SHAPE_MEAN_BITS) / (256 * SHAPE_CELLS);
+
+	return map->shape_glyph[(contrast << (SHAPE_CELLS + SHAPE_MEAN_BITS)) | (mask << SHAPE_MEAN_BITS) | level];
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * StatsStage pipeline stages measured by --timings.
+ * -STATS_HEADER:  Opening the file, signature check and png_read_info.
+ * -STATS_DECODE:  libpng decode and RGBA normalization.
+ * -STATS_RENDER:  Lanczos scaling and glyph mapping (fused into one pass).
+ * -STATS_OUTPUT:  UTF-8 encoding and write() of the glyphs.
+ * -STATS_STAGE_COUNT: Total number of stages; not a stage itself.
+ *
+ * Decode and render are each one pass, and are timed as such. The RGBA normalization
+ * is a set of libpng transformations applied inside png_read_row, so there is no
+ * separate pass to time. Glyphs are mapped row by row from the scaler's row sink on
+ * the worker threads, in the library, which does not link the stats: timing the two
+ * halves apart would take a clock read per row and report summed CPU time, not wall time.
+ */
+typedef enum {
+	STATS_HEADER,
+	STATS_DECODE,
+	STATS_RENDER,
+	STATS_OUTPUT,
+	STATS_STAGE_COUNT
+} StatsStage;
+
+/*
+ * StatsMark snapshot taken at the start of a stage.
+ * - ns:    Monotonic clock, in nanoseconds.
+ * - heap:  Bytes of heap in use, when the C library can report it.
+ */
+typedef struct StatsMark{
+	int64_t ns;
+	int64_t heap;
+} StatsMark;
+
+/*
+ * Global flag enabling the collection, set once before any rendering starts.
+ */
+extern bool g_stats_enabled;
+
+/*
+ * stats_mark takes a snapshot of the clock and of the heap usage.
+ */
+StatsMark stats_mark(void);
+
+/*
+ * stats_record adds the time and heap growth since a mark to a stage.
+ * Safe to call from several threads at once.
+ */
+void stats_record(StatsStage stage, StatsMark mark);
+
+/*
+ * stats_begin starts timing a stage; a no-op returning an empty mark when stats are off.
+ */
+static inline StatsMark stats_begin(void){
+	StatsMark mark = { 0, 0 };
+	if(g_stats_enabled) mark = stats_mark();
+	return mark;
+}
+
+/*
+ * stats_end closes a stage started by stats_begin; a single predictable branch when stats are off.
+ */
+static inline void stats_end(StatsStage stage, StatsMark mark){
+	if(g_stats_enabled) stats_record(stage, mark);
+}
+
+/*
+ * stats_report prints every stage, the total wall time and the peak RSS.
+ * - stream:  Destination, stderr in the CLI.
+ * - start:   Mark taken when the program started.
+ * - json:    Print a single JSON object instead of the text table.
+ */
+void stats_report(FILE* stream, StatsMark start, bool json);
+
+#endif
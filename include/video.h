@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef VIDEO_H
+#define VIDEO_H
+
+#include <stdbool.h>
+#include "commons.h"
+#include "lanczos.h"
+#include "output.h"
+
+#define VIDEO_SLOTS 3
+#define VIDEO_LATENCY_BUCKETS 1000
+
+/*
+ * video_play renders a stream of raw RGBA frames from a file descriptor as live terminal video.
+ * - fd:             Source of width * height * 4 byte frames, RGBA, rows top to bottom
+ *                   (e.g. ffmpeg -f rawvideo -pix_fmt rgba).
+ * - width, height:  Frame size in pixels.
+ * - scale:          Downscale factor, at least 1; may be fractional.
+ * - palette:        Palette every frame is rendered with.
+ * - color:          Colour output mode, COLOR_NONE for glyphs only.
+ * - threads:        Number of worker threads used to scale each frame.
+ * - variant:        Scaler implementation.
+ * - filter:         Resampling filter.
+ *
+ * The first frame is painted whole; afterwards only the runs of cells that changed are
+ * rewritten, after a cursor move. Frames are read on a separate thread and only the
+ * most recent complete frame is rendered: frames that arrive while the terminal is still
+ * busy are dropped instead of queueing up latency. Stops at the end of the stream or
+ * on SIGINT, then prints the frame rate, drop count and latency on stderr.
+ *
+ * Returns: EXIT_SUCCESS, or EXIT_FAILURE on a read error, a truncated frame or allocation failure.
+ */
+int video_play(int fd, int width, int height, double scale, Palette palette, ColorMode color, int threads,
+	       LanczosVariant variant, ResampleFilter filter);
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef YASCII_H
+#define YASCII_H
+
+#include <stddef.h>
+#include "commons.h"
+#include "lanczos.h"
+
+/*
+ * libyascii: the renderer behind the YAscii CLI as an embeddable library.
+ *
+ * A YasciiContext owns the scratch buffers (decoded RGBA image, glyph frame) and
+ * grows them as needed, so rendering frames of similar size in a loop allocates
+ * nothing after the first call. A context must not be used by two threads at once;
+ * give each thread its own. The palette tables are shared, immutable and built once
+ * per process. Nothing is printed and the process is never terminated: every
+ * failure comes back as a YasciiStatus.
+ */
+
+/*
+ * YasciiStatus result codes of the library.
+ * -YASCII_OK:                    Success.
+ * -YASCII_ERROR_ARGUMENT:        NULL pointer, non-positive size or out of range option.
+ * -YASCII_ERROR_NOT_PNG:         The input does not start with a PNG signature.
+ * -YASCII_ERROR_DECODE:          libpng rejected the data (corrupt or truncated PNG).
+ * -YASCII_ERROR_MEMORY:          A scratch buffer could not be allocated.
+ * -YASCII_ERROR_BUFFER_TOO_SMALL: The output does not fit; the required size is returned.
+ */
+typedef enum {
+	YASCII_OK,
+	YASCII_ERROR_ARGUMENT,
+	YASCII_ERROR_NOT_PNG,
+	YASCII_ERROR_DECODE,
+	YASCII_ERROR_MEMORY,
+	YASCII_ERROR_BUFFER_TOO_SMALL
+} YasciiStatus;
+
+/*
+ * YasciiOptions rendering parameters of a single call.
+ * - palette:       Glyph palette.
+ * - scale_factor:  Integer downscale factor, at least 1.
+ * - threads:       Worker threads used inside the call; values below 2 render on the calling thread.
+ * - variant:       Scaler implementation, LANCZOS_AUTO for the widest one the CPU supports.
+ */
+typedef struct YasciiOptions{
+	Palette palette;
+	int scale_factor;
+	int threads;
+	LanczosVariant variant;
+} YasciiOptions;
+
+typedef struct YasciiContext YasciiContext;
+
+/*
+ * yascii_context_create allocates an empty rendering context.
+ *
+ * Returns: The context, or NULL on memory allocation failure.
+ */
+YasciiContext* yascii_context_create(void);
+
+/*
+ * yascii_context_destroy releases a context and its scratch buffers; NULL is accepted.
+ */
+void yascii_context_destroy(YasciiContext* context);
+
+/*
+ * yascii_output_bound returns an upper bound of the output size of a render.
+ * - width, height:  Source image size in pixels.
+ * - scale_factor:   Integer downscale factor.
+ *
+ * A buffer of this size never yields YASCII_ERROR_BUFFER_TOO_SMALL.
+ */
+size_t yascii_output_bound(int width, int height, int scale_factor);
+
+/*
+ * yascii_render_png renders a PNG held in memory.
+ * - context:   Rendering context.
+ * - png:       PNG file contents.
+ * - size:      Size of png in bytes.
+ * - options:   Rendering parameters.
+ * - output:    Destination of the UTF-8 glyph rows, one '\n' terminated line per row. Not NUL terminated.
+ * - capacity:  Size of output in bytes.
+ * - length:    Receives the number of bytes written, or the required size on YASCII_ERROR_BUFFER_TOO_SMALL.
+ *
+ * Returns: YASCII_OK or an error code.
+ */
+YasciiStatus yascii_render_png(YasciiContext* context, const void* png, size_t size, const YasciiOptions* options,
+	char* output, size_t capacity, size_t* length);
+
+/*
+ * yascii_render_rgba renders raw 8-bit RGBA pixels.
+ * - context:   Rendering context.
+ * - pixels:    Row-major width * height pixels; read only, never copied.
+ * - width:     Width in pixels.
+ * - height:    Height in pixels.
+ * - options, output, capacity, length: As in yascii_render_png.
+ *
+ * Returns: YASCII_OK or an error code.
+ */
+YasciiStatus yascii_render_rgba(YasciiContext* context, const Pixel* pixels, int width, int height, const YasciiOptions* options,
+	char* output, size_t capacity, size_t* length);
+
+/*
+ * yascii_status_string returns a static, human readable description of a status code.
+ */
+const char* yascii_status_string(YasciiStatus status);
+
+#endif
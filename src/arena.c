@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "arena.h"
+
+/*
+ * ArenaBlock header of one block, followed by capacity bytes of storage.
+ * - next:       Block allocated before this one.
+ * - capacity:   Usable bytes, a multiple of ARENA_ALIGNMENT.
+ * - used:       Bytes carved so far.
+ *
+ * The header takes ARENA_ALIGNMENT bytes so the storage after it stays aligned.
+ */
+typedef struct ArenaBlock{
+	struct ArenaBlock* next;
+	size_t capacity;
+	size_t used;
+} ArenaBlock;
+
+_Static_assert(sizeof(ArenaBlock) <= ARENA_ALIGNMENT, "ArenaBlock header must fit in one alignment unit");
+
+/*
+ * arena_block_create allocates an empty, aligned block.
+ * - capacity:   Usable bytes, a multiple of ARENA_ALIGNMENT.
+ *
+ * Returns: The block, or NULL on allocation failure.
+ */
+static ArenaBlock* arena_block_create(size_t capacity){
+	if(capacity > SIZE_MAX - ARENA_ALIGNMENT) return NULL;
+
+	ArenaBlock* block = (ArenaBlock*) aligned_alloc(ARENA_ALIGNMENT, ARENA_ALIGNMENT + capacity);
+	if(!block) return NULL;
+
+	block->next	= NULL;
+	block->capacity	= capacity;
+	block->used	= 0;
+	return block;
+}
+
+/*
+ * arena_init prepares an empty Arena; nothing is allocated until the first arena_alloc.
+ */
+void arena_init(Arena* arena){
+	arena->blocks	= NULL;
+	arena->reserved	= 0;
+}
+
+/*
+ * arena_alloc carves a buffer out of an Arena.
+ * - arena:  Arena to carve from, or NULL to malloc the buffer instead.
+ * - size:   Size in bytes; 0 is accepted.
+ *
+ * When the current block is full a new one of at least ARENA_BLOCK_SIZE, and at least
+ * twice the previous one, is chained in front: a render needs O(log) blocks, and
+ * arena_reset merges them so the next image is carved from a single one.
+ *
+ * Returns: An ARENA_ALIGNMENT aligned buffer valid until arena_reset (or arena_free when
+ *          arena is NULL), or NULL on allocation failure.
+ */
+void* arena_alloc(Arena* arena, size_t size){
+	if(!arena) return malloc(size ? size : 1);
+	if(size > SIZE_MAX - 2 * ARENA_ALIGNMENT) return NULL;
+
+	size_t need = (size + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1);
+	if(need == 0) need = ARENA_ALIGNMENT;
+
+	ArenaBlock* block = arena->blocks;
+	if(!block || block->capacity - block->used < need){
+		size_t capacity = block && block->capacity <= SIZE_MAX / 4 ? block->capacity * 2 : ARENA_BLOCK_SIZE;
+		if(capacity < ARENA_BLOCK_SIZE) capacity = ARENA_BLOCK_SIZE;
+		if(capacity < need) capacity = need;
+
+		block = arena_block_create(capacity);
+		if(!block) return NULL;
+
+		block->next		= arena->blocks;
+		arena->blocks		= block;
+		arena->reserved		+= capacity;
+	}
+
+	void* buffer = (unsigned char*) block + ARENA_ALIGNMENT + block->used;
+	block->used += need;
+	return buffer;
+}
+
+/*
+ * arena_free releases a buffer returned by arena_alloc with the same arena.
+ *
+ * A no-op for an Arena, whose buffers go away at arena_reset; free() when arena is NULL.
+ */
+void arena_free(Arena* arena, void* buffer){
+	if(!arena) free(buffer);
+}
+
+/*
+ * arena_reset discards every allocation of an Arena and keeps its memory for the next image.
+ *
+ * Several blocks mean the last image did not fit in the first one: they are replaced by
+ * a single block as large as all of them together, so the next image of that size is
+ * carved from contiguous, already sized memory. If that block cannot be allocated the
+ * arena is simply left empty.
+ *
+ * The memory kept is bounded by the last image, so a worker that once rendered a huge
+ * one does not hold it for the rest of its life: above ARENA_RETAIN_LIMIT everything is
+ * released, and a reservation ARENA_TRIM_FACTOR times larger than the bytes carved is
+ * shrunk to those bytes (ARENA_BLOCK_SIZE at least).
+ */
+void arena_reset(Arena* arena){
+	if(!arena->blocks) return;
+
+	size_t used = 0;
+	for(ArenaBlock* block = arena->blocks; block; block = block->next) used += block->used;
+	if(used < ARENA_BLOCK_SIZE) used = ARENA_BLOCK_SIZE;
+
+	if(used > ARENA_RETAIN_LIMIT){
+		arena_release(arena);
+		return;
+	}
+
+	size_t reserved = arena->reserved;
+	if(reserved / ARENA_TRIM_FACTOR > used || reserved > ARENA_RETAIN_LIMIT) reserved = used;
+
+	if(arena->blocks->next || reserved != arena->reserved){
+		arena_release(arena);
+
+		arena->blocks = arena_block_create(reserved);
+		if(arena->blocks) arena->reserved = reserved;
+		return;
+	}
+
+	arena->blocks->used = 0;
+}
+
+/*
+ * arena_release frees all the memory of an Arena, which is left empty and reusable.
+ */
+void arena_release(Arena* arena){
+	while(arena->blocks){
+		ArenaBlock* next = arena->blocks->next;
+		free(arena->blocks);
+		arena->blocks = next;
+	}
+	arena->reserved = 0;
+}
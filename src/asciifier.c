@@ -15,9 +15,18 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdlib.h>
+#include <string.h>
 #include <wchar.h>
+#include <stdbool.h>
+#include <pthread.h>
 #include "asciifier.h"
+#include "parallel.h"
+#include "pyramid.h"
+#include "box.h"
+#include "shape.h"
 
 /*
  * ascii_palettes array of wide-character strings representing symbol sets
@@ -57,12 +66,133 @@ static double greyscale_converter(Pixel pixel){
 	return linear_red * RED_CONVERSION_CONSTANT + linear_green * GREEN_CONVERSION_CONSTANT + linear_blue * BLUE_CONVERSION_CONSTANT;
 }
 
+/*
+ * glyph_reference maps a pixel to a glyph with the double precision luminance formula.
+ * -map:    Lookup tables of the palette.
+ * -pixel:  Pixel to map.
+ *
+ * This is the reference mapping the lookup tables reproduce; it is only evaluated for
+ * pixels whose luminance level straddles a palette boundary.
+ */
+wchar_t glyph_reference(const GlyphMap* map, Pixel pixel){
+	double pixel_grey_level = greyscale_converter(pixel);
+	pixel_grey_level = (pixel_grey_level < 0) ? 0 : (pixel_grey_level > 1) ? 1 : pixel_grey_level;
+	int palette_index = (int) (pixel_grey_level * (double)(map->palette_size - 1));
+	return map->palette_string[palette_index];
+}
+
+static GlyphMap glyph_maps[PALETTE_COUNT];
+static pthread_once_t glyph_maps_once = PTHREAD_ONCE_INIT;
+
+/*
+ * glyph_maps_build fills the lookup tables of every palette.
+ *
+ * Channel tables hold round(weight * value / 255 * 2^LUMA_BITS). A level covers the
+ * luminances [level << LUMA_LEVEL_SHIFT, (level + 1) << LUMA_LEVEL_SHIFT); it gets a glyph
+ * only if no palette boundary k / (palette_size - 1) lies within that range widened
+ * by 2 units, which covers the rounding error of the three table entries.
+ */
+static void glyph_maps_build(void){
+	static const double weights[3] = { RED_CONVERSION_CONSTANT, GREEN_CONVERSION_CONSTANT, BLUE_CONVERSION_CONSTANT };
+	const int64_t one = (int64_t) 1 << LUMA_BITS;
+	const int64_t margin = 2;
+
+	for(int palette = 0; palette < PALETTE_COUNT; palette++){
+		GlyphMap* map = &glyph_maps[palette];
+		map->palette_string	= ascii_palettes[palette];
+		map->palette_size	= (int) wcslen(map->palette_string);
+		int64_t steps		= map->palette_size - 1;
+
+		for(int channel = 0; channel < 3; channel++)
+			for(int value = 0; value < 256; value++)
+				map->luma[channel][value] = (uint32_t) (weights[channel] * value / 255 * (double) one + 0.5);
+
+		for(int level = 0; level < LUMA_LEVELS; level++){
+			int64_t low	= ((int64_t) level << LUMA_LEVEL_SHIFT) - margin;
+			int64_t high	= ((int64_t) (level + 1) << LUMA_LEVEL_SHIFT) - 1 + margin;
+			bool ambiguous	= false;
+
+			// boundary k sits at luminance k * one / steps, compared without dividing
+			for(int64_t k = 1; k <= steps && !ambiguous; k++)
+				ambiguous = (low * steps <= k * one) && (k * one <= high * steps);
+
+			if(ambiguous || steps == 0){
+				map->level_glyph[level] = steps == 0 ? map->palette_string[0] : 0;
+			}else{
+				int64_t index = (low + margin) * steps / one;
+				map->level_glyph[level] = map->palette_string[index > steps ? steps : index];
+			}
+		}
+	}
+}
+
+/*
+ * glyph_map returns the lookup tables of a palette.
+ * -palette:  Palette enum value.
+ *
+ * Tables of every palette are built once, on first use, and are safe to share between threads.
+ */
+const GlyphMap* glyph_map(Palette palette){
+	pthread_once(&glyph_maps_once, glyph_maps_build);
+	return &glyph_maps[palette];
+}
+
+/*
+ * AsciifyJob state shared by every band of an asciify_image call.
+ */
+typedef struct AsciifyJob{
+	const Pixel* image;
+	int width;
+	const GlyphMap* map;
+	wchar_t* output;
+} AsciifyJob;
+
+/*
+ * asciify_band maps rows [row_begin, row_end) of an AsciifyJob to palette glyphs.
+ */
+static void asciify_band(void* context, int row_begin, int row_end){
+	AsciifyJob* job = (AsciifyJob*) context;
+	int width = job->width;
+
+	for(int row = row_begin; row < row_end; row++){
+		const Pixel* pixels = job->image + (size_t) row * width;
+		wchar_t* glyphs = job->output + (size_t) row * width;
+
+		for(int col = 0; col < width; col++)
+			glyphs[col] = glyph_lookup(job->map, pixels[col]);
+	}
+}
+
+/*
+ * asciify_into converts an image to an ASCII representation into a caller-provided buffer.
+ * -image:    Pointer to the array of pixels (input image data).
+ * -height:   Number of rows in the image.
+ * -width:    Number of columns in the image.
+ * -palette:  Palette enum value specifying which character set to use for mapping.
+ * -output:   Destination buffer of at least height * width wchar_t.
+ * -threads:  Number of worker threads the rows are split across.
+ *
+ * Same mapping as asciify_image, without allocating: used by the streaming path to
+ * convert one scaled row at a time into a reused buffer.
+ */
+void asciify_into(const Pixel* image, int height, int width, Palette palette, wchar_t* output, int threads){
+	AsciifyJob job;
+
+	job.image		= image;
+	job.width		= width;
+	job.map			= glyph_map(palette);
+	job.output		= output;
+
+	parallel_rows(height, threads, asciify_band, &job);
+}
+
 /*
  * asciify_image converts an image to an ASCII representation using a given palette.
  * -image:    Pointer to the array of pixels (input image data).
  * -height:   Number of rows in the image.
  * -width:    Number of columns in the image.
  * -palette:  Palette enum value specifying which character set to use for mapping.
+ * -threads:  Number of worker threads the rows are split across.
  *
  * This function maps each pixel's greyscale value to a corresponding
  * character from the selected wide-character palette in 'ascii_palettes'.
@@ -71,22 +201,411 @@ static double greyscale_converter(Pixel pixel){
  * Returns: Pointer to a newly allocated buffer on success, or NULL on failure.
  *          The caller is responsible for freeing the returned buffer.
  */
-wchar_t* asciify_image(Pixel* image, int height, int width, Palette palette){
+wchar_t* asciify_image(Pixel* image, int height, int width, Palette palette, int threads){
 	size_t byte = (size_t) height * (size_t) width * sizeof(wchar_t); 
-	const wchar_t* palette_string = ascii_palettes[palette];
-	int palette_size = (int) wcslen(palette_string);
 	wchar_t* asciified_image = malloc(byte);
 
 	if(!asciified_image) return NULL;
 
-	for(int row = 0; row < height; row++){
+	asciify_into(image, height, width, palette, asciified_image, threads);
+
+	return asciified_image;
+}
+
+/*
+ * FusedJob state shared by the row sink of asciify_scaled.
+ * - map:     Lookup tables of the palette.
+ * - output:  Destination glyph buffer.
+ * - colors:  Optional destination of the scaled pixel behind every glyph, or NULL.
+ */
+typedef struct FusedJob{
+	const GlyphMap* map;
+	wchar_t* output;
+	Pixel* colors;
+} FusedJob;
+
+/*
+ * fused_row_sink maps one freshly scaled row to glyphs.
+ */
+static void fused_row_sink(void* context, int row, const Pixel* pixels, int width){
+	FusedJob* job = (FusedJob*) context;
+	wchar_t* glyphs = job->output + (size_t) row * width;
+
+	for(int col = 0; col < width; col++)
+		glyphs[col] = glyph_lookup(job->map, pixels[col]);
+
+	if(job->colors) memcpy(job->colors + (size_t) row * width, pixels, (size_t) width * sizeof(Pixel));
+}
+
+/*
+ * asciify_scaled_into downscales an image and converts it to ASCII into a caller-provided buffer.
+ * -sample:        Source image; only original_image is read.
+ * -scale_factor:  Integer factor by which the image will be downscaled.
+ * -palette:       Palette enum value specifying which character set to use for mapping.
+ * -output:        Destination of at least (height / scale_factor) * (width / scale_factor) wchar_t.
+ * -threads:       Number of worker threads the rows are split across.
+ * -variant:       Scaler implementation to use.
+ *
+ * Same fused pass as asciify_scaled, without allocating the glyph buffer.
+ *
+ * Returns: true on success, false on memory allocation failure.
+ */
+bool asciify_scaled_into(AsciiImageObject* sample, int scale_factor, Palette palette, wchar_t* output, int threads, LanczosVariant variant){
+	FusedJob job;
+
+	job.map		= glyph_map(palette);
+	job.output	= output;
+	job.colors	= NULL;
+
+	return lanczos_scale_rows(sample, scale_factor, threads, variant, fused_row_sink, &job);
+}
+
+/*
+ * asciify_scaled downscales an image and converts it to ASCII in a single fused pass.
+ * -sample:        Source image; only original_image is read.
+ * -scale_factor:  Integer factor by which the image will be downscaled.
+ * -palette:       Palette enum value specifying which character set to use for mapping.
+ * -threads:       Number of worker threads the rows are split across.
+ * -variant:       Scaler implementation to use.
+ *
+ * Equivalent to asciify_image(lanczos_scale(...)), but every scaled row is turned into
+ * glyphs while it is still in cache: the scaled RGBA image is never allocated and the
+ * second pass over it disappears. Use the unfused functions when the scaled pixels are
+ * needed themselves.
+ *
+ * Returns: Pointer to a newly allocated buffer of (height / scale_factor) * (width / scale_factor)
+ *          glyphs on success, or NULL on failure. The caller is responsible for freeing it.
+ */
+wchar_t* asciify_scaled(AsciiImageObject* sample, int scale_factor, Palette palette, int threads, LanczosVariant variant){
+	size_t cells = (size_t) (sample->height / scale_factor) * (size_t) (sample->width / scale_factor);
+	wchar_t* output = malloc((cells ? cells : 1) * sizeof(wchar_t));
+
+	if(!output) return NULL;
+
+	if(!asciify_scaled_into(sample, scale_factor, palette, output, threads, variant)){
+		free(output);
+		return NULL;
+	}
+
+	return output;
+}
+
+/*
+ * resample_resolve_filter maps RESAMPLE_AUTO to the filter used for a scale factor.
+ */
+ResampleFilter resample_resolve_filter(ResampleFilter filter, double scale){
+	if(filter != RESAMPLE_AUTO) return filter;
+	return (scale >= BOX_AUTO_SCALE) ? RESAMPLE_BOX : RESAMPLE_LANCZOS;
+}
+
+/*
+ * resample_rows scales an image to an explicit size with a resolved filter, handing each row to a sink.
+ * -sample:          Source image; its pyramid is extended if a missing level is needed.
+ * -width, height:   Output size, at most the size of the image.
+ * -threads:         Number of worker threads the rows are split across.
+ * -variant:         Lanczos implementation to use.
+ * -filter:          RESAMPLE_LANCZOS or RESAMPLE_BOX.
+ * -pyramid:         Resample Lanczos from the nearest pyramid level instead of original_image.
+ * -sink, context:   Row consumer, as in lanczos_resize_rows.
+ *
+ * Returns: true on success, false on memory allocation failure.
+ */
+static bool resample_rows(AsciiImageObject* sample, int width, int height, int threads, LanczosVariant variant,
+		ResampleFilter filter, bool pyramid, LanczosRowSink sink, void* context){
+	if(filter == RESAMPLE_BOX) return box_resize_rows(sample, width, height, threads, sink, context);
+
+	int level = pyramid ? pyramid_level_for(sample, width, height) : 0;
+	AsciiImageObject view;
+
+	if(!pyramid_build(sample, level, threads, variant)) return false;
+	pyramid_view(sample, level, &view);
+	return lanczos_resize_rows(&view, width, height, threads, variant, sink, context);
+}
+
+/*
+ * asciify_resampled_into downscales an image by any factor and converts it to ASCII into caller-provided buffers.
+ * -sample:    Source image; its pyramid is extended if a missing level is needed.
+ * -scale:     Downscale factor, at least 1; may be fractional.
+ * -palette:   Palette enum value specifying which character set to use for mapping.
+ * -output:    Destination of resample_size(height, scale) * resample_size(width, scale) glyphs.
+ * -colors:    Optional destination of one scaled pixel per glyph, or NULL.
+ * -threads:   Number of worker threads the rows are split across.
+ * -variant:   Lanczos implementation to use.
+ * -filter:    Resampling filter, RESAMPLE_AUTO picks one from the scale.
+ * -pyramid:   Resample Lanczos from the nearest pyramid level instead of original_image.
+ *
+ * Scaling and glyph mapping run as a single fused pass, without allocating, so a
+ * sequence of frames can be rendered into the same buffers. With an integer scale,
+ * the Lanczos filter and no pyramid the glyphs are exactly those of asciify_scaled.
+ *
+ * - The box filter averages every source pixel of a cell through a summed-area table,
+ *   so nothing aliases and each cell costs O(1) whatever the scale.
+ * - The pyramid starts Lanczos from the deepest 2x reduction still at least as large
+ *   as the output, so once the level exists the cost depends on the output size only.
+ *   The pixels differ slightly from the direct path for scales of 2 and above.
+ *
+ * Returns: true on success, false on memory allocation failure.
+ */
+bool asciify_resampled_into(AsciiImageObject* sample, double scale, Palette palette, wchar_t* output, Pixel* colors,
+		int threads, LanczosVariant variant, ResampleFilter filter, bool pyramid){
+	FusedJob job;
+
+	job.map		= glyph_map(palette);
+	job.output	= output;
+	job.colors	= colors;
+
+	return resample_rows(sample, resample_size(sample->width, scale), resample_size(sample->height, scale), threads, variant,
+			     resample_resolve_filter(filter, scale), pyramid, fused_row_sink, &job);
+}
+
+/*
+ * ShapeJob state shared by the row sink and the cell bands of asciify_shapes_into.
+ * - map:            Shape table of the palette.
+ * - sub_width:      Width of the sub-cell grid.
+ * - sub_height:     Height of the sub-cell grid.
+ * - rows_total:     Number of sub-cell rows the cells stand for, rows * SHAPE_ROWS.
+ * - subgrid:        Scaled sub-cell pixels, sub_width * sub_height.
+ * - cols:           Number of cells per row.
+ * - output:         Destination glyph buffer.
+ * - colors:         Optional destination of the mean colour of every cell, or NULL.
+ */
+typedef struct ShapeJob{
+	const ShapeMap* map;
+	int sub_width, sub_height;
+	int rows_total;
+	Pixel* subgrid;
+	int cols;
+	wchar_t* output;
+	Pixel* colors;
+} ShapeJob;
+
+/*
+ * shape_row_sink stores one freshly scaled row of sub-cells.
+ */
+static void shape_row_sink(void* context, int row, const Pixel* pixels, int width){
+	ShapeJob* job = (ShapeJob*) context;
+	memcpy(job->subgrid + (size_t) row * width, pixels, (size_t) width * sizeof(Pixel));
+}
+
+/*
+ * shape_band maps cell rows [row_begin, row_end) of a ShapeJob to glyphs.
+ *
+ * Sub-cell k of a cell is the nearest sub-grid pixel, which is the pixel itself
+ * unless the image is smaller than SHAPE_COLS x SHAPE_ROWS pixels per cell.
+ */
+static void shape_band(void* context, int row_begin, int row_end){
+	ShapeJob* job = (ShapeJob*) context;
+	const GlyphMap* glyphs = job->map->glyphs;
+	int cols = job->cols;
+
+	for(int row = row_begin; row < row_end; row++){
+		const Pixel* sub_rows[SHAPE_ROWS];
+		for(int sub = 0; sub < SHAPE_ROWS; sub++){
+			int y = (int) ((int64_t) (row * SHAPE_ROWS + sub) * job->sub_height / job->rows_total);
+			sub_rows[sub] = job->subgrid + (size_t) y * job->sub_width;
+		}
+
+		for(int col = 0; col < cols; col++){
+			uint32_t luma[SHAPE_CELLS], sums[4] = { 0, 0, 0, 0 };
+			Pixel mean;
+
+			for(int k = 0; k < SHAPE_CELLS; k++){
+				int x = (int) ((int64_t) (col * SHAPE_COLS + k % SHAPE_COLS) * job->sub_width / (cols * SHAPE_COLS));
+				Pixel pixel = sub_rows[k / SHAPE_COLS][x];
+
+				luma[k] = shape_luma(glyphs, pixel);
+				sums[0] += pixel.red;
+				sums[1] += pixel.green;
+				sums[2] += pixel.blue;
+				sums[3] += pixel.alpha;
+			}
+
+			mean.red	= (uint8_t) ((sums[0] + SHAPE_CELLS / 2) / SHAPE_CELLS);
+			mean.green	= (uint8_t) ((sums[1] + SHAPE_CELLS / 2) / SHAPE_CELLS);
+			mean.blue	= (uint8_t) ((sums[2] + SHAPE_CELLS / 2) / SHAPE_CELLS);
+			mean.alpha	= (uint8_t) ((sums[3] + SHAPE_CELLS / 2) / SHAPE_CELLS);
+
+			job->output[(size_t) row * cols + col] = shape_lookup(job->map, luma, mean);
+			if(job->colors) job->colors[(size_t) row * cols + col] = mean;
+		}
+	}
+}
+
+/*
+ * asciify_shapes_into downscales an image and picks every glyph by the shape of its cell.
+ * -sample:    Source image; its pyramid is extended if a missing level is needed.
+ * -scale:     Downscale factor, at least 1; may be fractional.
+ * -palette:   Palette enum value specifying which character set to use for mapping.
+ * -output:    Destination of resample_size(height, scale) * resample_size(width, scale) glyphs.
+ * -colors:    Optional destination of the mean colour of every cell, or NULL.
+ * -threads, variant, filter, pyramid: As in asciify_resampled_into.
+ * -arena:     Arena the sub-cell grid is carved from, or NULL for the heap.
+ *
+ * Same frame as asciify_resampled_into, but the image is resampled to SHAPE_COLS x
+ * SHAPE_ROWS sub-cells per cell and each cell goes through shape_lookup: one table
+ * load more than the brightness mapping, and flat cells keep their brightness glyph.
+ *
+ * Returns: true on success, false on memory allocation failure.
+ */
+bool asciify_shapes_into(AsciiImageObject* sample, double scale, Palette palette, wchar_t* output, Pixel* colors,
+		int threads, LanczosVariant variant, ResampleFilter filter, bool pyramid, Arena* arena){
+	int rows	= resample_size(sample->height, scale);
+	int cols	= resample_size(sample->width, scale);
+	ShapeJob job;
+
+	if(rows <= 0 || cols <= 0) return true;
+
+	job.map		= shape_map(palette);
+	job.sub_width	= cols * SHAPE_COLS < sample->width ? cols * SHAPE_COLS : sample->width;
+	job.sub_height	= rows * SHAPE_ROWS < sample->height ? rows * SHAPE_ROWS : sample->height;
+	job.rows_total	= rows * SHAPE_ROWS;
+	job.cols	= cols;
+	job.output	= output;
+	job.colors	= colors;
+	job.subgrid	= arena_alloc(arena, (size_t) job.sub_width * job.sub_height * sizeof(Pixel));
+
+	if(!job.subgrid ||
+	   !resample_rows(sample, job.sub_width, job.sub_height, threads, variant,
+			  resample_resolve_filter(filter, (double) sample->width / job.sub_width), pyramid, shape_row_sink, &job)){
+		arena_free(arena, job.subgrid);
+		return false;
+	}
+
+	parallel_rows(rows, threads, shape_band, &job);
+	arena_free(arena, job.subgrid);
+	return true;
+}
+
+/*
+ * Braille dot numbering: bit of the left and right dot of each of the four rows of a
+ * cell. U+2800 + mask is the pattern with those dots raised.
+ */
+static const uint8_t dots_left_bit[DOTS_CELL_HEIGHT]	= { 0, 1, 2, 6 };
+static const uint8_t dots_right_bit[DOTS_CELL_HEIGHT]	= { 3, 4, 5, 7 };
+
+/*
+ * DotsJob state shared by the row sink of asciify_dots.
+ * - map:        Luminance tables; only the channel tables are used.
+ * - threshold:  Luminance, in LUMA_BITS fixed point, below which a dot is raised.
+ * - cells:      Number of cells per row.
+ * - rows:       One row of cells bytes per dot row; each holds the two dots of that row.
+ * - sums:       Optional per dot row, per cell channel sums of the two pixels of that row, or NULL.
+ */
+typedef struct DotsJob{
+	const GlyphMap* map;
+	uint32_t threshold;
+	int cells;
+	uint8_t* rows;
+	uint16_t (*sums)[4];
+} DotsJob;
+
+/*
+ * dot_raised returns 1 if a pixel is darker than the threshold, 0 otherwise, without a branch.
+ */
+static inline uint8_t dot_raised(const DotsJob* job, Pixel pixel){
+	const uint32_t (*luma)[256] = job->map->luma;
+	return (uint8_t) (luma[0][pixel.red] + luma[1][pixel.green] + luma[2][pixel.blue] < job->threshold);
+}
+
+/*
+ * dots_row_sink thresholds one freshly scaled row into the dot bits of its cells.
+ *
+ * Every dot row has its own byte row, so the concurrent sinks never write the same
+ * byte; the four rows of a cell are merged once all of them are done.
+ */
+static void dots_row_sink(void* context, int row, const Pixel* pixels, int width){
+	DotsJob* job = (DotsJob*) context;
+	uint8_t* bits = job->rows + (size_t) row * job->cells;
+	int left = dots_left_bit[row % DOTS_CELL_HEIGHT], right = dots_right_bit[row % DOTS_CELL_HEIGHT];
+
+	for(int cell = 0; cell < width / 2; cell++)
+		bits[cell] = (uint8_t) (dot_raised(job, pixels[2 * cell]) << left | dot_raised(job, pixels[2 * cell + 1]) << right);
+
+	if(width & 1) bits[width / 2] = (uint8_t) (dot_raised(job, pixels[width - 1]) << left);
+
+	if(job->sums){
+		uint16_t (*sums)[4] = job->sums + (size_t) row * job->cells;
 		for(int col = 0; col < width; col++){
-			double pixel_grey_level = greyscale_converter(image[row * width + col]);
-			pixel_grey_level = (pixel_grey_level < 0) ? 0 : (pixel_grey_level > 1) ? 1 : pixel_grey_level;
-			int palette_index = (int) (pixel_grey_level * (double)(palette_size - 1));
-			asciified_image[row * width + col] = palette_string[palette_index];
+			const uint8_t* channels = (const uint8_t*) &pixels[col];
+			for(int c = 0; c < 4; c++) sums[col / 2][c] += channels[c];
 		}
 	}
+}
 
-	return asciified_image;
+/*
+ * asciify_dots downscales an image and converts it to Braille dot patterns, 2x4 pixels per cell.
+ * -sample:     Source image; its pyramid is extended if a missing level is needed.
+ * -scale:      Downscale factor of the dot grid, at least 1; may be fractional.
+ * -threads:    Number of worker threads the rows are split across.
+ * -variant:    Lanczos implementation to use.
+ * -filter:     Resampling filter, RESAMPLE_AUTO picks one from the scale.
+ * -pyramid:    Resample Lanczos from the nearest pyramid level instead of original_image.
+ * -threshold:  8-bit luminance below which a dot is raised, like the dark end of the BRAILLE palette.
+ * -colors:     Optional destination of the mean colour of every cell, or NULL.
+ * -arena:      Arena the masks and the dot rows are carved from, or NULL for the heap.
+ *
+ * The image is resampled to resample_size(width, scale) x resample_size(height, scale)
+ * dots, and each 2x4 block of dots becomes one cell: 8 times the detail of the palettes
+ * for the same number of characters. Dots past the right or bottom edge stay lowered.
+ *
+ * Returns: Pointer to a newly allocated buffer of dots_cells(height, DOTS_CELL_HEIGHT) *
+ *          dots_cells(width, DOTS_CELL_WIDTH) masks, bit k set for Braille dot k + 1,
+ *          or NULL on failure. Release it with arena_free(arena, masks).
+ */
+uint8_t* asciify_dots(AsciiImageObject* sample, double scale, int threads, LanczosVariant variant,
+		ResampleFilter filter, bool pyramid, int threshold, Pixel* colors, Arena* arena){
+	int height	= resample_size(sample->height, scale);
+	int width	= resample_size(sample->width, scale);
+	int rows	= dots_cells(height, DOTS_CELL_HEIGHT);
+	size_t cells	= (size_t) dots_cells(width, DOTS_CELL_WIDTH);
+	size_t dots	= (size_t) rows * DOTS_CELL_HEIGHT * cells;
+	uint8_t* masks	= arena_alloc(arena, rows * cells);
+	DotsJob job;
+
+	job.map		= glyph_map(BRAILLE);
+	job.threshold	= (uint32_t) threshold << (LUMA_BITS - 8);
+	job.cells	= (int) cells;
+	job.rows	= arena_alloc(arena, dots);
+	job.sums	= colors ? arena_alloc(arena, dots * sizeof(*job.sums)) : NULL;
+	if(job.rows) memset(job.rows, 0, dots);
+	if(job.sums) memset(job.sums, 0, dots * sizeof(*job.sums));
+
+	if(!masks || !job.rows || (colors && !job.sums) ||
+	   !resample_rows(sample, width, height, threads, variant, resample_resolve_filter(filter, scale), pyramid, dots_row_sink, &job)){
+		arena_free(arena, masks);
+		arena_free(arena, job.rows);
+		arena_free(arena, job.sums);
+		return NULL;
+	}
+
+	for(int row = 0; row < rows; row++){
+		const uint8_t* bits = job.rows + (size_t) row * DOTS_CELL_HEIGHT * cells;
+		uint8_t* mask = masks + (size_t) row * cells;
+
+		for(size_t cell = 0; cell < cells; cell++)
+			mask[cell] = bits[cell] | bits[cells + cell] | bits[2 * cells + cell] | bits[3 * cells + cell];
+
+		if(!colors) continue;
+
+		// Cells on the right and bottom edges may cover fewer than 2x4 dots
+		const uint16_t (*sums)[4] = job.sums + (size_t) row * DOTS_CELL_HEIGHT * cells;
+		int dot_rows = height - row * DOTS_CELL_HEIGHT;
+		dot_rows = dot_rows < DOTS_CELL_HEIGHT ? dot_rows : DOTS_CELL_HEIGHT;
+
+		for(size_t cell = 0; cell < cells; cell++){
+			int dot_cols = width - (int) cell * DOTS_CELL_WIDTH;
+			uint32_t count = (uint32_t) dot_rows * (uint32_t) (dot_cols < DOTS_CELL_WIDTH ? dot_cols : DOTS_CELL_WIDTH);
+			uint8_t* color = (uint8_t*) &colors[(size_t) row * cells + cell];
+
+			for(int c = 0; c < 4; c++){
+				uint32_t sum = 0;
+				for(int dot_row = 0; dot_row < DOTS_CELL_HEIGHT; dot_row++) sum += sums[(size_t) dot_row * cells + cell][c];
+				color[c] = (uint8_t) ((sum + count / 2) / count);
+			}
+		}
+	}
+
+	arena_free(arena, job.rows);
+	arena_free(arena, job.sums);
+	return masks;
 }
@@ -0,0 +1,344 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cache.h"
+
+#define CACHE_HASH_SEED 0xCBF29CE484222325ULL
+#define CACHE_HASH_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+/*
+ * cache_default_dir returns the default render cache directory.
+ *
+ * $XDG_CACHE_HOME/yascii, or $HOME/.cache/yascii when XDG_CACHE_HOME is unset or empty.
+ *
+ * Returns: A newly allocated path, or NULL if neither variable is set or on allocation failure.
+ */
+char* cache_default_dir(void){
+	const char* base = getenv("XDG_CACHE_HOME");
+	const char* suffix = "";
+
+	if(!base || !*base){
+		base = getenv("HOME");
+		suffix = "/.cache";
+		if(!base || !*base) return NULL;
+	}
+
+	size_t size = strlen(base) + strlen(suffix) + 1 + sizeof(CACHE_DIRECTORY_NAME);
+	char* path = (char*) malloc(size);
+
+	if(path) snprintf(path, size, "%s%s/%s", base, suffix, CACHE_DIRECTORY_NAME);
+	return path;
+}
+
+/*
+ * cache_hash_mix folds the high half of the state into the low half and multiplies it again.
+ *
+ * A multiply only carries upward, so without the shift bit k of the state would depend on
+ * bits 0..k of the input alone. With it every input bit reaches every state bit within
+ * two words.
+ */
+static inline uint64_t cache_hash_mix(uint64_t hash){
+	hash ^= hash >> 32;
+	hash *= CACHE_HASH_MULTIPLIER;
+	hash ^= hash >> 29;
+	return hash;
+}
+
+/*
+ * cache_hash computes a 64-bit multiply-xorshift hash over a memory block.
+ * - seed:    Previous hash value, chaining several blocks into one key.
+ * - bytes:   Data to hash.
+ * - length:  Number of bytes.
+ *
+ * The block is consumed eight bytes per multiply, which keeps hashing an input image
+ * far below the cost of decoding it. The tail and the length are folded in last, and a
+ * final round of mixing lets a change anywhere in the block flip about half the bits.
+ *
+ * Returns: The updated hash.
+ */
+uint64_t cache_hash(uint64_t seed, const void* bytes, size_t length){
+	const unsigned char* data = (const unsigned char*) bytes;
+	uint64_t hash = seed;
+	size_t i = 0;
+
+	for(; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)){
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		hash = cache_hash_mix(hash ^ word);
+	}
+
+	uint64_t tail = 0;
+	memcpy(&tail, data + i, length - i);
+	hash = cache_hash_mix(hash ^ tail);
+	hash = cache_hash_mix(hash ^ (uint64_t) length);
+
+	return cache_hash_mix(hash);
+}
+
+/*
+ * cache_key computes the render cache key of an input file.
+ * - input_path:   Path of the input image.
+ * - parameters:   Every rendering parameter that changes the output.
+ * - size:         Size of parameters in bytes.
+ * - key:          Receives the key.
+ *
+ * The key covers the file size and content rather than its path or mtime, so a copied,
+ * moved or re-checked-out image still hits and an edited one never serves stale output.
+ *
+ * Returns: false if the file cannot be read.
+ */
+bool cache_key(const char* input_path, const void* parameters, size_t size, uint64_t* key){
+	int fd = open(input_path, O_RDONLY);
+	if(fd < 0) return false;
+
+	struct stat info;
+	if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)){
+		close(fd);
+		return false;
+	}
+
+	uint64_t file_size = (uint64_t) info.st_size;
+	uint64_t hash = cache_hash(CACHE_HASH_SEED, parameters, size);
+	hash = cache_hash(hash, &file_size, sizeof(file_size));
+
+	if(info.st_size > 0){
+		void* content = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(content == MAP_FAILED){
+			close(fd);
+			return false;
+		}
+		hash = cache_hash(hash, content, (size_t) info.st_size);
+		munmap(content, (size_t) info.st_size);
+	}
+
+	close(fd);
+	*key = hash;
+	return true;
+}
+
+/*
+ * cache_entry_path builds <directory>/<key as 16 hex digits>.txt
+ *
+ * Returns: A newly allocated string, or NULL on allocation failure.
+ */
+char* cache_entry_path(const char* directory, uint64_t key){
+	size_t size = strlen(directory) + sizeof("/0123456789abcdef.txt");
+	char* path = (char*) malloc(size);
+
+	if(path) snprintf(path, size, "%s/%016llx.txt", directory, (unsigned long long) key);
+	return path;
+}
+
+/*
+ * cache_send writes a cache entry to an OutputBuffer.
+ * - entry_path:  Path of the cache entry.
+ * - out:         Destination buffer.
+ *
+ * The entry is mapped and handed to output_write, which passes blocks larger than its
+ * buffer straight to write(): a hit costs one open, one mmap and one write.
+ *
+ * Returns: false if the entry does not exist (a cache miss) or cannot be mapped.
+ */
+bool cache_send(const char* entry_path, OutputBuffer* out){
+	int fd = open(entry_path, O_RDONLY);
+	if(fd < 0) return false;
+
+	struct stat info;
+	if(fstat(fd, &info) != 0){
+		close(fd);
+		return false;
+	}
+
+	if(info.st_size > 0){
+		void* content = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(content == MAP_FAILED){
+			close(fd);
+			return false;
+		}
+		output_write(out, content, (size_t) info.st_size);
+		munmap(content, (size_t) info.st_size);
+	}
+
+	close(fd);
+	return true;
+}
+
+/*
+ * make_directories creates a directory and its missing parents, like mkdir -p.
+ *
+ * Returns: false if a component cannot be created.
+ */
+static bool make_directories(const char* directory){
+	char* path = strdup(directory);
+	if(!path) return false;
+
+	for(char* cursor = path + 1; *cursor; cursor++){
+		if(*cursor != '/') continue;
+		*cursor = '\0';
+		if(mkdir(path, 0755) != 0 && errno != EEXIST){
+			free(path);
+			return false;
+		}
+		*cursor = '/';
+	}
+
+	bool result = mkdir(path, 0755) == 0 || errno == EEXIST;
+	free(path);
+	return result;
+}
+
+/*
+ * cache_create opens a new temporary file inside the cache directory, creating the directory if needed.
+ * - directory:   Cache directory.
+ * - temp_path:   Receives the newly allocated path of the temporary file.
+ *
+ * The temporary file lives next to the entries so cache_commit is a same-filesystem rename.
+ *
+ * Returns: The file descriptor, or -1 on failure.
+ */
+int cache_create(const char* directory, char** temp_path){
+	if(!make_directories(directory)) return -1;
+
+	size_t size = strlen(directory) + sizeof("/.render-XXXXXX");
+	char* path = (char*) malloc(size);
+	if(!path) return -1;
+	snprintf(path, size, "%s/.render-XXXXXX", directory);
+
+	int fd = mkstemp(path);
+	if(fd < 0){
+		free(path);
+		return -1;
+	}
+
+	*temp_path = path;
+	return fd;
+}
+
+/*
+ * cache_commit atomically publishes a fully written temporary file as a cache entry.
+ *
+ * Readers therefore see either no entry or a complete one, even with concurrent
+ * renders of the same image.
+ *
+ * Returns: false if the rename failed; the temporary file is removed either way.
+ */
+bool cache_commit(char* temp_path, const char* entry_path){
+	bool result = rename(temp_path, entry_path) == 0;
+
+	if(!result) unlink(temp_path);
+	free(temp_path);
+	return result;
+}
+
+/*
+ * cache_touch marks a cache entry as just used, so pruning removes it last.
+ *
+ * Entries are never rewritten once committed, so their mtime is free to record the
+ * last hit. A failure only makes the entry look older than it is.
+ */
+void cache_touch(const char* entry_path){
+	utimensat(AT_FDCWD, entry_path, NULL, 0);
+}
+
+/*
+ * CacheEntry one file found by cache_prune.
+ * - name:      File name inside the cache directory.
+ * - size:      Size in bytes.
+ * - used:      Time of the last commit or hit.
+ */
+typedef struct CacheEntry{
+	char name[sizeof("0123456789abcdef.txt")];
+	uint64_t size;
+	struct timespec used;
+} CacheEntry;
+
+/*
+ * cache_entry_name tells whether a file name is that of a cache entry: 16 hex digits and ".txt".
+ */
+static bool cache_entry_name(const char* name){
+	return strlen(name) == sizeof("0123456789abcdef.txt") - 1 && strspn(name, "0123456789abcdef") == 16 &&
+	       strcmp(name + 16, ".txt") == 0;
+}
+
+static int compare_entry_age(const void* a, const void* b){
+	const struct timespec* left	= &((const CacheEntry*) a)->used;
+	const struct timespec* right	= &((const CacheEntry*) b)->used;
+
+	if(left->tv_sec != right->tv_sec) return left->tv_sec < right->tv_sec ? -1 : 1;
+	return (left->tv_nsec > right->tv_nsec) - (left->tv_nsec < right->tv_nsec);
+}
+
+/*
+ * cache_prune removes the least recently used entries until the cache fits a size budget.
+ * - directory:   Cache directory.
+ * - max_size:    Budget, in bytes, for every entry together.
+ *
+ * Only files named like entries are counted and removed. Called after every commit,
+ * so the directory is scanned once per cache miss and never on a hit. Concurrent
+ * prunes are harmless: an entry removed twice is simply gone, and one being sent
+ * stays readable through its open descriptor.
+ */
+void cache_prune(const char* directory, uint64_t max_size){
+	DIR* listing = opendir(directory);
+	if(!listing) return;
+
+	int dir_fd = dirfd(listing);
+	CacheEntry* entries = NULL;
+	size_t count = 0, capacity = 0;
+	uint64_t total = 0;
+	struct dirent* item;
+
+	while((item = readdir(listing)) != NULL){
+		struct stat info;
+		if(!cache_entry_name(item->d_name) || fstatat(dir_fd, item->d_name, &info, 0) != 0 || !S_ISREG(info.st_mode)) continue;
+
+		if(count == capacity){
+			size_t grown = capacity ? capacity * 2 : 64;
+			CacheEntry* resized = (CacheEntry*) realloc(entries, grown * sizeof(CacheEntry));
+			if(!resized) break;
+			entries		= resized;
+			capacity	= grown;
+		}
+
+		memcpy(entries[count].name, item->d_name, sizeof(entries[count].name));
+		entries[count].size	= (uint64_t) info.st_size;
+		entries[count].used	= info.st_mtim;
+		total += entries[count].size;
+		count++;
+	}
+
+	if(total > max_size){
+		qsort(entries, count, sizeof(CacheEntry), compare_entry_age);
+		for(size_t i = 0; i < count && total > max_size; i++){
+			if(unlinkat(dir_fd, entries[i].name, 0) == 0 || errno == ENOENT) total -= entries[i].size;
+		}
+	}
+
+	free(entries);
+	closedir(listing);
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <png.h>
+#include "decoder.h"
+#include "pyramid.h"
+
+/*
+ * array_mapping Computes the linear index in a 1D array from 2D matrix coordinates.
+ * - row :  The row index of the element.
+ * - col :  The column index of the element.
+ * - cols:  The total number of columns in the matrix.
+ *
+ * This function implements the standard row-major bijection from N^2 to N,
+ * mapping a finite 2D matrix into a 1D array.
+ *
+ * Returns: The linear index corresponding to the (row, col) coordinates.
+ */
+static inline int array_mapping(int row, int col, int cols){
+	return (row * cols) + col;
+}
+
+/*
+ * png_normalize_format registers the libpng transformations that turn every pixel into 8-bit RGBA.
+ * - png_ptr:    A pointer to the libpng read struct.
+ * - info_ptr:   A pointer to the libpng info struct, already filled by png_read_info.
+ *
+ * Interlace handling and png_read_update_info are left to the caller.
+ */
+static void png_normalize_format(png_structp png_ptr, png_infop info_ptr){
+	png_byte color_type = png_get_color_type(png_ptr, info_ptr);
+	png_byte bit_depth  = png_get_bit_depth(png_ptr, info_ptr);
+
+	//Normalization all PNG format into a RGBA 8-bit
+	if (bit_depth == 16) 					png_set_strip_16(png_ptr);
+	if (color_type == PNG_COLOR_TYPE_PALETTE)		png_set_palette_to_rgb(png_ptr);
+	if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8) png_set_expand_gray_1_2_4_to_8(png_ptr);
+	if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) 	png_set_tRNS_to_alpha(png_ptr);
+	if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA) png_set_gray_to_rgb(png_ptr);
+	if (color_type == PNG_COLOR_TYPE_RGB || color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_PALETTE)
+		png_set_filler(png_ptr, 0xFF, PNG_FILLER_AFTER);
+}
+
+/*
+ * png_normalize_rgba registers the libpng transformations that turn any PNG into 8-bit RGBA.
+ * - png_ptr:    A pointer to the libpng read struct.
+ * - info_ptr:   A pointer to the libpng info struct, already filled by png_read_info.
+ *
+ * After this call every decoded row has exactly the layout of Pixel[width].
+ * Interlace handling is turned on and png_read_update_info is called, so
+ * png_get_rowbytes reflects the normalized format.
+ *
+ * Returns: The number of passes png_read_row must be called for (1, or 7 for Adam7).
+ */
+int png_normalize_rgba(png_structp png_ptr, png_infop info_ptr){
+	png_normalize_format(png_ptr, info_ptr);
+
+	int passes = png_set_interlace_handling(png_ptr);
+	png_read_update_info(png_ptr, info_ptr);
+	return passes;
+}
+
+/*
+ * image_struct_free releases an AsciiImageObject and every buffer it owns.
+ * - image: Object to release; NULL is accepted.
+ */
+void image_struct_free(AsciiImageObject* image){
+	if(!image) return;
+	if(image->mapping) munmap(image->mapping, image->mapping_size);
+	else if(!image->borrowed) free(image->original_image);
+	free(image->edited_image);
+	free(image->ascii_image);
+	pyramid_free(image);
+	free(image);
+}
+
+/*
+ * image_struct_alloc allocates an AsciiImageObject and its RGBA buffer.
+ * - width:      The width of the image in pixels.
+ * - height:     The height of the image in pixels.
+ * - arena:      Arena the RGBA buffer is carved from, or NULL for the heap.
+ *
+ * Only `original_image` is allocated; `edited_image`, `ascii_image` and `pyramid` are left empty.
+ *
+ * Returns: A pointer to the new object, or NULL on memory allocation failure.
+ */
+AsciiImageObject* image_struct_alloc(int width, int height, Arena* arena){
+	size_t memory_size = (size_t) width * height;
+	AsciiImageObject* return_ptr = (AsciiImageObject*) calloc(1, sizeof(AsciiImageObject));
+	if(!return_ptr) return NULL;
+
+	return_ptr->original_image 	= (Pixel*) arena_alloc(arena, sizeof(Pixel) * memory_size);
+	return_ptr->edited_image 	= NULL;
+	return_ptr->ascii_image 	= NULL;
+	return_ptr->pyramid 		= NULL;
+	return_ptr->pyramid_levels 	= 0;
+	return_ptr->mapping 		= NULL;
+	return_ptr->mapping_size 	= 0;
+	return_ptr->borrowed 		= arena != NULL;
+	return_ptr->width 		= width;
+	return_ptr->height		= height;
+	return_ptr->scale 		= 1;
+
+	if(!return_ptr->original_image){
+		image_struct_free(return_ptr);
+		return NULL;
+	}
+	return return_ptr;
+}
+
+/*
+ *image_struct_init fills an AsciiImageObject with PNG image data.
+ * - image:      Object returned by image_struct_alloc with the PNG dimensions.
+ * - png_ptr:    A pointer to the libpng read struct.
+ * - info_ptr:   A pointer to the libpng info struct.
+ * 
+ * This function:
+ * - Normalizes the PNG image data to 8-bit RGBA format using libpng transformations.
+ * - Reads the pixel data into the `original_image` field as an array of `Pixel` structs.
+ *   libpng decodes straight into it, one png_read_row per row and pass: no intermediate
+ *   row buffers and no copy.
+ * 
+ * The function assumes the PNG has been properly opened and validated before calling.
+ * Allocation is kept separate so the caller owns the object before decoding starts:
+ * libpng errors longjmp out of png_read_row, and the caller's setjmp handler can then
+ * release it.
+ */
+void image_struct_init(AsciiImageObject* image, png_structp png_ptr, png_infop info_ptr){
+	int passes = png_normalize_rgba(png_ptr, info_ptr);
+
+	// After normalization each decoded row is exactly Pixel[width]: decode in place.
+	// Interlaced images revisit the same rows once per pass, libpng merges them.
+	for(int pass = 0; pass < passes; pass++)
+		for(int row = 0; row < image->height; row++)
+			png_read_row(png_ptr, (png_bytep) (image->original_image + array_mapping(row, 0, image->width)), NULL);
+}
+
+/*
+ * png_adam7_reduction returns the Adam7 lattice an interlaced PNG can be decoded on for a scale factor.
+ * - png_ptr:    A pointer to the libpng read struct, after png_read_info.
+ * - info_ptr:   A pointer to the libpng info struct.
+ * - scale:      Downscale factor the image will be rendered at.
+ *
+ * Passes 1, 1-3 and 1-5 of Adam7 hold exactly the pixels whose coordinates are
+ * multiples of 8, 4 and 2. The coarsest of those lattices that still leaves at least
+ * a 2x reduction to the scaler is used, so the picture is still filtered after the
+ * point sampling of the lattice.
+ *
+ * Returns: 8, 4 or 2 (one pixel every that many along each axis), or 1 if the whole
+ *          image must be decoded: not interlaced, or a scale below 4.
+ */
+int png_adam7_reduction(png_structp png_ptr, png_infop info_ptr, double scale){
+	int reduction = 8;
+
+	if(png_get_interlace_type(png_ptr, info_ptr) != PNG_INTERLACE_ADAM7) return 1;
+	while(reduction > 1 && reduction * 2 > scale) reduction /= 2;
+	return reduction;
+}
+
+/*
+ * image_struct_init_passes fills an AsciiImageObject with one Adam7 lattice of an interlaced PNG.
+ * - image:      Object returned by image_struct_alloc with the lattice size, ceil(width / reduction)
+ *               by ceil(height / reduction) of the PNG size.
+ * - png_ptr:    A pointer to the libpng read struct, after png_read_info.
+ * - info_ptr:   A pointer to the libpng info struct.
+ * - reduction:  Lattice step returned by png_adam7_reduction: 8, 4 or 2.
+ * - scratch:    Row buffer of at least image->width pixels.
+ *
+ * Interlace handling is left off, so png_read_row returns each pass as its own
+ * sub-image; only the passes of the lattice are read and their pixels are scattered
+ * to their place in it. Reading stops there: the rest of the compressed stream is never
+ * inflated, so time and memory both drop by about reduction^2.
+ *
+ * libpng errors longjmp out of this function: the caller owns image and scratch and must release them.
+ */
+void image_struct_init_passes(AsciiImageObject* image, png_structp png_ptr, png_infop info_ptr, int reduction, Pixel* scratch){
+	int width	= (int) png_get_image_width(png_ptr, info_ptr);
+	int height	= (int) png_get_image_height(png_ptr, info_ptr);
+	int passes	= reduction >= 8 ? 1 : reduction >= 4 ? 3 : 5;
+
+	png_normalize_format(png_ptr, info_ptr);
+	png_read_update_info(png_ptr, info_ptr);
+
+	for(int pass = 0; pass < passes; pass++){
+		int cols = (int) PNG_PASS_COLS(width, pass), rows = (int) PNG_PASS_ROWS(height, pass);
+		int x0 = PNG_PASS_START_COL(pass) / reduction, dx = PNG_PASS_COL_OFFSET(pass) / reduction;
+		int y0 = PNG_PASS_START_ROW(pass) / reduction, dy = PNG_PASS_ROW_OFFSET(pass) / reduction;
+
+		// libpng skips empty passes altogether
+		if(cols == 0 || rows == 0) continue;
+
+		for(int row = 0; row < rows; row++){
+			Pixel* destination = image->original_image + array_mapping(y0 + row * dy, 0, image->width);
+
+			png_read_row(png_ptr, (png_bytep) scratch, NULL);
+			for(int col = 0; col < cols; col++) destination[x0 + col * dx] = scratch[col];
+		}
+	}
+}
+
+/*
+ * image_struct_crop keeps the top left width x height pixels of an image, in place.
+ * - image:          Image without pyramid; its rows are packed to the new width.
+ * - width, height:  New size, at most the current one.
+ */
+void image_struct_crop(AsciiImageObject* image, int width, int height){
+	for(int row = 1; row < height && width < image->width; row++)
+		memmove(image->original_image + array_mapping(row, 0, width), image->original_image + array_mapping(row, 0, image->width),
+			sizeof(Pixel) * width);
+
+	image->width	= width;
+	image->height	= height;
+}
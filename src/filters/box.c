@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "box.h"
+#include "parallel.h"
+
+/*
+ * BoxJob state shared by every band of a box_resize_rows call.
+ * - sample:            Source image.
+ * - width, height:     Output size.
+ * - col_edges:         width + 1 source column boundaries, cell col covers [col_edges[col], col_edges[col + 1]).
+ * - row_edges:         height + 1 source row boundaries.
+ * - output:            Destination image, or NULL when rows go to sink.
+ * - sink, sink_context: Row consumer used when output is NULL.
+ * - failed:            Set by any band that could not allocate its buffers.
+ */
+typedef struct BoxJob{
+    const AsciiImageObject* sample;
+    int width, height;
+    int* col_edges;
+    int* row_edges;
+    Pixel* output;
+    LanczosRowSink sink;
+    void* sink_context;
+    atomic_bool failed;
+} BoxJob;
+
+/*
+ * box_edges splits [0, src_size) into dst_size contiguous, non-empty spans.
+ *
+ * Span boundaries are the source coordinates dst * src_size / dst_size rounded to the
+ * nearest pixel, so a fractional scale factor alternates between floor and ceil sized
+ * cells and the spans always tile the source exactly.
+ *
+ * Returns: A newly allocated array of dst_size + 1 boundaries, or NULL on allocation failure.
+ */
+static int* box_edges(int src_size, int dst_size){
+    int* edges = (int*) malloc(((size_t)dst_size + 1) * sizeof(int));
+    if(!edges) return NULL;
+
+    for(int dst = 0; dst <= dst_size; dst++)
+        edges[dst] = (int)(((int64_t)dst * src_size * 2 + dst_size) / ((int64_t)dst_size * 2));
+
+    return edges;
+}
+
+/*
+ * box_flush_lanes adds the packed 16-bit lane sums of box_scale_band to the per-channel
+ * column totals and clears them.
+ * - even, odd:     Per-column words holding bytes 0, 2 and 1, 3 of every pixel word as 16-bit lanes.
+ * - columns:       Per-column, per-channel 32-bit totals, in Pixel channel order.
+ * - src_width:     Number of columns.
+ */
+static void box_flush_lanes(uint32_t* even, uint32_t* odd, uint32_t* columns, int src_width){
+    const uint32_t probe = 1;
+    bool little_endian = *(const uint8_t*)&probe == 1;
+    // Memory offset of the byte at bits 0-7 and 8-15 of a pixel word in each lane pair.
+    int low = little_endian ? 0 : 3, step = little_endian ? 1 : -1;
+
+    for(int x = 0; x < src_width; x++){
+        uint32_t* column = columns + (size_t)x * 4;
+        column[low]            += even[x] & 0xFFFF;
+        column[low + 2 * step] += even[x] >> 16;
+        column[low + step]     += odd[x] & 0xFFFF;
+        column[low + 3 * step] += odd[x] >> 16;
+    }
+
+    memset(even, 0, (size_t)src_width * sizeof(uint32_t));
+    memset(odd, 0, (size_t)src_width * sizeof(uint32_t));
+}
+
+/*
+ * box_scale_band averages the output rows [row_begin, row_end) of a BoxJob.
+ *
+ * This is a summed-area table evaluated one strip at a time: the source rows of an
+ * output row are added into per-column totals, a running prefix over those totals is
+ * the integral of the strip, and each cell is the difference of two prefix entries.
+ * Every source pixel is read once and every cell costs O(1) whatever the scale
+ * factor, while memory stays O(width) instead of a full-image table.
+ *
+ * The vertical pass treats each pixel as one 32-bit word and adds its even and odd
+ * bytes into two words of 16-bit lanes, which the compiler vectorizes without any
+ * widening; the lanes are flushed to 32-bit totals every 256 rows, before they can
+ * overflow. Totals are unsigned 32-bit: a cell holds at most 255 * area, far below
+ * 2^32 for any image libpng can decode into memory.
+ */
+static void box_scale_band(void* context, int row_begin, int row_end){
+    BoxJob* job = (BoxJob*) context;
+    const AsciiImageObject* sample = job->sample;
+    int src_width = sample->width;
+    uint32_t* even = (uint32_t*) calloc((size_t)src_width, sizeof(uint32_t));
+    uint32_t* odd = (uint32_t*) calloc((size_t)src_width, sizeof(uint32_t));
+    uint32_t* columns = (uint32_t*) malloc((size_t)src_width * 4 * sizeof(uint32_t));
+    uint32_t* prefix = (uint32_t*) malloc(((size_t)src_width + 1) * 4 * sizeof(uint32_t));
+    Pixel* scratch = job->output ? NULL : (Pixel*) malloc((size_t)job->width * sizeof(Pixel));
+
+    if(!even || !odd || !columns || !prefix || (!job->output && !scratch)){
+        atomic_store(&job->failed, true);
+        free(even);
+        free(odd);
+        free(columns);
+        free(prefix);
+        free(scratch);
+        return;
+    }
+
+    for(int row = row_begin; row < row_end; row++){
+        int y0 = job->row_edges[row], y1 = job->row_edges[row + 1];
+
+        memset(columns, 0, (size_t)src_width * 4 * sizeof(uint32_t));
+        for(int y = y0; y < y1; y++){
+            const Pixel* src_row = sample->original_image + (size_t)y * src_width;
+            for(int x = 0; x < src_width; x++){
+                uint32_t word;
+                memcpy(&word, src_row + x, sizeof(word));
+                even[x] += word & 0x00FF00FF;
+                odd[x]  += (word >> 8) & 0x00FF00FF;
+            }
+            if((y - y0) % 256 == 255) box_flush_lanes(even, odd, columns, src_width);
+        }
+        box_flush_lanes(even, odd, columns, src_width);
+
+        memset(prefix, 0, 4 * sizeof(uint32_t));
+        for(int x = 0; x < src_width; x++)
+            for(int c = 0; c < 4; c++) prefix[(x + 1) * 4 + c] = prefix[x * 4 + c] + columns[x * 4 + c];
+
+        Pixel* dst_row = job->output ? job->output + (size_t)row * job->width : scratch;
+        for(int col = 0; col < job->width; col++){
+            int x0 = job->col_edges[col], x1 = job->col_edges[col + 1];
+            uint32_t area = (uint32_t)(x1 - x0) * (uint32_t)(y1 - y0);
+            uint32_t half = area / 2;
+            const uint32_t* right = prefix + x1 * 4;
+            const uint32_t* left = prefix + x0 * 4;
+
+            dst_row[col].red   = (uint8_t)((right[0] - left[0] + half) / area);
+            dst_row[col].green = (uint8_t)((right[1] - left[1] + half) / area);
+            dst_row[col].blue  = (uint8_t)((right[2] - left[2] + half) / area);
+            dst_row[col].alpha = (uint8_t)((right[3] - left[3] + half) / area);
+        }
+
+        if(!job->output) job->sink(job->sink_context, row, scratch, job->width);
+    }
+
+    free(even);
+    free(odd);
+    free(columns);
+    free(prefix);
+    free(scratch);
+}
+
+/*
+ * box_run_job builds the cell boundaries of a BoxJob and runs its bands.
+ * An empty output succeeds without reading the image.
+ *
+ * Returns: true on success, false on allocation failure.
+ */
+static bool box_run_job(BoxJob* job, int threads){
+    const AsciiImageObject* sample = job->sample;
+
+    // A scale larger than the image leaves no cell, and no span to divide the source into
+    if(job->width <= 0 || job->height <= 0) return true;
+
+    job->col_edges  = box_edges(sample->width, job->width);
+    job->row_edges  = box_edges(sample->height, job->height);
+    atomic_init(&job->failed, false);
+
+    if(job->col_edges && job->row_edges){
+        parallel_rows(job->height, threads, box_scale_band, job);
+    }else{
+        atomic_store(&job->failed, true);
+    }
+
+    free(job->col_edges);
+    free(job->row_edges);
+    return !atomic_load(&job->failed);
+}
+
+/*
+ * box_resize_rows downscales an image by area averaging, row by row like lanczos_scale_rows.
+ * - sample:    Pointer to an AsciiImageObject containing the original image data.
+ * - width:     Number of output columns, between 1 and sample->width.
+ * - height:    Number of output rows, between 1 and sample->height.
+ * - threads:   Number of worker threads the output rows are split across.
+ * - sink:      Callback receiving each output row as soon as it is computed.
+ * - context:   Opaque pointer forwarded to sink.
+ *
+ * Every output cell is the rounded mean of all the source pixels it covers, so nothing
+ * aliases at large scale factors and the size does not have to divide the source.
+ * The result does not depend on the number of threads.
+ *
+ * Returns: true on success, false on allocation failure.
+ */
+bool box_resize_rows(AsciiImageObject* sample, int width, int height, int threads, LanczosRowSink sink, void* context){
+    BoxJob job;
+
+    job.sample       = sample;
+    job.width        = width;
+    job.height       = height;
+    job.output       = NULL;
+    job.sink         = sink;
+    job.sink_context = context;
+
+    return box_run_job(&job, threads);
+}
+
+/*
+ * box_resize downscales an image by area averaging.
+ * - sample, width, height, threads: As in box_resize_rows.
+ *
+ * Returns: A newly allocated width * height image, or NULL on allocation failure.
+ */
+Pixel* box_resize(AsciiImageObject* sample, int width, int height, int threads){
+    BoxJob job;
+
+    job.sample       = sample;
+    job.width        = width;
+    job.height       = height;
+    job.output       = (Pixel*) malloc(((size_t)width * height + 1) * sizeof(Pixel));
+    job.sink         = NULL;
+    job.sink_context = NULL;
+
+    if(job.output && !box_run_job(&job, threads)){
+        free(job.output);
+        job.output = NULL;
+    }
+
+    return job.output;
+}
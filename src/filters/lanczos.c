@@ -16,101 +16,524 @@
  */
 
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
 #include "lanczos.h"
+#include "lanczos_simd.h"
+#include "parallel.h"
+
+#define LANCZOS_PI 3.14159265358979323846
+
+/*
+ * lanczos_set_tap appends a source coordinate and its weight, in every precision, to a tap table.
+ */
+static void lanczos_set_tap(LanczosTaps* taps, int source, double weight){
+    double weightq = weight * (1 << 14);
+
+    taps->index[taps->count]   = source;
+    taps->weight[taps->count]  = weight;
+    taps->weightf[taps->count] = (float) weight;
+    taps->weightq[taps->count] = (int16_t)(weightq < 0 ? weightq - 0.5 : weightq + 0.5);
+    taps->count++;
+}
+
+/*
+ * lanczos_phase_weight evaluates the continuous kernel at a distance from the sample point.
+ *
+ * Lanczos-2 with its argument scaled by LANCZOS_PHASE_STRETCH, so the support is
+ * +-KERNEL_RADIUS - 0.5: the SAMPLE_SIZE taps around the nearest source sample cover it
+ * whatever the phase. At integer distances it is within 0.002 of lanczos_kernel.
+ */
+static double lanczos_phase_weight(double distance){
+    double x = distance * LANCZOS_PHASE_STRETCH;
+
+    if(x == 0) return 1;
+    if(fabs(x) >= 2) return 0;
+    return 2 * sin(LANCZOS_PI * x) * sin(LANCZOS_PI * x / 2) / (LANCZOS_PI * LANCZOS_PI * x * x);
+}
+
+/*
+ * lanczos_build_taps computes the filter footprint of every output coordinate along one axis.
+ * - src_size:  Number of source samples along the axis.
+ * - dst_size:  Number of output samples along the axis.
+ *
+ * When dst_size is what an integer scale factor gives (src_size / k), each output
+ * coordinate is truncated to source coordinate dst * src_size / dst_size, and the
+ * SAMPLE_SIZE taps around it get the fixed lanczos_kernel weights.
+ *
+ * Any other ratio puts output coordinates between source samples, at a phase that
+ * changes from one coordinate to the next. The taps are then centred on the nearest
+ * source sample and weighted by lanczos_phase_weight at their real distance, normalized
+ * to sum to 1, so the samples stay evenly spaced instead of jumping by whole pixels.
+ *
+ * Weights are stored in double, float and rounded Q14 form.
+ * Taps outside [0, src_size) are skipped, which folds the zero padding into the table.
+ *
+ * return a newly allocated array of dst_size LanczosTaps, or NULL on allocation failure.
+ */
+static LanczosTaps* lanczos_build_taps(int src_size, int dst_size){
+    LanczosTaps* taps = (LanczosTaps*) malloc((dst_size > 0 ? (size_t)dst_size : 1) * sizeof(LanczosTaps));
+    if(!taps || dst_size <= 0) return taps;
+
+    // dst_size is src_size / k for an integer k whenever the scale factor is an integer
+    int factor = src_size / dst_size;
+    bool integer_ratio = factor > 0 && src_size / factor == dst_size;
+
+    for(int dst = 0; dst < dst_size; dst++){
+        double source_fp = dst * (double)src_size / dst_size;
+        double weights[SAMPLE_SIZE];
+        int source_center;
+
+        if(integer_ratio){
+            source_center = (int)source_fp;
+            memcpy(weights, lanczos_kernel, sizeof(weights));
+        }else{
+            double sum = 0;
+
+            source_center = (int)floor(source_fp + 0.5);
+            for(int k = 0; k < SAMPLE_SIZE; k++){
+                weights[k] = lanczos_phase_weight(source_center + k - KERNEL_RADIUS - source_fp);
+                sum += weights[k];
+            }
+            for(int k = 0; k < SAMPLE_SIZE; k++) weights[k] /= sum;
+        }
+
+        taps[dst].count = 0;
+        for(int k = 0; k < SAMPLE_SIZE; k++){
+            int source = source_center + k - KERNEL_RADIUS;
+            if(source < 0 || source >= src_size) continue;
+            lanczos_set_tap(&taps[dst], source, weights[k]);
+        }
+    }
+
+    return taps;
+}
+
+/*
+ * lanczos_horizontal_pass convolves a single source row along the x axis.
+ * - src_row:    Pointer to the first Pixel of the source row.
+ * - col_taps:   Per output column tap table.
+ * - width:      Number of output columns.
+ * - dst_row:    Intermediate buffer of width * 4 doubles, channels interleaved as RGBA.
+ */
+static void lanczos_horizontal_pass(const Pixel* src_row, const LanczosTaps* col_taps, int width, void* dst){
+    double* dst_row = (double*) dst;
+
+    for(int col = 0; col < width; col++){
+        const LanczosTaps* taps = &col_taps[col];
+        double red = 0, green = 0, blue = 0, alpha = 0;
+
+        for(int k = 0; k < taps->count; k++){
+            Pixel current_pixel = src_row[taps->index[k]];
+            double weight = taps->weight[k];
+            red   += weight * current_pixel.red;
+            green += weight * current_pixel.green;
+            blue  += weight * current_pixel.blue;
+            alpha += weight * current_pixel.alpha;
+        }
+
+        dst_row[col * 4 + 0] = red;
+        dst_row[col * 4 + 1] = green;
+        dst_row[col * 4 + 2] = blue;
+        dst_row[col * 4 + 3] = alpha;
+    }
+}
+
+/*
+ * clamp_channel clamps a convoluted value to the [0:255] range and truncates it to 8 bit.
+ */
+static inline uint8_t clamp_channel(double value){
+    value = (value > 255) ? 255 : (value < 0) ? 0 : value;
+    return (uint8_t) value;
+}
+
+/*
+ * lanczos_vertical_pass combines up to SAMPLE_SIZE intermediate rows into one output row.
+ * - rows:       One row of width * 4 doubles per valid tap, in tap order.
+ * - taps:       Tap table of the output row.
+ * - width:      Number of output columns.
+ * - dst_row:    Destination Pixel row.
+ */
+static void lanczos_vertical_pass(const void* const* rows, const LanczosTaps* taps, int width, Pixel* dst_row){
+    for(int col = 0; col < width; col++){
+        double red = 0, green = 0, blue = 0, alpha = 0;
+
+        for(int k = 0; k < taps->count; k++){
+            const double* value = (const double*) rows[k] + col * 4;
+            double weight = taps->weight[k];
+            red   += weight * value[0];
+            green += weight * value[1];
+            blue  += weight * value[2];
+            alpha += weight * value[3];
+        }
+
+        dst_row[col].red   = clamp_channel(red);
+        dst_row[col].green = clamp_channel(green);
+        dst_row[col].blue  = clamp_channel(blue);
+        dst_row[col].alpha = clamp_channel(alpha);
+    }
+}
+
+/*
+ * lanczos_kernels_scalar double precision reference variant.
+ */
+static const LanczosKernels lanczos_kernels_scalar = {
+    4 * sizeof(double),
+    lanczos_horizontal_pass,
+    lanczos_vertical_pass,
+};
+
+/*
+ * lanczos_variant_supported reports whether a kernel variant can run on the current CPU.
+ * - variant: Variant to check. LANCZOS_AUTO, LANCZOS_SCALAR and LANCZOS_FIXED are always supported.
+ *
+ * The SIMD variants are detected at runtime through cpuid, so a single binary built for
+ * a generic x86-64 target still uses AVX2 where available.
+ */
+bool lanczos_variant_supported(LanczosVariant variant){
+    switch(variant){
+        case LANCZOS_AUTO:
+        case LANCZOS_SCALAR:
+        case LANCZOS_FIXED:
+            return true;
+#if defined(__x86_64__) || defined(__i386__)
+        case LANCZOS_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case LANCZOS_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+/*
+ * lanczos_resolve_variant maps a requested variant to the one that will actually run.
+ * - variant: Requested variant.
+ *
+ * LANCZOS_AUTO picks the widest supported SIMD variant, or the integer variant on CPUs
+ * without one; an unsupported request falls back to the scalar reference.
+ */
+LanczosVariant lanczos_resolve_variant(LanczosVariant variant){
+    if(variant == LANCZOS_AUTO){
+        if(lanczos_variant_supported(LANCZOS_AVX2)) return LANCZOS_AVX2;
+        if(lanczos_variant_supported(LANCZOS_SSE2)) return LANCZOS_SSE2;
+        return LANCZOS_FIXED;
+    }
+    return lanczos_variant_supported(variant) ? variant : LANCZOS_SCALAR;
+}
+
+/*
+ * lanczos_select_kernels returns the passes implementing a resolved variant.
+ */
+static const LanczosKernels* lanczos_select_kernels(LanczosVariant variant){
+    switch(lanczos_resolve_variant(variant)){
+#if defined(__x86_64__) || defined(__i386__)
+        case LANCZOS_AVX2:  return &lanczos_kernels_avx2;
+        case LANCZOS_SSE2:  return &lanczos_kernels_sse2;
+#endif
+        case LANCZOS_FIXED: return &lanczos_kernels_fixed;
+        default:            return &lanczos_kernels_scalar;
+    }
+}
+
+/*
+ * lanczos_ring_rows makes sure every tap of an output row is in the intermediate ring.
+ * - kernels:       Passes of the selected variant.
+ * - taps:          Tap table of the output row.
+ * - col_taps:      Per output column tap table.
+ * - width:         Number of output columns.
+ * - ring:          SAMPLE_SIZE intermediate rows of row_bytes each.
+ * - ring_source:   Source row currently held by each ring slot, -1 if empty.
+ * - row_bytes:     Size of one intermediate row.
+ * - source_image:  First Pixel of the source image.
+ * - source_width:  Width of the source image.
+ * - rows:          Filled with one intermediate row pointer per tap.
+ *
+ * The taps of one output row are SAMPLE_SIZE consecutive source rows, so source % SAMPLE_SIZE
+ * never collides and rows already filtered for the previous output row are reused.
+ */
+static void lanczos_ring_rows(const LanczosKernels* kernels, const LanczosTaps* taps, const LanczosTaps* col_taps, int width,
+                              unsigned char* ring, int* ring_source, size_t row_bytes,
+                              const Pixel* source_image, int source_width, const void** rows){
+    for(int k = 0; k < taps->count; k++){
+        int source = taps->index[k];
+        int slot = source % SAMPLE_SIZE;
+        unsigned char* slot_row = ring + (size_t)slot * row_bytes;
+
+        if(ring_source[slot] != source){
+            kernels->horizontal(source_image + (size_t)source * source_width, col_taps, width, slot_row);
+            ring_source[slot] = source;
+        }
+        rows[k] = slot_row;
+    }
+}
 
 /*
-* lanczos_point_convulution applies the 2D convultion to the sample matrix
-* - sample_matrix: Pointer to a flattened 2D matrix of size SAMPLE_SIZE x SAMPLE_SIZE holding the neighbours
-*                  of the target pixel
-*
-* This function perform a separable 2D convolution using the precomputed Lanczos Kenrnel by doing the following:
-* 1. For each row compute the 1D convultion with the Kenrnel
-* 2. applies the 1D convultion on each convulted value using the same kernel
-*
-* This assumes both lanczos_kern and sample_matrix have consistent dimesnion with SAMPLE_SIZE
-*
-* return the scalar valure from the 2D convultion of the given point
-*/
-static double lanczos_point_convulution(double* sample_matrix){
-    double convoluted_value = 0; 
-
-    for(int row = 0; row < SAMPLE_SIZE; row++){
-        double temp_convoluted_row=0;
-        for(int col = 0; col < SAMPLE_SIZE; col++){
-            temp_convoluted_row += lanczos_kernel[col] * sample_matrix[row * SAMPLE_SIZE + col];
+ * lanczos_scale_band produces output rows [row_begin, row_end) of a LanczosJob.
+ *
+ * Every band owns a private ring buffer of SAMPLE_SIZE horizontally filtered source rows,
+ * so bands share nothing but read-only inputs and write disjoint output rows.
+ */
+static void lanczos_scale_band(void* context, int row_begin, int row_end){
+    LanczosJob* job = (LanczosJob*) context;
+    const AsciiImageObject* sample = job->sample;
+    int width = job->width;
+    size_t row_bytes = (size_t)width * job->kernels->sample_bytes;
+    unsigned char* ring = (unsigned char*) malloc(SAMPLE_SIZE * row_bytes);
+    Pixel* scratch = job->output ? NULL : (Pixel*) malloc((size_t)width * sizeof(Pixel));
+    int ring_source[SAMPLE_SIZE];
+
+    if(!ring || (!job->output && !scratch)){
+        atomic_store(&job->failed, true);
+        free(ring);
+        free(scratch);
+        return;
+    }
+
+    for(int slot = 0; slot < SAMPLE_SIZE; slot++) ring_source[slot] = -1;
+
+    for(int row = row_begin; row < row_end; row++){
+        const LanczosTaps* taps = &job->row_taps[row];
+        const void* rows[SAMPLE_SIZE];
+
+        lanczos_ring_rows(job->kernels, taps, job->col_taps, width, ring, ring_source, row_bytes,
+                          sample->original_image, sample->width, rows);
+
+        if(job->output){
+            job->kernels->vertical(rows, taps, width, job->output + (size_t)row * width);
+        }else{
+            job->kernels->vertical(rows, taps, width, scratch);
+            job->sink(job->sink_context, row, scratch, width);
         }
-        convoluted_value += lanczos_kernel[row] * temp_convoluted_row;
     }
-    
-    return convoluted_value;
+
+    free(ring);
+    free(scratch);
+}
+
+/*
+ * lanczos_run_job builds the tap tables of a LanczosJob and runs its bands.
+ * - job:           Job with sample, kernels and either output or sink already set.
+ * - width:         Number of output columns.
+ * - height:        Number of output rows.
+ * - threads:       Number of worker threads the output rows are split across.
+ *
+ * Returns: true on success, false on allocation failure.
+ */
+static bool lanczos_run_job(LanczosJob* job, int width, int height, int threads){
+    const AsciiImageObject* sample = job->sample;
+    LanczosTaps* row_taps = lanczos_build_taps(sample->height, height);
+    LanczosTaps* col_taps = lanczos_build_taps(sample->width, width);
+
+    job->width      = width;
+    job->row_taps   = row_taps;
+    job->col_taps   = col_taps;
+    atomic_init(&job->failed, false);
+
+    if(row_taps && col_taps){
+        parallel_rows(height, threads, lanczos_scale_band, job);
+    }else{
+        atomic_store(&job->failed, true);
+    }
+
+    free(row_taps);
+    free(col_taps);
+    return !atomic_load(&job->failed);
 }
 
 /*
  * lanczos_scale rescale an image using Lanczos interpolation.
  * - sample:        Pointer to an AsciiImageObject containing the original image data.
  * - scale_factor:  Integer factor by which the image will be downscaled.
+ * - threads:       Number of worker threads the output rows are split across.
+ * - variant:       Kernel implementation to use, resolved through lanczos_resolve_variant.
  *
- * The function perform a downscaling of an RGBA image using separable Lanczos lanczos_point_convulution
- * 1. Allocate new buffer of Pixel structures to store the rescaled original_image
- * 2. For each Pixel in the output it identifies the corresponding floating point source coordinates and 
- * gathers the SAMPLE_SIZE * SAMPLE_SIZE neighbour around it
- * 3. Convoluted values are clamped to the [0:255] range as per 8bit using Integer
+ * The function perform a downscaling of an RGBA image as two separable Lanczos passes
+ * 1. Build one LanczosTaps table per output column and one per output row
+ * 2. Horizontal pass: each needed source row is convolved once into an intermediate row buffer
+ *    holding SAMPLE_SIZE rows, shared by all the output rows that overlap it
+ * 3. Vertical pass: each output row combines up to SAMPLE_SIZE intermediate rows
+ * 4. Convoluted values are clamped to the [0:255] range as per 8bit using Integer
  *
- * The convultion is zero padded for pixel outside the borders
+ * The convultion is zero padded for pixel outside the borders, the padding is folded
+ * into the tap tables so the inner loops carry no bounds check
+ *
+ * Output rows are split in contiguous bands, one per thread. The result does not
+ * depend on the number of threads. The scalar variant is the double precision
+ * reference, the SIMD and integer variants match it within 1 LSB per channel.
  *
  * return the pointer to the newly created Pixel struct array representing the scaled image
  *
  * The caller is responsible for freeing the returned memory.
  */
-Pixel* lanczos_scale(AsciiImageObject* sample, int scale_factor){
-    int height  = sample->height / scale_factor;
-    int width   = sample->width / scale_factor;
-    Pixel* scaled_picture       = (Pixel*) malloc(height * width * sizeof(Pixel)); 
-    double red_sample_matrix[SAMPLE_SIZE * SAMPLE_SIZE]; 
-    double green_sample_matrix[SAMPLE_SIZE * SAMPLE_SIZE]; 
-    double blue_sample_matrix[SAMPLE_SIZE * SAMPLE_SIZE];
-    double alpha_sample_matrix[SAMPLE_SIZE * SAMPLE_SIZE];
-
-
-    for(int row = 0; row < height; row++){
-        for(int col = 0; col < width; col++){
-            double source_row_fp = row * (double)sample->height / height;
-			double source_col_fp = col * (double)sample->width / width;
-			
-            int source_row_int = (int)source_row_fp;
-			int source_col_int = (int)source_col_fp;
-
-            for(int neighbour = 0; neighbour<SAMPLE_SIZE*SAMPLE_SIZE; neighbour++){
-                int neighbour_row = source_row_int + neighbor_offset[neighbour][0];
-                int neighbour_col = source_col_int + neighbor_offset[neighbour][1];
-                if(is_inbound(neighbour_row, neighbour_col, sample->height, sample->width)){
-                    Pixel current_pixel = sample->original_image[neighbour_row * sample->width + neighbour_col];
-                    red_sample_matrix[neighbour]    = (double) current_pixel.red;
-                    green_sample_matrix[neighbour]  = (double) current_pixel.green;
-                    blue_sample_matrix[neighbour]   = (double) current_pixel.blue;
-                    alpha_sample_matrix[neighbour]  = (double) current_pixel.alpha;
-                }else{
-                    red_sample_matrix[neighbour]    =  0.0;    
-                    green_sample_matrix[neighbour]  =  0.0;
-                    blue_sample_matrix[neighbour]   =  0.0;
-                    alpha_sample_matrix[neighbour]  =  0.0;    
-                }
-            }
-            double red_convoluted_value     = lanczos_point_convulution(red_sample_matrix);
-            double green_convoluted_value   = lanczos_point_convulution(green_sample_matrix);   
-            double blue_convoluted_value    = lanczos_point_convulution(blue_sample_matrix);
-            double alpha_convoluted_value   = lanczos_point_convulution(alpha_sample_matrix);   
-
-            red_convoluted_value    = (red_convoluted_value > 255)   ? 255 : (red_convoluted_value < 0)   ? 0 : red_convoluted_value;
-            green_convoluted_value  = (green_convoluted_value > 255) ? 255 : (green_convoluted_value < 0) ? 0 : green_convoluted_value;
-            blue_convoluted_value   = (blue_convoluted_value > 255)  ? 255 : (blue_convoluted_value < 0)  ? 0 : blue_convoluted_value;
-            alpha_convoluted_value  = (alpha_convoluted_value > 255) ? 255 : (alpha_convoluted_value < 0) ? 0 : alpha_convoluted_value;
-            
-            scaled_picture[row * width + col].red   = (uint8_t) red_convoluted_value;
-            scaled_picture[row * width + col].green = (uint8_t) green_convoluted_value;
-            scaled_picture[row * width + col].blue  = (uint8_t) blue_convoluted_value;
-            scaled_picture[row * width + col].alpha = (uint8_t) alpha_convoluted_value;
-        }
+Pixel* lanczos_scale(AsciiImageObject* sample, int scale_factor, int threads, LanczosVariant variant){
+    size_t pixels = (size_t)(sample->height / scale_factor) * (sample->width / scale_factor);
+    LanczosJob job;
+
+    job.sample      = sample;
+    job.kernels     = lanczos_select_kernels(variant);
+    job.output      = (Pixel*) malloc(pixels * sizeof(Pixel));
+    job.sink        = NULL;
+    job.sink_context = NULL;
+
+    if(job.output && !lanczos_run_job(&job, sample->width / scale_factor, sample->height / scale_factor, threads)){
+        free(job.output);
+        job.output = NULL;
     }
-    return scaled_picture;
+
+    return job.output;
+}
+
+/*
+ * lanczos_scale_rows rescale an image like lanczos_scale without materializing the result.
+ * - sample:        Pointer to an AsciiImageObject containing the original image data.
+ * - scale_factor:  Integer factor by which the image will be downscaled.
+ * - threads:       Number of worker threads the output rows are split across.
+ * - variant:       Kernel implementation to use.
+ * - sink:          Callback receiving each output row as soon as it is computed.
+ * - context:       Opaque pointer forwarded to sink.
+ *
+ * Each band computes its rows into a private, cache resident row buffer and hands it to
+ * the sink, so consumers that only need a derived value per pixel (e.g. a glyph) never
+ * pay for a full RGBA intermediate image and a second pass over it.
+ *
+ * Returns: true on success, false on allocation failure.
+ */
+bool lanczos_scale_rows(AsciiImageObject* sample, int scale_factor, int threads, LanczosVariant variant,
+                        LanczosRowSink sink, void* context){
+    LanczosJob job;
+
+    job.sample      = sample;
+    job.kernels     = lanczos_select_kernels(variant);
+    job.output      = NULL;
+    job.sink        = sink;
+    job.sink_context = context;
+
+    return lanczos_run_job(&job, sample->width / scale_factor, sample->height / scale_factor, threads);
+}
+
+/*
+ * lanczos_resize_rows rescale an image to an explicit size, row by row like lanczos_scale_rows.
+ * - sample:        Pointer to an AsciiImageObject containing the original image data.
+ * - width:         Number of output columns, at most sample->width.
+ * - height:        Number of output rows, at most sample->height.
+ * - threads:       Number of worker threads the output rows are split across.
+ * - variant:       Kernel implementation to use.
+ * - sink:          Callback receiving each output row as soon as it is computed.
+ * - context:       Opaque pointer forwarded to sink.
+ *
+ * The tap tables map every output coordinate to its source coordinate with the real
+ * ratio, so the source does not have to be an integer multiple of the output, e.g.
+ * when resampling from a pyramid level.
+ *
+ * Returns: true on success, false on allocation failure.
+ */
+bool lanczos_resize_rows(AsciiImageObject* sample, int width, int height, int threads, LanczosVariant variant,
+                         LanczosRowSink sink, void* context){
+    LanczosJob job;
+
+    job.sample      = sample;
+    job.kernels     = lanczos_select_kernels(variant);
+    job.output      = NULL;
+    job.sink        = sink;
+    job.sink_context = context;
+
+    return lanczos_run_job(&job, width, height, threads);
+}
+
+/*
+ * lanczos_stream_create prepares a row-by-row scaler for a source image of known size.
+ * - src_width, src_height:  Size of the source image.
+ * - scale_factor:           Integer factor by which the image will be downscaled.
+ * - variant:                Kernel implementation to use.
+ *
+ * Returns: A newly allocated LanczosStream, or NULL on allocation failure or when the
+ *          scaled image would be empty. Release it with lanczos_stream_destroy.
+ */
+LanczosStream* lanczos_stream_create(int src_width, int src_height, int scale_factor, LanczosVariant variant){
+    LanczosStream* stream = (LanczosStream*) calloc(1, sizeof(LanczosStream));
+    if(!stream) return NULL;
+
+    stream->src_width   = src_width;
+    stream->src_height  = src_height;
+    stream->width       = src_width / scale_factor;
+    stream->height      = src_height / scale_factor;
+    stream->kernels     = lanczos_select_kernels(variant);
+
+    if(stream->width <= 0 || stream->height <= 0){
+        free(stream);
+        return NULL;
+    }
+
+    stream->row_bytes   = (size_t)stream->width * stream->kernels->sample_bytes;
+    stream->row_taps    = lanczos_build_taps(src_height, stream->height);
+    stream->col_taps    = lanczos_build_taps(src_width, stream->width);
+    stream->ring        = (unsigned char*) malloc(SAMPLE_SIZE * stream->row_bytes);
+
+    if(!stream->row_taps || !stream->col_taps || !stream->ring){
+        lanczos_stream_destroy(stream);
+        return NULL;
+    }
+
+    return stream;
+}
+
+/*
+ * lanczos_stream_push feeds the next source row to a LanczosStream.
+ * - stream:   Stream created by lanczos_stream_create.
+ * - src_row:  src_width Pixel of source row number stream->pushed.
+ *
+ * Rows that no pending output row references are skipped without being filtered,
+ * so at large scale factors most source rows cost nothing but the decode. A needed
+ * row overwrites the ring slot of a row at least SAMPLE_SIZE rows older, which no
+ * pending output row can still reference.
+ */
+void lanczos_stream_push(LanczosStream* stream, const Pixel* src_row){
+    int source = stream->pushed++;
+
+    if(stream->next_row >= stream->height) return;
+    if(stream->row_taps[stream->next_row].index[0] > source) return;
+
+    int slot = source % SAMPLE_SIZE;
+    stream->kernels->horizontal(src_row, stream->col_taps, stream->width, stream->ring + (size_t)slot * stream->row_bytes);
+}
+
+/*
+ * lanczos_stream_pull emits the next output row if its whole neighbourhood was pushed.
+ * - stream:   Stream created by lanczos_stream_create.
+ * - dst_row:  Destination of stream->width Pixel.
+ *
+ * Call it in a loop after every push until it returns false: a single source row can
+ * complete more than one output row.
+ *
+ * Returns: true if dst_row was written, false if more source rows are needed or every
+ *          output row was already emitted.
+ */
+bool lanczos_stream_pull(LanczosStream* stream, Pixel* dst_row){
+    if(stream->next_row >= stream->height) return false;
+
+    const LanczosTaps* taps = &stream->row_taps[stream->next_row];
+    if(taps->index[taps->count - 1] >= stream->pushed) return false;
+
+    const void* rows[SAMPLE_SIZE];
+    for(int k = 0; k < taps->count; k++)
+        rows[k] = stream->ring + (size_t)(taps->index[k] % SAMPLE_SIZE) * stream->row_bytes;
+
+    stream->kernels->vertical(rows, taps, stream->width, dst_row);
+    stream->next_row++;
+    return true;
+}
+
+/*
+ * lanczos_stream_destroy releases a LanczosStream and every buffer it owns.
+ */
+void lanczos_stream_destroy(LanczosStream* stream){
+    if(!stream) return;
+    free(stream->row_taps);
+    free(stream->col_taps);
+    free(stream->ring);
+    free(stream);
 }
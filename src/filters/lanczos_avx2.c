@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <string.h>
+#include <immintrin.h>
+#include "lanczos_simd.h"
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+/*
+ * load_pixel_ps widens one packed RGBA Pixel into four float lanes.
+ */
+AVX2_TARGET static inline __m128 load_pixel_ps(const Pixel* pixel){
+    int32_t packed;
+
+    memcpy(&packed, pixel, sizeof(packed));
+    return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)));
+}
+
+/*
+ * load_pixel_pair_ps widens two packed RGBA Pixel into the low and high halves of eight float lanes.
+ */
+AVX2_TARGET static inline __m256 load_pixel_pair_ps(const Pixel* low, const Pixel* high){
+    int32_t packed_low, packed_high;
+
+    memcpy(&packed_low, low, sizeof(packed_low));
+    memcpy(&packed_high, high, sizeof(packed_high));
+    __m128i pair = _mm_insert_epi32(_mm_cvtsi32_si128(packed_low), packed_high, 1);
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(pair));
+}
+
+/*
+ * pack_pixel_epi32 packs four clamped int32 lanes into the low 32 bits of a vector as one Pixel.
+ */
+AVX2_TARGET static inline int32_t pack_pixel_epi32(__m128i value){
+    value = _mm_packs_epi32(value, value);
+    value = _mm_packus_epi16(value, value);
+    return _mm_cvtsi128_si32(value);
+}
+
+/*
+ * store_pixel_ps clamps four float lanes to [0:255], truncates them and stores them as one Pixel.
+ */
+AVX2_TARGET static inline void store_pixel_ps(Pixel* pixel, __m128 value){
+    value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+    int32_t bytes = pack_pixel_epi32(_mm_cvttps_epi32(value));
+    memcpy(pixel, &bytes, sizeof(bytes));
+}
+
+/*
+ * store_pixel_pair_ps clamps eight float lanes and stores them as two consecutive Pixel.
+ */
+AVX2_TARGET static inline void store_pixel_pair_ps(Pixel* pixel, __m256 value){
+    value = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+    __m256i truncated = _mm256_cvttps_epi32(value);
+    int32_t bytes[2];
+
+    bytes[0] = pack_pixel_epi32(_mm256_castsi256_si128(truncated));
+    bytes[1] = pack_pixel_epi32(_mm256_extracti128_si256(truncated, 1));
+    memcpy(pixel, bytes, sizeof(bytes));
+}
+
+/*
+ * lanczos_horizontal_pass_avx2 convolves a single source row along the x axis,
+ * writing width * 4 floats with channels interleaved as RGBA.
+ *
+ * Interior columns always carry the full kernel, so two of them are filtered together,
+ * each half of the vector with its own column's weights (they differ at fractional ratios);
+ * border columns with a truncated footprint go one at a time.
+ */
+AVX2_TARGET static void lanczos_horizontal_pass_avx2(const Pixel* src_row, const LanczosTaps* col_taps, int width, void* dst){
+    float* dst_row = (float*) dst;
+    int col = 0;
+
+    while(col < width){
+        const LanczosTaps* taps = &col_taps[col];
+
+        if(col + 1 < width && taps->count == SAMPLE_SIZE && col_taps[col + 1].count == SAMPLE_SIZE){
+            const LanczosTaps* next = &col_taps[col + 1];
+            __m256 accumulator = _mm256_setzero_ps();
+
+            for(int k = 0; k < SAMPLE_SIZE; k++){
+                __m256 weight = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(taps->weightf[k])),
+                                                     _mm_set1_ps(next->weightf[k]), 1);
+                __m256 value = load_pixel_pair_ps(&src_row[taps->index[k]], &src_row[next->index[k]]);
+                accumulator = _mm256_add_ps(accumulator, _mm256_mul_ps(weight, value));
+            }
+
+            _mm256_storeu_ps(dst_row + col * 4, accumulator);
+            col += 2;
+        }else{
+            __m128 accumulator = _mm_setzero_ps();
+
+            for(int k = 0; k < taps->count; k++){
+                __m128 weight = _mm_set1_ps(taps->weightf[k]);
+                accumulator = _mm_add_ps(accumulator, _mm_mul_ps(weight, load_pixel_ps(&src_row[taps->index[k]])));
+            }
+
+            _mm_storeu_ps(dst_row + col * 4, accumulator);
+            col += 1;
+        }
+    }
+}
+
+/*
+ * lanczos_vertical_pass_avx2 combines up to SAMPLE_SIZE float rows into one output row,
+ * two output pixels per iteration.
+ */
+AVX2_TARGET static void lanczos_vertical_pass_avx2(const void* const* rows, const LanczosTaps* taps, int width, Pixel* dst_row){
+    const float* source[SAMPLE_SIZE];
+    int col = 0;
+
+    for(int k = 0; k < taps->count; k++) source[k] = (const float*) rows[k];
+
+    for(; col + 1 < width; col += 2){
+        __m256 accumulator = _mm256_setzero_ps();
+
+        for(int k = 0; k < taps->count; k++)
+            accumulator = _mm256_add_ps(accumulator, _mm256_mul_ps(_mm256_set1_ps(taps->weightf[k]), _mm256_loadu_ps(source[k] + col * 4)));
+
+        store_pixel_pair_ps(&dst_row[col], accumulator);
+    }
+    for(; col < width; col++){
+        __m128 accumulator = _mm_setzero_ps();
+
+        for(int k = 0; k < taps->count; k++)
+            accumulator = _mm_add_ps(accumulator, _mm_mul_ps(_mm_set1_ps(taps->weightf[k]), _mm_loadu_ps(source[k] + col * 4)));
+
+        store_pixel_ps(&dst_row[col], accumulator);
+    }
+}
+
+const LanczosKernels lanczos_kernels_avx2 = {
+    4 * sizeof(float),
+    lanczos_horizontal_pass_avx2,
+    lanczos_vertical_pass_avx2,
+};
+
+#endif
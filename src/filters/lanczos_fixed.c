@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include "lanczos_simd.h"
+
+/*
+ * Fixed point layout of the integer variant.
+ * - LANCZOS_WEIGHT_BITS:  Kernel weights are Q14, so 1.0 is 1 << 14 and every weight fits an int16_t.
+ * - LANCZOS_SAMPLE_BITS:  Horizontally filtered samples are Q6 in an int16_t. The kernel overshoots
+ *                         to about [-19, 274] on 8-bit input, which stays below 2^15 / 2^6 = 512.
+ *
+ * The vertical pass accumulates Q6 * Q14 = Q20 products in 32 bits; the sum of the absolute
+ * weights is below 1.2, so the accumulator stays under 2^29.
+ */
+#define LANCZOS_WEIGHT_BITS 14
+#define LANCZOS_SAMPLE_BITS 6
+#define LANCZOS_HORIZONTAL_SHIFT (LANCZOS_WEIGHT_BITS - LANCZOS_SAMPLE_BITS)
+#define LANCZOS_VERTICAL_SHIFT   (LANCZOS_WEIGHT_BITS + LANCZOS_SAMPLE_BITS)
+
+/*
+ * lanczos_horizontal_pass_fixed convolves a single source row along the x axis,
+ * writing width * 4 Q6 int16_t samples with channels interleaved as RGBA.
+ *
+ * Each sample is rounded to nearest, so the intermediate carries 1/64 LSB of precision.
+ */
+static void lanczos_horizontal_pass_fixed(const Pixel* src_row, const LanczosTaps* col_taps, int width, void* dst){
+    int16_t* dst_row = (int16_t*) dst;
+    const int32_t round = 1 << (LANCZOS_HORIZONTAL_SHIFT - 1);
+
+    for(int col = 0; col < width; col++){
+        const LanczosTaps* taps = &col_taps[col];
+        int32_t red = round, green = round, blue = round, alpha = round;
+
+        for(int k = 0; k < taps->count; k++){
+            Pixel current_pixel = src_row[taps->index[k]];
+            int32_t weight = taps->weightq[k];
+            red   += weight * current_pixel.red;
+            green += weight * current_pixel.green;
+            blue  += weight * current_pixel.blue;
+            alpha += weight * current_pixel.alpha;
+        }
+
+        dst_row[col * 4 + 0] = (int16_t)(red   >> LANCZOS_HORIZONTAL_SHIFT);
+        dst_row[col * 4 + 1] = (int16_t)(green >> LANCZOS_HORIZONTAL_SHIFT);
+        dst_row[col * 4 + 2] = (int16_t)(blue  >> LANCZOS_HORIZONTAL_SHIFT);
+        dst_row[col * 4 + 3] = (int16_t)(alpha >> LANCZOS_HORIZONTAL_SHIFT);
+    }
+}
+
+/*
+ * clamp_q20 floors a Q20 value to an integer and clamps it to [0:255].
+ */
+static inline uint8_t clamp_q20(int32_t value){
+    value >>= LANCZOS_VERTICAL_SHIFT;
+    return (uint8_t)((value > 255) ? 255 : (value < 0) ? 0 : value);
+}
+
+/*
+ * lanczos_vertical_pass_fixed combines up to SAMPLE_SIZE Q6 rows into one output row.
+ *
+ * The channels are processed as one flat array of width * 4 samples, a shape compilers
+ * vectorize for any target. The Q20 sum is floored and clamped to [0:255], which is
+ * the truncation the double precision reference applies after clamping.
+ */
+static void lanczos_vertical_pass_fixed(const void* const* rows, const LanczosTaps* taps, int width, Pixel* dst_row){
+    uint8_t* dst = (uint8_t*) dst_row;
+    const int16_t* tap_rows[SAMPLE_SIZE];
+    int32_t weights[SAMPLE_SIZE];
+    int count = taps->count;
+
+    for(int k = 0; k < count; k++){
+        tap_rows[k] = (const int16_t*) rows[k];
+        weights[k]  = taps->weightq[k];
+    }
+
+    // Interior rows always have SAMPLE_SIZE taps; spelling them out gives the compiler
+    // a loop without an inner trip count to vectorize.
+    _Static_assert(SAMPLE_SIZE == 5, "the unrolled vertical pass expects five taps");
+    if(count == SAMPLE_SIZE){
+        for(size_t i = 0; i < (size_t)width * 4; i++){
+            int32_t value = weights[0] * tap_rows[0][i] + weights[1] * tap_rows[1][i] + weights[2] * tap_rows[2][i] +
+                            weights[3] * tap_rows[3][i] + weights[4] * tap_rows[4][i];
+            dst[i] = clamp_q20(value);
+        }
+        return;
+    }
+
+    for(size_t i = 0; i < (size_t)width * 4; i++){
+        int32_t value = 0;
+
+        for(int k = 0; k < count; k++) value += weights[k] * tap_rows[k][i];
+        dst[i] = clamp_q20(value);
+    }
+}
+
+const LanczosKernels lanczos_kernels_fixed = {
+    4 * sizeof(int16_t),
+    lanczos_horizontal_pass_fixed,
+    lanczos_vertical_pass_fixed,
+};
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LANCZOS_SIMD_H
+#define LANCZOS_SIMD_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include "lanczos.h"
+
+/*
+ * LanczosHorizontalPass convolves a single source row along the x axis.
+ * - src_row:    Pointer to the first Pixel of the source row.
+ * - col_taps:   Per output column tap table.
+ * - width:      Number of output columns.
+ * - dst_row:    Intermediate buffer of width RGBA samples, in the variant's own sample format.
+ */
+typedef void (*LanczosHorizontalPass)(const Pixel* src_row, const LanczosTaps* col_taps, int width, void* dst_row);
+
+/*
+ * LanczosVerticalPass combines horizontally filtered rows into one output row.
+ * - rows:       One intermediate row per valid tap of the output row, in tap order.
+ * - taps:       Tap table of the output row.
+ * - width:      Number of output columns.
+ * - dst_row:    Destination Pixel row, clamped to [0:255].
+ */
+typedef void (*LanczosVerticalPass)(const void* const* rows, const LanczosTaps* taps, int width, Pixel* dst_row);
+
+/*
+ * LanczosKernels the two passes of one scaler variant.
+ * - sample_bytes:  Size of one intermediate RGBA sample (4 doubles, 4 floats or 4 int16_t).
+ * - horizontal:    Horizontal pass of the variant.
+ * - vertical:      Vertical pass of the variant.
+ *
+ * Private to the scaler: the ring buffer management in lanczos.c is shared by every
+ * variant, which only differ in how the two passes are computed.
+ */
+typedef struct LanczosKernels{
+    size_t sample_bytes;
+    LanczosHorizontalPass horizontal;
+    LanczosVerticalPass vertical;
+} LanczosKernels;
+
+/*
+ * lanczos_kernels_sse2 / lanczos_kernels_avx2 single precision SIMD variants.
+ *
+ * They keep the intermediate ring in float with all four channels of a pixel in one
+ * vector (AVX2 handles two output pixels per instruction). Results match the double
+ * precision reference within 1 LSB per channel.
+ *
+ * Only defined on x86 targets; callers must check lanczos_variant_supported first.
+ */
+extern const LanczosKernels lanczos_kernels_sse2;
+extern const LanczosKernels lanczos_kernels_avx2;
+
+/*
+ * lanczos_kernels_fixed portable integer variant.
+ *
+ * Q14 weights, Q6 int16_t intermediates and 32-bit accumulators: a quarter of the ring
+ * memory of the double reference and no floating point at all, for CPUs where double
+ * throughput is poor. Results match the reference within 1 LSB per channel.
+ */
+extern const LanczosKernels lanczos_kernels_fixed;
+
+/*
+ * LanczosJob state shared by every band of a lanczos_scale call.
+ * - sample:    Source image.
+ * - kernels:   Passes of the selected variant.
+ * - row_taps:  Per output row tap table.
+ * - col_taps:  Per output column tap table.
+ * - width:     Number of output columns.
+ * - output:    Destination buffer of height * width Pixel, or NULL to stream rows to sink.
+ * - sink:      Row consumer used when output is NULL.
+ * - sink_context: Opaque pointer forwarded to sink.
+ * - failed:    Set by any band that could not allocate its buffers.
+ */
+typedef struct LanczosJob{
+    const AsciiImageObject* sample;
+    const LanczosKernels* kernels;
+    const LanczosTaps* row_taps;
+    const LanczosTaps* col_taps;
+    int width;
+    Pixel* output;
+    LanczosRowSink sink;
+    void* sink_context;
+    atomic_bool failed;
+} LanczosJob;
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <string.h>
+#include <immintrin.h>
+#include "lanczos_simd.h"
+
+#define SSE2_TARGET __attribute__((target("sse2")))
+
+/*
+ * load_pixel_ps widens one packed RGBA Pixel into four float lanes.
+ */
+SSE2_TARGET static inline __m128 load_pixel_ps(const Pixel* pixel){
+    int32_t packed;
+    __m128i zero = _mm_setzero_si128();
+
+    memcpy(&packed, pixel, sizeof(packed));
+    __m128i value = _mm_cvtsi32_si128(packed);
+    value = _mm_unpacklo_epi8(value, zero);
+    value = _mm_unpacklo_epi16(value, zero);
+    return _mm_cvtepi32_ps(value);
+}
+
+/*
+ * store_pixel_ps clamps four float lanes to [0:255], truncates them and stores them as one Pixel.
+ */
+SSE2_TARGET static inline void store_pixel_ps(Pixel* pixel, __m128 value){
+    value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+    __m128i packed = _mm_cvttps_epi32(value);
+    packed = _mm_packs_epi32(packed, packed);
+    packed = _mm_packus_epi16(packed, packed);
+
+    int32_t bytes = _mm_cvtsi128_si32(packed);
+    memcpy(pixel, &bytes, sizeof(bytes));
+}
+
+/*
+ * lanczos_horizontal_pass_sse2 convolves a single source row along the x axis,
+ * writing width * 4 floats with channels interleaved as RGBA.
+ */
+SSE2_TARGET static void lanczos_horizontal_pass_sse2(const Pixel* src_row, const LanczosTaps* col_taps, int width, void* dst){
+    float* dst_row = (float*) dst;
+
+    for(int col = 0; col < width; col++){
+        const LanczosTaps* taps = &col_taps[col];
+        __m128 accumulator = _mm_setzero_ps();
+
+        for(int k = 0; k < taps->count; k++){
+            __m128 weight = _mm_set1_ps(taps->weightf[k]);
+            accumulator = _mm_add_ps(accumulator, _mm_mul_ps(weight, load_pixel_ps(&src_row[taps->index[k]])));
+        }
+
+        _mm_storeu_ps(dst_row + col * 4, accumulator);
+    }
+}
+
+/*
+ * lanczos_vertical_pass_sse2 combines up to SAMPLE_SIZE float rows into one output row.
+ */
+SSE2_TARGET static void lanczos_vertical_pass_sse2(const void* const* rows, const LanczosTaps* taps, int width, Pixel* dst_row){
+    __m128 weights[SAMPLE_SIZE];
+
+    for(int k = 0; k < taps->count; k++) weights[k] = _mm_set1_ps(taps->weightf[k]);
+
+    for(int col = 0; col < width; col++){
+        __m128 accumulator = _mm_setzero_ps();
+
+        for(int k = 0; k < taps->count; k++)
+            accumulator = _mm_add_ps(accumulator, _mm_mul_ps(weights[k], _mm_loadu_ps((const float*) rows[k] + col * 4)));
+
+        store_pixel_ps(&dst_row[col], accumulator);
+    }
+}
+
+const LanczosKernels lanczos_kernels_sse2 = {
+    4 * sizeof(float),
+    lanczos_horizontal_pass_sse2,
+    lanczos_vertical_pass_sse2,
+};
+
+#endif
@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <png.h>
+#include "input.h"
+#include "parallel.h"
+
+/* 
+ * input_validator attempts to validate a file as a PNG image.
+ *
+ * Parameters:
+ * - input_path: a const char* representing the path to the file to validate.
+ *
+ * The function performs the following steps:
+ * - Opens the file in binary read mode ("rb")
+ * - Reads the first 8 bytes into file_header
+ * - Uses png_sig_cmp (from libpng) to check if the header matches a valid PNG signature
+ *
+ * Returns:
+ * - A FILE* if the file is a valid PNG and was successfully opened and read
+ * - NULL if the file cannot be opened, read, or fails the PNG signature check
+ *
+ * On error, an appropriate message is printed to stderr.
+ * On successful validation, nothing is printed.
+ */
+FILE* input_validator(const char* input_path){
+	unsigned char file_header[PNG_HEADER_SIZE];	//first 8 byte of file in path
+	FILE* file_ptr;
+	size_t read_bytes;
+
+	file_ptr = fopen(input_path, "rb");
+	if(!file_ptr){
+		fprintf(stderr, "%s: Error while reading file\n", input_path);
+		return NULL;
+	}
+
+	read_bytes = fread(file_header, 1, PNG_HEADER_SIZE, file_ptr);	// Read PNG_HEADER_SIZE bytes, one at a time (size = 1), and write them into file_header
+	if (read_bytes != 8) {
+		fprintf(stderr, "%s: Failed to read PNG header\n", input_path);
+		fclose(file_ptr);
+		return NULL;	
+    	}
+
+	if (png_sig_cmp(file_header, 0, 8)) {
+		fprintf(stderr, "%s: File is not a valid PNG\n", input_path);
+		fclose(file_ptr);
+		return NULL;
+	}
+
+	return file_ptr;
+}
+
+/*
+ * decode_png reads a whole PNG file into a new AsciiImageObject.
+ * - input_path: Path of the PNG file.
+ *
+ * Self-contained counterpart of the decode steps of render_file: opens and validates
+ * the file, decodes it to RGBA with its own libpng structs and setjmp handler, and
+ * releases everything but the image before returning. Safe to call from several
+ * threads at once.
+ *
+ * Returns: The decoded image, or NULL on failure (a message naming the file is printed on stderr).
+ */
+AsciiImageObject* decode_png(const char* input_path){
+	FILE* file_ptr = input_validator(input_path);
+	if(!file_ptr) return NULL;
+
+	AsciiImageObject* volatile image = NULL;
+	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+
+	if(!png_ptr || !info_ptr){
+		fprintf(stderr, "%s: Out of memory\n", input_path);
+		if(png_ptr) png_destroy_read_struct(&png_ptr, NULL, NULL);
+		fclose(file_ptr);
+		return NULL;
+	}
+
+	if (setjmp(png_jmpbuf(png_ptr))){
+		fprintf(stderr, "%s: Error occurred while processing file\n", input_path);
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		fclose(file_ptr);
+		image_struct_free(image);
+		return NULL;
+	}
+
+	png_init_io(png_ptr, file_ptr);
+	png_set_sig_bytes(png_ptr, PNG_HEADER_SIZE);
+	png_read_info(png_ptr, info_ptr);
+
+	image = image_struct_alloc(png_get_image_width(png_ptr, info_ptr), png_get_image_height(png_ptr, info_ptr), NULL);
+	if(image) image_struct_init(image, png_ptr, info_ptr);
+	else fprintf(stderr, "%s: Out of memory\n", input_path);
+
+	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+	fclose(file_ptr);
+	return image;
+}
+
+/*
+ * read_all reads a file descriptor up to end of file into the heap.
+ * - fd:     Descriptor to read, typically a pipe on stdin.
+ * - size:   Receives the number of bytes read.
+ *
+ * Returns: A newly allocated buffer of exactly *size bytes (at least one), or NULL on read or allocation failure.
+ */
+static void* read_all(int fd, size_t* size){
+	size_t capacity = (size_t) 1 << 20, length = 0;
+	uint8_t* buffer = (uint8_t*) malloc(capacity);
+	if(!buffer) return NULL;
+
+	for(;;){
+		if(length == capacity){
+			uint8_t* grown = (uint8_t*) realloc(buffer, capacity * 2);
+			if(!grown){
+				free(buffer);
+				return NULL;
+			}
+			buffer = grown;
+			capacity *= 2;
+		}
+
+		ssize_t count = read(fd, buffer + length, capacity - length);
+		if(count < 0 && errno == EINTR) continue;
+		if(count < 0){
+			free(buffer);
+			return NULL;
+		}
+		if(count == 0) break;
+		length += (size_t) count;
+	}
+
+	// Raw RGBA is handed to the image as is: do not keep the doubling slack
+	uint8_t* trimmed = (uint8_t*) realloc(buffer, length ? length : 1);
+	*size = length;
+	return trimmed ? trimmed : buffer;
+}
+
+/*
+ * ppm_space tells whether a byte is PPM header whitespace (blank, tab, CR, LF, VT or FF).
+ */
+static inline bool ppm_space(uint8_t byte){
+	return byte == ' ' || (byte >= '\t' && byte <= '\r');
+}
+
+/*
+ * ppm_header_number reads the next decimal field of a PPM header.
+ * - data, size:  The input.
+ * - offset:      Position to read from, moved past the number.
+ *
+ * Whitespace and '#' comments before the number are skipped.
+ *
+ * Returns: The value, or -1 if there is no number or it exceeds INT_MAX.
+ */
+static long ppm_header_number(const uint8_t* data, size_t size, size_t* offset){
+	size_t at = *offset;
+
+	while(at < size && (ppm_space(data[at]) || data[at] == '#')){
+		if(data[at] == '#') while(at < size && data[at] != '\n') at++;
+		else at++;
+	}
+
+	if(at >= size || data[at] < '0' || data[at] > '9') return -1;
+
+	long value = 0;
+	while(at < size && data[at] >= '0' && data[at] <= '9'){
+		value = value * 10 + (data[at++] - '0');
+		if(value > INT_MAX) return -1;
+	}
+
+	*offset = at;
+	return value;
+}
+
+/*
+ * mapped_input_open maps a PPM (P6) or raw RGBA input without decoding it.
+ * - input_path: Path of the file, or "-" for stdin.
+ * - raw_width:  Width of a headerless raw RGBA input (--size), 0 to only accept PPM.
+ * - raw_height: Height of a headerless raw RGBA input, 0 to only accept PPM.
+ * - input:      Receives the mapping; zero-filled when 0 or -1 is returned.
+ *
+ * Regular files (stdin included when redirected from one) are mapped read-only, so
+ * "decoding" costs one mmap and the page faults of the rows the scaler touches. Pipes,
+ * and a stdin file whose position is past its start, are read into the heap from the
+ * current position. Without a raw size only files starting with the P6 magic are
+ * taken; for any other file just its first two bytes are read, and libpng gets it.
+ *
+ * Returns: 1 if input was filled, 0 if the file is neither (the caller decodes it as PNG),
+ *          -1 on failure (a message naming the file is printed on stderr).
+ */
+int mapped_input_open(const char* input_path, int raw_width, int raw_height, MappedInput* input){
+	bool from_stdin = strcmp(input_path, "-") == 0;
+	memset(input, 0, sizeof(*input));
+
+	int fd = from_stdin ? STDIN_FILENO : open(input_path, O_RDONLY);
+	if(fd < 0){
+		fprintf(stderr, "%s: Error while reading file\n", input_path);
+		return -1;
+	}
+
+	if(!raw_width && !from_stdin){
+		uint8_t magic[2];
+		if(pread(fd, magic, sizeof(magic), 0) != (ssize_t) sizeof(magic) || magic[0] != 'P' || magic[1] != '6'){
+			close(fd);
+			return 0;
+		}
+	}
+
+	struct stat info;
+	// A redirected stdin may already be past its start: mmap only sees the file from offset 0
+	if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0 && lseek(fd, 0, SEEK_CUR) == 0){
+		input->size = (size_t) info.st_size;
+		input->data = mmap(NULL, input->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(input->data == MAP_FAILED) input->data = NULL;
+		else input->mapped = true;
+		// Band workers fault rows in from several places at once: start reading ahead now
+		if(input->mapped) posix_madvise(input->data, input->size, POSIX_MADV_WILLNEED);
+	}else{
+		input->data = read_all(fd, &input->size);
+	}
+	if(!from_stdin) close(fd);
+
+	if(!input->data){
+		fprintf(stderr, "%s: Error while reading file\n", input_path);
+		mapped_input_close(input);
+		return -1;
+	}
+
+	const uint8_t* data = (const uint8_t*) input->data;
+	size_t offset = 0;
+
+	if(raw_width){
+		input->width	= raw_width;
+		input->height	= raw_height;
+		input->channels	= 4;
+		input->maxval	= 255;
+	}else if(input->size >= 2 && data[0] == 'P' && data[1] == '6'){
+		offset = 2;
+		long width	= ppm_header_number(data, input->size, &offset);
+		long height	= width > 0 ? ppm_header_number(data, input->size, &offset) : -1;
+		long maxval	= height > 0 ? ppm_header_number(data, input->size, &offset) : -1;
+
+		// Exactly one whitespace byte separates maxval from the samples
+		if(maxval < 1 || maxval > 65535 || offset >= input->size || !ppm_space(data[offset])){
+			fprintf(stderr, "%s: Invalid PPM header\n", input_path);
+			mapped_input_close(input);
+			return -1;
+		}
+		if(maxval > 255){
+			fprintf(stderr, "%s: 16-bit PPM is not supported\n", input_path);
+			mapped_input_close(input);
+			return -1;
+		}
+
+		offset++;
+		input->width	= (int) width;
+		input->height	= (int) height;
+		input->channels	= 3;
+		input->maxval	= (int) maxval;
+	}else{
+		fprintf(stderr, "%s: Only PPM (P6), or raw RGBA with --size, can be read from stdin\n", input_path);
+		mapped_input_close(input);
+		return -1;
+	}
+
+	size_t expected = (size_t) input->width * input->height * input->channels;
+	if((size_t) input->width * input->height > INT_MAX){
+		fprintf(stderr, "%s: Image is too large\n", input_path);
+		mapped_input_close(input);
+		return -1;
+	}
+	if(raw_width && input->size != expected){
+		fprintf(stderr, "%s: Raw RGBA input is %zu bytes, %dx%d needs %zu\n", input_path, input->size, raw_width, raw_height, expected);
+		mapped_input_close(input);
+		return -1;
+	}
+	if(input->size - offset < expected){
+		fprintf(stderr, "%s: Truncated PPM data\n", input_path);
+		mapped_input_close(input);
+		return -1;
+	}
+
+	input->pixels = data + offset;
+	return 1;
+}
+
+/*
+ * mapped_input_row returns one row of a MappedInput as RGBA.
+ * - input:      Input filled by mapped_input_open.
+ * - row:        Row index, between 0 and input->height - 1.
+ * - scratch:    Buffer of input->width pixels used when the row has to be expanded.
+ *
+ * Raw RGBA rows already have the layout of Pixel[width] and are returned in place.
+ * PPM rows get an opaque alpha and, when maxval is not 255, samples rescaled to 0-255.
+ *
+ * Returns: A pointer into the mapping for raw RGBA, scratch holding the expanded row otherwise.
+ */
+const Pixel* mapped_input_row(const MappedInput* input, int row, Pixel* scratch){
+	const uint8_t* source = input->pixels + (size_t) row * input->width * input->channels;
+	int maxval = input->maxval;
+
+	if(input->channels == 4) return (const Pixel*) source;
+
+	if(maxval == 255){
+		for(int col = 0; col < input->width; col++, source += 3){
+			scratch[col].red	= source[0];
+			scratch[col].green	= source[1];
+			scratch[col].blue	= source[2];
+			scratch[col].alpha	= 255;
+		}
+	}else{
+		// Samples above maxval are out of spec: saturate them
+		for(int col = 0; col < input->width; col++, source += 3){
+			scratch[col].red	= source[0] >= maxval ? 255 : (uint8_t) ((source[0] * 255 + maxval / 2) / maxval);
+			scratch[col].green	= source[1] >= maxval ? 255 : (uint8_t) ((source[1] * 255 + maxval / 2) / maxval);
+			scratch[col].blue	= source[2] >= maxval ? 255 : (uint8_t) ((source[2] * 255 + maxval / 2) / maxval);
+			scratch[col].alpha	= 255;
+		}
+	}
+
+	return scratch;
+}
+
+/*
+ * ExpandJob rows of a MappedInput expanded by expand_band.
+ * - input:      Source input.
+ * - output:     Destination image, width * height pixels.
+ */
+typedef struct ExpandJob{
+	const MappedInput* input;
+	Pixel* output;
+} ExpandJob;
+
+/*
+ * expand_band expands the rows [row_begin, row_end) of an ExpandJob in place in its output.
+ */
+static void expand_band(void* context, int row_begin, int row_end){
+	ExpandJob* job = (ExpandJob*) context;
+
+	for(int row = row_begin; row < row_end; row++)
+		mapped_input_row(job->input, row, job->output + (size_t) row * job->input->width);
+}
+
+/*
+ * mapped_input_image turns a MappedInput into an AsciiImageObject and releases the input.
+ * - input:      Input filled by mapped_input_open; zero-filled on return.
+ * - threads:    Number of worker threads the PPM rows are expanded on.
+ * - arena:      Arena the expanded PPM is carved from, or NULL for the heap.
+ *
+ * Raw RGBA is not copied: original_image is the mapping (or the heap buffer stdin was
+ * read into) and the image takes ownership of it. PPM is expanded to RGBA once.
+ *
+ * Returns: The image, or NULL on memory allocation failure.
+ */
+AsciiImageObject* mapped_input_image(MappedInput* input, int threads, Arena* arena){
+	AsciiImageObject* image;
+
+	if(input->channels == 4){
+		image = (AsciiImageObject*) calloc(1, sizeof(AsciiImageObject));
+		if(!image){
+			mapped_input_close(input);
+			return NULL;
+		}
+
+		image->width		= input->width;
+		image->height		= input->height;
+		image->scale		= 1;
+		image->original_image	= (Pixel*) input->data;	// only read, the mapping is PROT_READ
+		if(input->mapped){
+			image->mapping		= input->data;
+			image->mapping_size	= input->size;
+		}
+
+		memset(input, 0, sizeof(*input));
+		return image;
+	}
+
+	image = image_struct_alloc(input->width, input->height, arena);
+	if(image){
+		ExpandJob job = { input, image->original_image };
+		parallel_rows(input->height, threads, expand_band, &job);
+	}
+
+	mapped_input_close(input);
+	return image;
+}
+
+/*
+ * mapped_input_close releases a MappedInput; a zero-filled one is accepted.
+ */
+void mapped_input_close(MappedInput* input){
+	if(input->mapped) munmap(input->data, input->size);
+	else free(input->data);
+	memset(input, 0, sizeof(*input));
+}
@@ -15,161 +15,155 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
-#include <locale.h>
+#include <unistd.h>
 #include <png.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <limits.h>
 #include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include "commons.h"
 #include "lanczos.h"
-#include "asciifier.h" 
+#include "asciifier.h"
+#include "parallel.h"
+#include "selftest.h"
+#include "output.h"
+#include "cache.h"
+#include "decoder.h"
+#include "input.h"
+#include "server.h"
+#include "stats.h"
+#include "video.h"
+#include "pipeline.h"
+#include "arena.h"
 
 /*
- * array_mapping Computes the linear index in a 1D array from 2D matrix coordinates.
- * - row :  The row index of the element.
- * - col :  The column index of the element.
- * - cols:  The total number of columns in the matrix.
- *
- * This function implements the standard row-major bijection from N^2 to N,
- * mapping a finite 2D matrix into a 1D array.
- *
- * Returns: The linear index corresponding to the (row, col) coordinates.
+ * Global variable holding the currently selected rendering palette.
+ * Initialized to BRAILLE by default; may be overridden via command-line options.
  */
-static inline int array_mapping(int row, int col, int cols){
-	return (row * cols) + col;
-}
+Palette g_palette = BRAILLE;
 
-/* 
- * input_validator attempts to validate a file as a PNG image.
- *
- * Parameters:
- * - input_path: a char* representing the path to the file to validate.
- *
- * The function performs the following steps:
- * - Opens the file in binary read mode ("rb")
- * - Reads the first 8 bytes into file_header
- * - Uses png_sig_cmp (from libpng) to check if the header matches a valid PNG signature
- *
- * Returns:
- * - A FILE* if the file is a valid PNG and was successfully opened and read
- * - NULL if the file cannot be opened, read, or fails the PNG signature check
- *
- * On error, an appropriate message is printed to stderr.
- * On successful validation, nothing is printed.
+/*
+ * Global variable holding the downscale factor (-s). Fractional values are accepted,
+ * the output is floor(size / g_scale) cells along each axis.
  */
-FILE* input_validator(char* input_path){
-	unsigned char file_header[PNG_HEADER_SIZE];	//first 8 byte of file in path
-	FILE* file_ptr;
-	size_t read_bytes;
+double g_scale = 1;
 
-	file_ptr = fopen(input_path, "rb");
-	if(!file_ptr){
-		fprintf(stderr, "Error while reading file");
-		return NULL;
-	}
+/*
+ * Global variable holding the resampling filter (--filter).
+ */
+ResampleFilter g_filter = RESAMPLE_LANCZOS;
 
-	read_bytes = fread(file_header, 1, PNG_HEADER_SIZE, file_ptr);	// Read PNG_HEADER_SIZE bytes, one at a time (size = 1), and write them into file_header
-	if (read_bytes != 8) {
-		fprintf(stderr, "Failed to read PNG header\n");
-		fclose(file_ptr);
-		return NULL;	
-    	}
+/*
+ * Global variable holding the number of worker threads used by the scaling and
+ * glyph mapping stages. 0 means "one per online CPU" and is resolved in main.
+ */
+int g_threads = 0;
 
-	if (png_sig_cmp(file_header, 0, 8)) {
-		fprintf(stderr, "File is not a valid PNG\n");
-		fclose(file_ptr);
-		return NULL;
-	}
+/*
+ * Global variable holding the requested scaler implementation.
+ * LANCZOS_AUTO lets the scaler pick the widest SIMD variant supported by the CPU.
+ */
+LanczosVariant g_variant = LANCZOS_AUTO;
 
-	return file_ptr;
-}
+/*
+ * Global flag enabling the bounded-memory streaming pipeline (--stream).
+ */
+bool g_stream = false;
 
+/*
+ * Global variable holding the batch output directory (-o / --output-dir), NULL in single image mode.
+ */
+const char* g_output_dir = NULL;
 
 /*
- *image_struct_init initializes an AsciiImageObject from PNG image data.
- * - width:      The width of the PNG image in pixels.
- * - height:     The height of the PNG image in pixels.
- * - png_ptr:    A pointer to the libpng read struct.
- * - info_ptr:   A pointer to the libpng info struct.
- * 
- * This function:
- * - Allocates memory for an AsciiImageObject structure.
- * - Normalizes the PNG image data to 8-bit RGBA format using libpng transformations.
- * - Reads the pixel data into the `original_image` field as an array of `Pixel` structs.
- * - Leaves the `edited_image` field initialized to NULL for future use.
- * 
- * The function assumes the PNG has been properly opened and validated before calling.
- * Returns: A pointer to a fully initialized AsciiImageObject on success.
- * Exits the program with EXIT_FAILURE on memory allocation failure.
+ * Global list of input paths collected by args_parser (and read_path_list in batch mode).
  */
-AsciiImageObject* image_struct_init(int width, int height, png_structp png_ptr, png_infop info_ptr){
-	AsciiImageObject* return_ptr;	
-	png_byte color_type = png_get_color_type(png_ptr, info_ptr);
-	png_byte bit_depth  = png_get_bit_depth(png_ptr, info_ptr);
-	int memory_size = width * height;
-
-	//Allocating memory for AsciiImageObject struct
-	return_ptr = (AsciiImageObject*) malloc(sizeof(AsciiImageObject));
-	if(!return_ptr) exit(EXIT_FAILURE);
-
-	return_ptr->original_image 	= (Pixel*) malloc(sizeof(Pixel)*memory_size);
-	return_ptr->ascii_image     	= (wchar_t*)  malloc(sizeof(char)* memory_size);
-	//if(!return_ptr->edited_image || !return_ptr->original_image) exit(EXIT_FAILURE);
-		
-	//Normalization all PNG format into a RGBA 8-bit
-	if (bit_depth == 16) 					png_set_strip_16(png_ptr);
-	if (color_type == PNG_COLOR_TYPE_PALETTE)		png_set_palette_to_rgb(png_ptr);
-	if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8) png_set_expand_gray_1_2_4_to_8(png_ptr);
-	if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) 	png_set_tRNS_to_alpha(png_ptr);
-	if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA) png_set_gray_to_rgb(png_ptr);
-	if (color_type == PNG_COLOR_TYPE_RGB || color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_PALETTE) png_set_filler(png_ptr, 0xFF, PNG_FILLER_AFTER);
-	
-	png_read_update_info(png_ptr, info_ptr);
-	
-	//SUB-ROUTINE: store RGBA values in AsciiImageObject.original_image
-	png_bytep* row_pointers;
-	return_ptr->edited_image 	= NULL;
-	return_ptr->width 		= width;
-	return_ptr->height		= height;
-	return_ptr->scale 		= 1;
-	int row_bytes 			= png_get_rowbytes(png_ptr, info_ptr);
-
-	row_pointers = malloc(sizeof(png_bytep) * height);
-	if (!row_pointers) exit(EXIT_FAILURE);
-	
-	for (int row = 0; row< height; row++) {
-		row_pointers[row] = malloc(row_bytes);
-		if (!row_pointers[row]) exit(EXIT_FAILURE);
-	}
+char** g_inputs = NULL;
+int g_input_count = 0;
 
-	png_read_image(png_ptr, row_pointers);
+/*
+ * Global variables of the render cache: its directory (--cache / --cache-dir), NULL when
+ * caching is off, and the size it is pruned to (--cache-size), 0 for no limit.
+ */
+char* g_cache_dir = NULL;
+uint64_t g_cache_size = CACHE_DEFAULT_MAX_SIZE;
 
-	for(int row = 0; row < height; row++){
-		for(int col = 0; col < width; col++){
-			png_bytep row_data = row_pointers[row];
-			png_bytep pixel = row_data + (col * 4);
-			int idx = array_mapping(row, col, width);
-			return_ptr->original_image[idx].red   = (uint8_t) pixel[0];
-			return_ptr->original_image[idx].green = (uint8_t) pixel[1];
-			return_ptr->original_image[idx].blue  = (uint8_t) pixel[2];
-			return_ptr->original_image[idx].alpha = (uint8_t) pixel[3];
-		}
-	}
+/*
+ * Global variables of the render daemon: the socket to listen on (--serve) or to send
+ * a request to (--connect), and the memory budget of the resident images (--serve-memory).
+ */
+const char* g_serve_socket = NULL;
+const char* g_connect_socket = NULL;
+size_t g_serve_memory = SERVER_DEFAULT_MEMORY;
 
-	for (int row = 0; row < height; row++) free(row_pointers[row]);
-	free(row_pointers);
+/*
+ * Global flag resampling from an image pyramid (--pyramid) instead of the full resolution image.
+ */
+bool g_pyramid = false;
 
-	return return_ptr;
-}
+/*
+ * Global flag decoding only the Adam7 passes an interlaced PNG needs at the requested scale (--partial-decode).
+ */
+bool g_partial_decode = false;
 
 /*
- * Global variable holding the currently selected rendering palette.
- * Initialized to BRAILLE by default; may be overridden via command-line options.
+ * Global flag selecting the JSON form of the --timings report.
  */
-Palette g_palette = BRAILLE;
+bool g_stats_json = false;
+
+/*
+ * Global flag selecting the Braille dot mode (--dots), 2x4 thresholded pixels per cell.
+ */
+bool g_dots = false;
 
-uint8_t g_scale_factor = 1;
+/*
+ * Global variable holding the 8-bit luminance below which a dot is raised (--dots-threshold).
+ */
+int g_dots_threshold = 128;
+
+/*
+ * Global flag selecting shape matching (--shape), each glyph picked from the 2x3 sub-cells of its cell.
+ */
+bool g_shape = false;
+
+/*
+ * Global variable holding the colour output mode (--color).
+ */
+ColorMode g_color = COLOR_NONE;
+
+/*
+ * Global variables holding the frame size of the raw RGBA video read from stdin (--video), 0 when disabled.
+ */
+int g_video_width = 0;
+int g_video_height = 0;
+
+/*
+ * Global variables holding the size of headerless raw RGBA inputs (--size), 0 when inputs are PNG or PPM.
+ */
+int g_raw_width = 0;
+int g_raw_height = 0;
+
+/*
+ * parse_size parses a WIDTHxHEIGHT option value.
+ * - value:          Option value.
+ * - width, height:  Receive the size.
+ * - max_pixels:     Largest accepted width * height.
+ *
+ * Returns: false if the value is malformed, not positive or too large.
+ */
+static bool parse_size(const char* value, int* width, int* height, size_t max_pixels){
+	int consumed = 0;
+
+	return sscanf(value, "%dx%d%n", width, height, &consumed) == 2 && value[consumed] == '\0' &&
+	       *width >= 1 && *height >= 1 && (size_t) *width * *height <= max_pixels;
+}
 
 /*
  * args_parser parses command-line arguments and configures the program's
@@ -178,27 +172,56 @@ uint8_t g_scale_factor = 1;
  * - argv: array of strings containing the arguments passed to main().
  *
  * Behavior:
- *  - Ensures that at least one file path is provided as a required argument.
+ *  - Every argument that is not an option (or option value) is an input path; "-" is stdin.
+ *  - Ensures that exactly one file path is provided, unless an output directory,
+ *    a daemon socket (--serve) or --video is given.
  *  - Handles optional flags:
  *      - "-p" / "--palette": sets the rendering palette ('BRAILLE', 'BLOCK', 'DENSE', 'SMOOTH').
- *      - "-s" / "--scale": sets the scale factor as an integer.
+ *      - "-s" / "--scale": sets the scale factor (at least 1, may be fractional).
+ *      - "--filter": sets the resampling filter ('lanczos', 'box', 'auto').
+ *      - "-j" / "--threads": sets the number of worker threads (positive integer).
+ *      - "--simd": forces the scaler implementation ('auto', 'scalar', 'sse2', 'avx2', 'fixed').
+ *      - "--stream": decodes, scales and prints row by row in O(width) memory.
+ *      - "-o" / "--output-dir": batch mode, renders every input to <dir>/<name>.txt.
+ *      - "--cache": reuses rendered output from the default cache directory.
+ *      - "--cache-dir": same as "--cache" with an explicit directory.
+ *      - "--cache-size": size the cache is pruned to, in MiB (0 for no limit).
+ *      - "--serve": runs the render daemon on the given Unix socket, no input path.
+ *      - "--serve-memory": memory budget of the daemon's resident images, in MiB.
+ *      - "--connect": renders through the daemon listening on the given socket.
+ *      - "--pyramid": resamples from the nearest 2x reduction of the image (faster, slightly different).
+ *      - "--partial-decode": decodes only the first Adam7 passes of interlaced PNGs at large scales.
+ *      - "--timings" / "--timings=json": prints per-stage time, heap growth and peak RSS on stderr.
+ *      - "--dots": renders 2x4 thresholded pixels per Braille cell instead of a palette.
+ *      - "--dots-threshold": luminance (0-255) below which a dot is raised; implies "--dots".
+ *      - "--shape": picks each glyph by the shape of its cell, not only its brightness.
+ *      - "--color": colours every glyph with ANSI escape sequences ('truecolor', '256').
+ *      - "--video": plays raw RGBA frames of the given WIDTHxHEIGHT from stdin, no input path.
+ *      - "--size": reads every input as headerless raw RGBA of the given WIDTHxHEIGHT.
  *  - Any unknown option or missing/invalid value causes the program
  *    to terminate immediately with an error message on stderr.
  *
  * Side effects:
- *  - Modifies the global variables 'g_palette' and 'g_scale_factor'
- *    according to the provided options.
+ *  - Modifies the global variables 'g_palette', 'g_scale', 'g_filter', 'g_threads',
+ *    'g_variant', 'g_stream', 'g_output_dir', 'g_cache_dir', 'g_cache_size',
+ *    'g_serve_socket', 'g_serve_memory', 'g_connect_socket', 'g_stats_enabled', 'g_stats_json',
+ *    'g_pyramid', 'g_partial_decode', 'g_dots', 'g_dots_threshold', 'g_shape',
+ *    'g_color', 'g_video_width', 'g_video_height', 'g_raw_width', 'g_raw_height',
+ *    'g_inputs' and 'g_input_count' according to the provided options.
  *  - Terminates the program with exit(EXIT_FAILURE) on invalid input.
  */
 static inline void args_parser(int argc, char* argv[]){
-	if(argc < 2){
-		fprintf(stderr, "A single file path argument is required\n");
-		exit(EXIT_FAILURE);
-	}
-	
-	for(int i = 2; i < argc; i++){
+	g_inputs = (char**) malloc(sizeof(char*) * argc);
+	if(!g_inputs) exit(EXIT_FAILURE);
+
+	for(int i = 1; i < argc; i++){
 		char* arg = argv[i];
 
+		if(arg[0] != '-' || strcmp(arg, "-") == 0){	//Input path
+			g_inputs[g_input_count++] = arg;
+			continue;
+		}
+
 		if(strcmp(arg, "-p") == 0 || strcmp(arg, "--palette") == 0){	//Palette argument
 			if(i+1>= argc){ //update before controll
 				fprintf(stderr, "Missing value for option %s", arg);
@@ -222,67 +245,928 @@ static inline void args_parser(int argc, char* argv[]){
 			}
 			
 			char* endptr;
-			g_scale_factor = (int)strtol(argv[++i], &endptr, 10);
+			g_scale = strtod(argv[++i], &endptr);
 			
-			if(*endptr != '\0'){
+			if(*endptr != '\0' || !(g_scale >= 1 && g_scale <= 65535)){
 				fprintf(stderr, "Invalid scale factor %s", argv[i]);
 				exit(EXIT_FAILURE);;
 			}					
+		}else if(strcmp(arg, "--filter") == 0){	//Resampling filter
+			if(i+1>= argc){ //update before controll
+				fprintf(stderr, "Missing value for option %s", arg);
+				exit(EXIT_FAILURE);
+			}
+
+			char* filter = argv[++i];
+
+			if(strcmp(filter, "lanczos") == 0) g_filter = RESAMPLE_LANCZOS;
+			else if(strcmp(filter, "box") == 0) g_filter = RESAMPLE_BOX;
+			else if(strcmp(filter, "auto") == 0) g_filter = RESAMPLE_AUTO;
+			else{
+				fprintf(stderr, "Unknown filter: %s\n", filter);
+				exit(EXIT_FAILURE);
+			}
+		}else if(strcmp(arg, "-j") == 0 || strcmp(arg, "--threads") == 0){	//Threads argument
+			if(i+1>= argc){ //update before controll
+				fprintf(stderr, "Missing value for option %s", arg);
+				exit(EXIT_FAILURE);
+			}
+
+			char* endptr;
+			long threads = strtol(argv[++i], &endptr, 10);
+
+			if(*endptr != '\0' || threads < 1 || threads > 1024){
+				fprintf(stderr, "Invalid thread count %s", argv[i]);
+				exit(EXIT_FAILURE);
+			}
+			g_threads = (int) threads;
+		}else if(strcmp(arg, "--simd") == 0){	//Scaler variant argument
+			if(i+1>= argc){ //update before controll
+				fprintf(stderr, "Missing value for option %s", arg);
+				exit(EXIT_FAILURE);
+			}
+
+			char* variant = argv[++i];
+
+			if(strcmp(variant, "auto") == 0) g_variant = LANCZOS_AUTO;
+			else if(strcmp(variant, "scalar") == 0) g_variant = LANCZOS_SCALAR;
+			else if(strcmp(variant, "sse2") == 0) g_variant = LANCZOS_SSE2;
+			else if(strcmp(variant, "avx2") == 0) g_variant = LANCZOS_AVX2;
+			else if(strcmp(variant, "fixed") == 0) g_variant = LANCZOS_FIXED;
+			else{
+				fprintf(stderr, "Unknown SIMD variant: %s\n", variant);
+				exit(EXIT_FAILURE);
+			}
+
+			if(!lanczos_variant_supported(g_variant)){
+				fprintf(stderr, "SIMD variant %s is not supported by this CPU\n", variant);
+				exit(EXIT_FAILURE);
+			}
+		}else if(strcmp(arg, "--stream") == 0){	//Streaming pipeline
+			g_stream = true;
+		}else if(strcmp(arg, "-o") == 0 || strcmp(arg, "--output-dir") == 0){	//Batch output directory
+			if(i+1>= argc){ //update before controll
+				fprintf(stderr, "Missing value for option %s", arg);
+				exit(EXIT_FAILURE);
+			}
+			g_output_dir = argv[++i];
+		}else if(strcmp(arg, "--cache") == 0){	//Render cache in the default directory
+			free(g_cache_dir);
+			g_cache_dir = cache_default_dir();
+			if(!g_cache_dir){
+				fprintf(stderr, "Cannot locate a cache directory, set XDG_CACHE_HOME or use --cache-dir\n");
+				exit(EXIT_FAILURE);
+			}
+		}else if(strcmp(arg, "--cache-dir") == 0){	//Render cache in an explicit directory
+			if(i+1>= argc){ //update before controll
+				fprintf(stderr, "Missing value for option %s", arg);
+				exit(EXIT_FAILURE);
+			}
+			free(g_cache_dir);
+			g_cache_dir = strdup(argv[++i]);
+			if(!g_cache_dir) exit(EXIT_FAILURE);
+		}else if(strcmp(arg, "--cache-size") == 0){	//Render cache size budget
+			if(i+1>= argc){ //update before controll
+				fprintf(stderr, "Missing value for option %s", arg);
+				exit(EXIT_FAILURE);
+			}
+
+			char* endptr;
+			long megabytes = strtol(argv[++i], &endptr, 10);
+
+			if(*endptr != '\0' || megabytes < 0){
+				fprintf(stderr, "Invalid cache size %s", argv[i]);
+				exit(EXIT_FAILURE);
+			}
+			g_cache_size = (uint64_t) megabytes << 20;
+		}else if(strcmp(arg, "--serve") == 0 || strcmp(arg, "--connect") == 0){	//Render daemon socket
+			if(i+1>= argc){ //update before controll
+				fprintf(stderr, "Missing value for option %s", arg);
+				exit(EXIT_FAILURE);
+			}
+			if(arg[2] == 's') g_serve_socket = argv[++i];
+			else g_connect_socket = argv[++i];
+		}else if(strcmp(arg, "--pyramid") == 0){	//Pyramid resampling
+			g_pyramid = true;
+		}else if(strcmp(arg, "--partial-decode") == 0){	//Adam7 reduced-pass decoding
+			g_partial_decode = true;
+		}else if(strcmp(arg, "--timings") == 0 || strcmp(arg, "--timings=json") == 0){	//Stage instrumentation
+			g_stats_enabled = true;
+			g_stats_json = arg[9] == '=';
+		}else if(strcmp(arg, "--serve-memory") == 0){	//Render daemon memory budget
+			if(i+1>= argc){ //update before controll
+				fprintf(stderr, "Missing value for option %s", arg);
+				exit(EXIT_FAILURE);
+			}
+
+			char* endptr;
+			long megabytes = strtol(argv[++i], &endptr, 10);
+
+			if(*endptr != '\0' || megabytes < 1){
+				fprintf(stderr, "Invalid memory budget %s", argv[i]);
+				exit(EXIT_FAILURE);
+			}
+			g_serve_memory = (size_t) megabytes << 20;
+		}else if(strcmp(arg, "--color") == 0){	//Colour output
+			if(i+1>= argc){ //update before controll
+				fprintf(stderr, "Missing value for option %s", arg);
+				exit(EXIT_FAILURE);
+			}
+
+			char* mode = argv[++i];
+
+			if(strcmp(mode, "truecolor") == 0) g_color = COLOR_TRUECOLOR;
+			else if(strcmp(mode, "256") == 0) g_color = COLOR_256;
+			else{
+				fprintf(stderr, "Unknown color mode: %s\n", mode);
+				exit(EXIT_FAILURE);
+			}
+		}else if(strcmp(arg, "--video") == 0){	//Raw RGBA video from stdin
+			if(i+1>= argc){ //update before controll
+				fprintf(stderr, "Missing value for option %s", arg);
+				exit(EXIT_FAILURE);
+			}
+
+			if(!parse_size(argv[++i], &g_video_width, &g_video_height, (size_t) 1 << 28)){
+				fprintf(stderr, "Invalid frame size %s", argv[i]);
+				exit(EXIT_FAILURE);
+			}
+		}else if(strcmp(arg, "--size") == 0){	//Raw RGBA input size
+			if(i+1>= argc){ //update before controll
+				fprintf(stderr, "Missing value for option %s", arg);
+				exit(EXIT_FAILURE);
+			}
+
+			if(!parse_size(argv[++i], &g_raw_width, &g_raw_height, INT_MAX)){
+				fprintf(stderr, "Invalid image size %s", argv[i]);
+				exit(EXIT_FAILURE);
+			}
+		}else if(strcmp(arg, "--dots") == 0){	//Braille dot mode
+			g_dots = true;
+		}else if(strcmp(arg, "--dots-threshold") == 0){	//Braille dot threshold
+			if(i+1>= argc){ //update before controll
+				fprintf(stderr, "Missing value for option %s", arg);
+				exit(EXIT_FAILURE);
+			}
+
+			char* endptr;
+			long threshold = strtol(argv[++i], &endptr, 10);
+
+			if(*endptr != '\0' || threshold < 0 || threshold > 255){
+				fprintf(stderr, "Invalid dot threshold %s", argv[i]);
+				exit(EXIT_FAILURE);
+			}
+			g_dots = true;
+			g_dots_threshold = (int) threshold;
+		}else if(strcmp(arg, "--shape") == 0){	//shape matching
+			g_shape = true;
 		}else{
 			fprintf(stderr, "Unknown option: %s", arg);
 			exit(EXIT_FAILURE);
 		}		
 	}
-}
 
-int main(int argc, char* argv[]){
-	args_parser(argc, argv);
+	if(g_dots && g_shape){
+		fprintf(stderr, "--shape cannot be combined with --dots\n");
+		exit(EXIT_FAILURE);
+	}
 
-	FILE* file_ptr = input_validator(argv[1]);
-	if(!file_ptr){
-		printf("Error during the file reading");
+	if(g_video_width && (g_dots || g_shape || g_output_dir || g_serve_socket || g_connect_socket || g_input_count != 0)){
+		fprintf(stderr, "--video reads frames from stdin and takes no input path, --dots, --shape, -o, --serve or --connect\n");
 		exit(EXIT_FAILURE);
 	}
 
+	if(!g_output_dir && !g_serve_socket && !g_video_width && g_input_count != 1){
+		fprintf(stderr, "A single file path argument is required\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if((g_dots || g_shape || g_partial_decode || g_color != COLOR_NONE) && (g_serve_socket || g_connect_socket)){
+		fprintf(stderr, "--dots, --shape, --partial-decode and --color are not supported by the render daemon\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if(g_raw_width && (g_serve_socket || g_connect_socket || g_video_width)){
+		fprintf(stderr, "--size is not supported with --serve, --connect or --video\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * RenderState every resource owned by a single render_file call.
+ *
+ * Kept on the heap and only referenced through a pointer set before setjmp, so its
+ * fields keep their values when libpng longjmps back on a decode error and the
+ * handler can release whatever was allocated so far.
+ *
+ * Every buffer the render needs (decoded image, rows, glyphs, colours, dots) is carved
+ * from arena, which is reset when the state is released.
+ */
+typedef struct RenderState{
+	Arena* arena;
+	MappedInput mapped;
+	FILE* file_ptr;
+	png_structp png_ptr;
+	png_infop info_ptr;
+	AsciiImageObject* image;
+	LanczosStream* stream;
+	Pixel* source_row;
+	Pixel* scaled_row;
+	wchar_t* ascii_row;
+	wchar_t* glyphs;
+	uint8_t* dots;
+	Pixel* colors;
+} RenderState;
+
+/*
+ * render_state_release frees every resource of a RenderState, and the state itself, and resets its arena.
+ */
+static void render_state_release(RenderState* state){
+	if(state->png_ptr) png_destroy_read_struct(&state->png_ptr, state->info_ptr ? &state->info_ptr : NULL, NULL);
+	if(state->file_ptr) fclose(state->file_ptr);
+	mapped_input_close(&state->mapped);
+	image_struct_free(state->image);
+	lanczos_stream_destroy(state->stream);
+	arena_free(state->arena, state->source_row);
+	arena_free(state->arena, state->scaled_row);
+	arena_free(state->arena, state->ascii_row);
+	arena_free(state->arena, state->glyphs);
+	arena_free(state->arena, state->dots);
+	arena_free(state->arena, state->colors);
+	if(state->arena) arena_reset(state->arena);
+	free(state);
+}
+
+/*
+ * stream_row_reader PipelineRowReader of stream_render: the next row of the PNG or of the mapped input.
+ *
+ * libpng errors longjmp to a handler set here for every row: the one render_file
+ * registered would unwind pipeline_stream while its scaler and writer threads still
+ * run. Once the pipeline returns, only png_destroy_read_struct is called on png_ptr.
+ */
+static bool stream_row_reader(void* context, int row, Pixel* destination){
+	RenderState* state = (RenderState*) context;
+
+	if(!state->png_ptr){
+		const Pixel* source_row = mapped_input_row(&state->mapped, row, destination);
+		if(source_row != destination) memcpy(destination, source_row, sizeof(Pixel) * state->mapped.width);
+		return true;
+	}
+
+	if(setjmp(png_jmpbuf(state->png_ptr))) return false;
+	png_read_row(state->png_ptr, (png_bytep) destination, NULL);
+	return true;
+}
+
+/*
+ * stream_render decodes, scales and prints an image one row at a time.
+ * - state:      Render state holding either the libpng structs, after png_read_info, or a mapped input.
+ * - width:      The width of the image in pixels.
+ * - height:     The height of the image in pixels.
+ * - threads:    With 2 or more, decode, scaling and output run as a pipeline on three threads.
+ * - output:     Buffered writer receiving the glyph rows.
+ *
+ * Source rows are read with png_read_row into a single reused Pixel row, or taken from
+ * the mapped input (expanded into that row for PPM, in place for raw RGBA), and fed to a
+ * LanczosStream, which keeps only the SAMPLE_SIZE filtered rows the next output row
+ * depends on. Each output row is converted to glyphs and printed as soon as its
+ * neighbourhood is complete, so peak memory is O(width) regardless of the height.
+ *
+ * Interlaced PNGs can only be delivered row by row after all passes are decoded, so
+ * they are left to the regular whole-image path (or to render_passes with
+ * --partial-decode), as are fractional scale factors, the box filter, --dots, --shape
+ * and --color, which the row-by-row path does not implement.
+ *
+ * Returns: 1 if the image was rendered, 0 if the caller must use the regular path,
+ *          -1 on memory allocation failure, -2 if a pipelined decode failed.
+ */
+static int stream_render(RenderState* state, int width, int height, int threads, OutputBuffer* output){
+	int scale_factor = (int) g_scale;
+
+	if(state->png_ptr && png_get_interlace_type(state->png_ptr, state->info_ptr) != PNG_INTERLACE_NONE) return 0;
+	if(g_dots || g_shape || g_color != COLOR_NONE) return 0;
+	if(scale_factor != g_scale || resample_resolve_filter(g_filter, g_scale) != RESAMPLE_LANCZOS) return 0;
+	if(width / scale_factor <= 0 || height / scale_factor <= 0) return 0;
+
+	state->stream = lanczos_stream_create(width, height, scale_factor, g_variant);
+	if(!state->stream) return -1;
+
+	if(state->png_ptr) png_normalize_rgba(state->png_ptr, state->info_ptr);
+
+	if(threads > 1){
+		int piped = pipeline_stream(state->stream, g_palette, stream_row_reader, state, output);
+		if(piped != 0) return piped > 0 ? 1 : -2;
+	}
+
+	int scaled_width	= state->stream->width;
+	state->source_row	= (Pixel*) arena_alloc(state->arena, sizeof(Pixel) * width);
+	state->scaled_row	= (Pixel*) arena_alloc(state->arena, sizeof(Pixel) * scaled_width);
+	state->ascii_row	= (wchar_t*) arena_alloc(state->arena, sizeof(wchar_t) * scaled_width);
+	if(!state->source_row || !state->scaled_row || !state->ascii_row) return -1;
+
+	for(int row = 0; row < height; row++){
+		StatsMark mark = stats_begin();
+		const Pixel* source_row = state->source_row;
+		if(state->png_ptr) png_read_row(state->png_ptr, (png_bytep) state->source_row, NULL);
+		else source_row = mapped_input_row(&state->mapped, row, state->source_row);
+		stats_end(STATS_DECODE, mark);
+
+		mark = stats_begin();
+		lanczos_stream_push(state->stream, source_row);
+		while(lanczos_stream_pull(state->stream, state->scaled_row)){
+			asciify_into(state->scaled_row, 1, scaled_width, g_palette, state->ascii_row, 1);
+			stats_end(STATS_RENDER, mark);
+
+			mark = stats_begin();
+			output_glyph_rows(output, state->ascii_row, 1, scaled_width);
+			stats_end(STATS_OUTPUT, mark);
+			mark = stats_begin();
+		}
+		stats_end(STATS_RENDER, mark);
+	}
+
+	return 1;
+}
+
+/*
+ * render_glyphs renders a decoded image in the selected mode and writes it to the output.
+ * - state:          Render state whose image is decoded.
+ * - width, height:  Size of the image.
+ * - scale:          Downscale factor of the decoded image: g_scale, or less for a reduced decode.
+ * - threads:        Number of worker threads used for scaling.
+ * - output:         Buffered writer receiving the glyph rows.
+ *
+ * Palette glyphs, picked by brightness or by shape, or Braille dots, optionally with
+ * one colour per cell (--color).
+ *
+ * Returns: 1 on success, -1 on memory allocation failure.
+ */
+static int render_glyphs(RenderState* state, int width, int height, double scale, int threads, OutputBuffer* output){
+	int rows	= g_dots ? dots_cells(resample_size(height, scale), DOTS_CELL_HEIGHT) : resample_size(height, scale);
+	int cols	= g_dots ? dots_cells(resample_size(width, scale), DOTS_CELL_WIDTH) : resample_size(width, scale);
+	size_t cells	= (size_t) rows * cols;
+
+	if(g_color != COLOR_NONE){
+		state->colors = (Pixel*) arena_alloc(state->arena, cells * sizeof(Pixel));
+		if(!state->colors) return -1;
+	}
+
+	// Dots are printed straight from their masks unless they are coloured
+	if(!g_dots || g_color != COLOR_NONE){
+		state->glyphs = (wchar_t*) arena_alloc(state->arena, cells * sizeof(wchar_t));
+		if(!state->glyphs) return -1;
+	}
+
+	StatsMark mark = stats_begin();
+	bool rendered;
+	if(g_dots){
+		state->dots = asciify_dots(state->image, scale, threads, g_variant, g_filter, g_pyramid, g_dots_threshold, state->colors,
+					   state->arena);
+		rendered = state->dots != NULL;
+		// Coloured cells go through the generic writer, which takes code points
+		for(size_t cell = 0; rendered && state->glyphs && cell < cells; cell++) state->glyphs[cell] = 0x2800 + state->dots[cell];
+	}else if(g_shape){
+		rendered = asciify_shapes_into(state->image, scale, g_palette, state->glyphs, state->colors, threads, g_variant,
+					       g_filter, g_pyramid, state->arena);
+	}else{
+		rendered = asciify_resampled_into(state->image, scale, g_palette, state->glyphs, state->colors, threads, g_variant,
+						  g_filter, g_pyramid);
+	}
+	stats_end(STATS_RENDER, mark);
+	if(!rendered) return -1;
+
+	mark = stats_begin();
+	if(g_color != COLOR_NONE)	output_color_rows(output, state->glyphs, state->colors, rows, cols, g_color);
+	else if(g_dots)			output_braille_rows(output, state->dots, rows, cols);
+	else				output_glyph_rows(output, state->glyphs, rows, cols);
+
+	output_flush(output);
+	stats_end(STATS_OUTPUT, mark);
+	return 1;
+}
+
+/*
+ * render_mapped converts a PPM or raw RGBA input opened by mapped_input_open to ASCII art.
+ * - state:       Render state whose mapped input is filled.
+ * - output:      Buffered writer receiving the glyph rows.
+ * - threads:     Number of worker threads used for scaling and for PPM expansion.
+ *
+ * There is nothing to decode: --stream reads the rows straight from the mapping, and
+ * the whole-image path scales raw RGBA from the mapping itself.
+ *
+ * Returns: 1 on success, -1 on memory allocation failure.
+ */
+static int render_mapped(RenderState* state, OutputBuffer* output, int threads){
+	int width	= state->mapped.width;
+	int height	= state->mapped.height;
+	int rendered	= g_stream ? stream_render(state, width, height, threads, output) : 0;
+	if(rendered != 0) return rendered;
+
+	StatsMark mark = stats_begin();
+	state->image = mapped_input_image(&state->mapped, threads, state->arena);
+	stats_end(STATS_DECODE, mark);
+	if(!state->image) return -1;
+
+	return render_glyphs(state, width, height, g_scale, threads, output);
+}
+
+/*
+ * reduced_extent returns the size, along one axis, a decoded lattice is cropped to.
+ * - size:       Size of the PNG.
+ * - lattice:    Size of the lattice, ceil(size / reduction).
+ * - reduction:  Lattice step.
+ *
+ * The largest size at most lattice whose resample_size at g_scale / reduction is the
+ * resample_size of the full image at g_scale, so the frame matches a full decode.
+ */
+static int reduced_extent(int size, int lattice, int reduction){
+	int target = resample_size(size, g_scale), extent = lattice;
+
+	while(extent > 1 && resample_size(extent, g_scale / reduction) > target) extent--;
+	return extent;
+}
+
+/*
+ * render_passes renders an interlaced PNG from the Adam7 passes its scale needs.
+ * - state:          Render state holding the libpng structs, after png_read_info.
+ * - width, height:  Size of the PNG.
+ * - threads:        Number of worker threads used for scaling.
+ * - output:         Buffered writer receiving the glyph rows.
+ *
+ * The image decoded is the lattice of png_adam7_reduction, cropped so that scaling it
+ * by g_scale / reduction gives the frame of the full image.
+ *
+ * Returns: 1 if the image was rendered, 0 if the caller must decode the whole image,
+ *          -1 on memory allocation failure.
+ */
+static int render_passes(RenderState* state, int width, int height, int threads, OutputBuffer* output){
+	int reduction = png_adam7_reduction(state->png_ptr, state->info_ptr, g_scale);
+	if(reduction == 1) return 0;
+
+	int lattice_width	= (width + reduction - 1) / reduction;
+	int lattice_height	= (height + reduction - 1) / reduction;
+
+	StatsMark mark = stats_begin();
+	// The row first: carved after the lattice it would not fit in its block and open a second, larger one
+	state->source_row	= (Pixel*) arena_alloc(state->arena, sizeof(Pixel) * lattice_width);
+	state->image		= image_struct_alloc(lattice_width, lattice_height, state->arena);
+	if(!state->image || !state->source_row) return -1;
+
+	image_struct_init_passes(state->image, state->png_ptr, state->info_ptr, reduction, state->source_row);
+	image_struct_crop(state->image, reduced_extent(width, lattice_width, reduction), reduced_extent(height, lattice_height, reduction));
+	stats_end(STATS_DECODE, mark);
+
+	return render_glyphs(state, state->image->width, state->image->height, g_scale / reduction, threads, output);
+}
+
+/*
+ * render_file converts a single PNG, PPM or raw RGBA file to ASCII art.
+ * - input_path:  Path of the file, or "-" for stdin (PPM or raw RGBA only).
+ * - output:      Buffered writer receiving the glyph rows.
+ * - threads:     Number of worker threads used for scaling and glyph mapping.
+ * - arena:       Arena every buffer of the render is carved from, reset before returning; NULL for the heap.
+ *
+ * Every call owns its own libpng read struct, so several files can be rendered
+ * concurrently. Nothing is leaked and the process is never terminated on failure:
+ * libpng errors are caught by a setjmp handler local to this call.
+ *
+ * Returns: true on success, false on failure (a message naming the file is printed on stderr).
+ */
+static bool render_file(const char* input_path, OutputBuffer* output, int threads, Arena* arena){
+	RenderState* state = (RenderState*) calloc(1, sizeof(RenderState));
+	if(!state){
+		fprintf(stderr, "%s: Out of memory\n", input_path);
+		return false;
+	}
+	state->arena = arena;
+
+	StatsMark header_mark = stats_begin();
+	int mapped = mapped_input_open(input_path, g_raw_width, g_raw_height, &state->mapped);
+	if(mapped != 0){
+		stats_end(STATS_HEADER, header_mark);
+		int rendered = mapped > 0 ? render_mapped(state, output, threads) : 0;
+		if(rendered < 0) fprintf(stderr, "%s: Out of memory\n", input_path);
+
+		render_state_release(state);
+		return rendered > 0;
+	}
+
+	state->file_ptr = input_validator(input_path);
+	if(!state->file_ptr){
+		render_state_release(state);
+		return false;
+	}
+
 	// SUB-ROUTINE: Create libpng structures
-	int width, height;
-	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-	png_infop info_ptr = png_create_info_struct(png_ptr);
+	state->png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if(state->png_ptr) state->info_ptr = png_create_info_struct(state->png_ptr);
+	if(!state->png_ptr || !state->info_ptr){
+		fprintf(stderr, "%s: Out of memory\n", input_path);
+		render_state_release(state);
+		return false;
+	}
 
 	// SUB-ROUTINE: Register libpng error handler and recover on failure
-	if (setjmp(png_jmpbuf(png_ptr))){
-		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-		fclose(file_ptr);
-		fprintf(stderr, "Error occurred while processing file\n");
-		exit(EXIT_FAILURE);
+	if (setjmp(png_jmpbuf(state->png_ptr))){
+		fprintf(stderr, "%s: Error occurred while processing file\n", input_path);
+		render_state_release(state);
+		return false;
 	}
 
 	// SUB-ROUTINE: Read PNG header, metadata and populate structures
-	AsciiImageObject* image_struct;
-	png_init_io(png_ptr, file_ptr);		// associate file_ptr with png_ptr
-	png_set_sig_bytes(png_ptr, 8);		// inform libpng that 8 bytes were already read
-	png_read_info(png_ptr, info_ptr);	// read metadata into info_ptr
-
-	width 	= png_get_image_width(png_ptr, info_ptr);
-	height	= png_get_image_height(png_ptr, info_ptr);
-	
-	//TODO: refactor after cli command are completed
-	image_struct = image_struct_init(width, height, png_ptr, info_ptr);
-	image_struct->edited_image = lanczos_scale(image_struct, g_scale_factor);
-	image_struct->ascii_image = asciify_image(image_struct->edited_image, height/g_scale_factor, width/g_scale_factor, g_palette);
-	
-
-	//Peak production code, jokes aside, it's just for testing until the interface is finished.
-	setlocale(LC_CTYPE, "");
-	fwide(stdout, 1);
-	for(int row = 0; row < height/g_scale_factor; row++){
-		for(int col = 0; col < width/g_scale_factor; col++){
-			wchar_t current_char = image_struct->ascii_image[array_mapping(row, col, width/g_scale_factor)]; 
-			wprintf(L"%lc", current_char);
+	png_init_io(state->png_ptr, state->file_ptr);		// associate file_ptr with png_ptr
+	png_set_sig_bytes(state->png_ptr, 8);			// inform libpng that 8 bytes were already read
+	png_read_info(state->png_ptr, state->info_ptr);		// read metadata into info_ptr
+
+	stats_end(STATS_HEADER, header_mark);
+
+	int width	= png_get_image_width(state->png_ptr, state->info_ptr);
+	int height	= png_get_image_height(state->png_ptr, state->info_ptr);
+	int streamed	= g_stream ? stream_render(state, width, height, threads, output) : 0;
+
+	if(streamed == 0 && g_partial_decode) streamed = render_passes(state, width, height, threads, output);
+
+	if(streamed == 0){
+		StatsMark mark = stats_begin();
+		state->image = image_struct_alloc(width, height, state->arena);
+		if(state->image){
+			image_struct_init(state->image, state->png_ptr, state->info_ptr);
+			stats_end(STATS_DECODE, mark);
+
+			// Only glyphs (and their colours) are printed: scale and map in one fused pass,
+			// edited_image is never materialized
+			streamed = render_glyphs(state, width, height, g_scale, threads, output);
+		}else{
+			streamed = -1;
+		}
+	}
+
+	if(streamed == -1) fprintf(stderr, "%s: Out of memory\n", input_path);
+	if(streamed == -2) fprintf(stderr, "%s: Error occurred while processing file\n", input_path);
+
+	render_state_release(state);
+	return streamed >= 0;
+}
+
+/*
+ * render_cached converts a PNG file to ASCII art through the render cache.
+ * - input_path:  Path of the PNG file.
+ * - output:      Buffered writer receiving the glyph rows.
+ * - threads:     Number of worker threads used on a cache miss.
+ * - arena:       Arena forwarded to render_file.
+ *
+ * The key hashes the file content together with the program version, palette, scale
+ * factor, the filter and the scaler variant that will actually run (SIMD variants may
+ * differ by one LSB), --dots with its threshold, --shape, --color, --partial-decode,
+ * the raw RGBA size and --pyramid. The thread count and --stream do not change the
+ * output and are left out.
+ *
+ * On a hit the stored UTF-8 output is mapped and written as is: no decode, no scaling.
+ * On a miss the image is rendered into a temporary file in the cache directory, sent
+ * from there and then renamed into place. Any cache failure falls back to render_file.
+ * Every new entry prunes the least recently used ones beyond --cache-size.
+ *
+ * Returns: true on success, false on failure.
+ */
+static bool render_cached(const char* input_path, OutputBuffer* output, int threads, Arena* arena){
+	char parameters[128];
+	uint64_t key;
+	int length = snprintf(parameters, sizeof(parameters), "YAscii %s p%d s%.17g f%d v%d d%d h%d c%d i%d r%dx%d%s", YASCII_VERSION,
+		(int) g_palette, g_scale, (int) resample_resolve_filter(g_filter, g_scale),
+		(int) lanczos_resolve_variant(g_variant), g_dots ? g_dots_threshold : -1, (int) g_shape, (int) g_color,
+		(int) g_partial_decode, g_raw_width, g_raw_height, g_pyramid ? " pyramid" : "");
+
+	// stdin cannot be hashed and then read again
+	if(!g_cache_dir || strcmp(input_path, "-") == 0 || !cache_key(input_path, parameters, (size_t) length, &key))
+		return render_file(input_path, output, threads, arena);
+
+	char* entry_path = cache_entry_path(g_cache_dir, key);
+	if(!entry_path) return render_file(input_path, output, threads, arena);
+
+	if(cache_send(entry_path, output)){
+		cache_touch(entry_path);
+		free(entry_path);
+		return true;
+	}
+
+	char* temp_path = NULL;
+	OutputBuffer entry;
+	int fd = cache_create(g_cache_dir, &temp_path);
+
+	if(fd < 0 || !output_open(&entry, fd, OUTPUT_BUFFER_SIZE)){
+		if(fd >= 0){
+			close(fd);
+			unlink(temp_path);
+			free(temp_path);
+		}
+		free(entry_path);
+		return render_file(input_path, output, threads, arena);
+	}
+
+	bool success = render_file(input_path, &entry, threads, arena);
+	if(!output_close(&entry)) success = false;
+	close(fd);
+
+	// Served from the temporary file, so a failed rename only costs the cache entry
+	if(success && cache_send(temp_path, output)){
+		if(cache_commit(temp_path, entry_path) && g_cache_size) cache_prune(g_cache_dir, g_cache_size);
+	}else{
+		if(success) success = render_file(input_path, output, threads, arena);
+		unlink(temp_path);
+		free(temp_path);
+	}
+
+	free(entry_path);
+	return success;
+}
+
+/*
+ * read_path_list appends the paths listed on stdin, one per line, to g_inputs.
+ *
+ * Empty lines are ignored and a trailing '\r' is stripped.
+ * Exits the program with EXIT_FAILURE on memory allocation failure.
+ */
+static void read_path_list(void){
+	int capacity = g_input_count;
+	char* line = NULL;
+	size_t line_capacity = 0;
+	ssize_t length;
+
+	while((length = getline(&line, &line_capacity, stdin)) > 0){
+		while(length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) line[--length] = '\0';
+		if(length == 0) continue;
+
+		if(g_input_count == capacity){
+			capacity = capacity ? capacity * 2 : 64;
+			char** grown = (char**) realloc(g_inputs, sizeof(char*) * capacity);
+			if(!grown) exit(EXIT_FAILURE);
+			g_inputs = grown;
+		}
+
+		g_inputs[g_input_count] = strdup(line);
+		if(!g_inputs[g_input_count]) exit(EXIT_FAILURE);
+		g_input_count++;
+	}
+
+	free(line);
+}
+
+/*
+ * batch_output_path builds <g_output_dir>/<input basename without extension>.txt
+ * - input_path: Path of the input image.
+ *
+ * Returns: A newly allocated string, or NULL on allocation failure.
+ */
+static char* batch_output_path(const char* input_path){
+	const char* name = strrchr(input_path, '/');
+	name = name ? name + 1 : input_path;
+
+	const char* extension = strrchr(name, '.');
+	size_t name_length = (extension && extension != name) ? (size_t) (extension - name) : strlen(name);
+	size_t size = strlen(g_output_dir) + 1 + name_length + sizeof(".txt");
+	char* path = (char*) malloc(size);
+
+	if(path) snprintf(path, size, "%s/%.*s.txt", g_output_dir, (int) name_length, name);
+	return path;
+}
+
+/*
+ * BatchOutput output file of one batch input, sorted to find inputs sharing a name.
+ */
+typedef struct BatchOutput{
+	char* path;
+	int task;
+} BatchOutput;
+
+static int compare_batch_output(const void* a, const void* b){
+	const BatchOutput* left		= (const BatchOutput*) a;
+	const BatchOutput* right	= (const BatchOutput*) b;
+	int order = strcmp(left->path, right->path);
+
+	return order ? order : (left->task > right->task) - (left->task < right->task);
+}
+
+/*
+ * batch_output_paths names the output file of every input before anything is rendered.
+ * - failures:  Incremented for every input that gets no output file.
+ *
+ * Outputs are named after the input basename, so d1/x.png and d2/x.ppm both map to
+ * x.txt. The first of them on the command line keeps the name and the others are
+ * reported and skipped, instead of racing on the same file.
+ *
+ * Returns: An array of g_input_count paths, NULL for a skipped input, or NULL on allocation failure.
+ */
+static char** batch_output_paths(int* failures){
+	char** paths		= (char**) calloc((size_t) g_input_count + 1, sizeof(char*));
+	BatchOutput* sorted	= (BatchOutput*) malloc(sizeof(BatchOutput) * ((size_t) g_input_count + 1));
+	int count		= 0;
+
+	if(!paths || !sorted){
+		free(paths);
+		free(sorted);
+		return NULL;
+	}
+
+	for(int task = 0; task < g_input_count; task++){
+		paths[task] = batch_output_path(g_inputs[task]);
+		if(!paths[task]){
+			fprintf(stderr, "%s: Out of memory\n", g_inputs[task]);
+			(*failures)++;
+			continue;
+		}
+		sorted[count++] = (BatchOutput) { paths[task], task };
+	}
+
+	qsort(sorted, (size_t) count, sizeof(BatchOutput), compare_batch_output);
+	for(int index = 1; index < count; index++){
+		int first = index - 1;
+		while(index < count && strcmp(sorted[index].path, sorted[first].path) == 0){
+			int task = sorted[index].task;
+			fprintf(stderr, "%s: %s is already the output of %s, skipped\n", g_inputs[task], paths[task],
+				g_inputs[sorted[first].task]);
+			free(paths[task]);
+			paths[task] = NULL;
+			(*failures)++;
+			index++;
 		}
-		wprintf(L"\n");
 	}
 
-	fclose(file_ptr);
-	return EXIT_SUCCESS;
+	free(sorted);
+	return paths;
+}
+
+/*
+ * batch_temp_path builds <g_output_dir>/.<output file name>.XXXXXX for mkstemp.
+ *
+ * Returns: A newly allocated string, or NULL on allocation failure.
+ */
+static char* batch_temp_path(const char* output_path){
+	const char* name = strrchr(output_path, '/') + 1;
+	size_t size = strlen(g_output_dir) + 2 + strlen(name) + sizeof(".XXXXXX");
+	char* path = (char*) malloc(size);
+
+	if(path) snprintf(path, size, "%s/.%s.XXXXXX", g_output_dir, name);
+	return path;
+}
+
+/*
+ * BatchJob shared state of a batch run.
+ * - inner_threads:  Threads each image may use for its own scaling.
+ * - output_paths:   Output file of every input, NULL for an input already counted as failed.
+ * - failures:       Number of images that could not be rendered.
+ * - arenas:         One Arena per worker, reused by every image the worker renders.
+ * - arena_busy:     Whether each arena is taken by a running task.
+ * - arena_count:    Number of arenas, the number of workers.
+ */
+typedef struct BatchJob{
+	int inner_threads;
+	char** output_paths;
+	atomic_int failures;
+	Arena* arenas;
+	atomic_bool* arena_busy;
+	int arena_count;
+} BatchJob;
+
+/*
+ * batch_arena_acquire takes a free arena of a BatchJob.
+ *
+ * There are as many arenas as workers and each task holds one at a time, so a free
+ * one always exists; parallel_tasks does not say which worker runs a task, hence the scan.
+ *
+ * Returns: The index of the arena, or -1 if there are none (the task then uses the heap).
+ */
+static int batch_arena_acquire(BatchJob* job){
+	for(int index = 0; index < job->arena_count; index++){
+		bool expected = false;
+		if(atomic_compare_exchange_strong(&job->arena_busy[index], &expected, true)) return index;
+	}
+	return -1;
+}
+
+/*
+ * batch_render_task renders g_inputs[task] into its file in g_output_dir.
+ *
+ * The image is rendered into a temporary file renamed over the output once complete,
+ * so a failed render never truncates or removes an existing output.
+ */
+static void batch_render_task(void* context, int task){
+	BatchJob* job = (BatchJob*) context;
+	const char* input_path = g_inputs[task];
+	const char* output_path = job->output_paths[task];
+	if(!output_path) return;
+
+	char* temp_path = batch_temp_path(output_path);
+	OutputBuffer output;
+	bool success = false;
+	int arena = batch_arena_acquire(job);
+
+	if(!temp_path || !output_open(&output, -1, OUTPUT_BUFFER_SIZE)){
+		fprintf(stderr, "%s: Out of memory\n", input_path);
+	}else{
+		output.fd = mkstemp(temp_path);
+		if(output.fd < 0){
+			fprintf(stderr, "%s: Cannot create %s\n", input_path, output_path);
+			output_close(&output);
+		}else{
+			fchmod(output.fd, 0644);
+			success = render_cached(input_path, &output, job->inner_threads, arena >= 0 ? &job->arenas[arena] : NULL);
+			if(!output_close(&output)){
+				fprintf(stderr, "%s: Error while writing %s\n", input_path, output_path);
+				success = false;
+			}
+			close(output.fd);
+			if(success && rename(temp_path, output_path) != 0){
+				fprintf(stderr, "%s: Cannot create %s\n", input_path, output_path);
+				success = false;
+			}
+			if(!success) unlink(temp_path);
+		}
+	}
+
+	if(!success) atomic_fetch_add(&job->failures, 1);
+	if(arena >= 0) atomic_store(&job->arena_busy[arena], false);
+	free(temp_path);
+}
+
+/*
+ * batch_render renders every input into g_output_dir on a pool of g_threads workers.
+ *
+ * Images are handed out one at a time; when there are fewer images than threads
+ * the spare threads are used inside each image. A failing image is reported and
+ * skipped, the rest of the batch still runs. Each running task renders into an arena
+ * of its own, reset after every image, so after the first few images a batch stops
+ * allocating and faulting in fresh pages.
+ *
+ * Returns: EXIT_SUCCESS if every image was rendered, EXIT_FAILURE otherwise.
+ */
+static int batch_render(void){
+	BatchJob job;
+
+	if(g_input_count == 0 || (g_input_count == 1 && strcmp(g_inputs[0], "-") == 0)){
+		g_input_count = 0;
+		read_path_list();
+	}
+
+	int failures = 0;
+	job.output_paths = batch_output_paths(&failures);
+	if(!job.output_paths){
+		fprintf(stderr, "Out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	int workers = (g_input_count < g_threads) ? g_input_count : g_threads;
+	job.inner_threads = (workers > 0 && g_threads / workers > 1) ? g_threads / workers : 1;
+	atomic_init(&job.failures, failures);
+
+	job.arena_count	= workers > 0 ? workers : 0;
+	job.arenas	= (Arena*) malloc(sizeof(Arena) * (job.arena_count + 1));
+	job.arena_busy	= (atomic_bool*) malloc(sizeof(atomic_bool) * (job.arena_count + 1));
+	if(!job.arenas || !job.arena_busy) job.arena_count = 0;
+	for(int index = 0; index < job.arena_count; index++){
+		arena_init(&job.arenas[index]);
+		atomic_init(&job.arena_busy[index], false);
+	}
+
+	parallel_tasks(g_input_count, workers, batch_render_task, &job);
+
+	for(int index = 0; index < job.arena_count; index++) arena_release(&job.arenas[index]);
+	free(job.arenas);
+	free(job.arena_busy);
+	for(int task = 0; task < g_input_count; task++) free(job.output_paths[task]);
+	free(job.output_paths);
+
+	failures = atomic_load(&job.failures);
+	if(failures) fprintf(stderr, "%d of %d images failed\n", failures, g_input_count);
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[]){
+	if(argc >= 2 && strcmp(argv[1], "--self-test") == 0) return run_self_test(online_cpu_count());
+
+	args_parser(argc, argv);
+	if(g_threads == 0) g_threads = online_cpu_count();
+
+	if(g_serve_socket) return serve(g_serve_socket, g_serve_memory, g_threads, g_variant, g_filter, g_pyramid);
+	if(g_connect_socket) return serve_request(g_connect_socket, g_inputs[0], g_palette, g_scale);
+	if(g_video_width) return video_play(STDIN_FILENO, g_video_width, g_video_height, g_scale, g_palette, g_color, g_threads,
+					    g_variant, g_filter);
+
+	StatsMark start = stats_begin();
+	bool success;
+
+	if(g_output_dir){
+		success = batch_render() == EXIT_SUCCESS;
+	}else{
+		OutputBuffer output;
+		Arena arena;
+		if(!output_open(&output, STDOUT_FILENO, OUTPUT_BUFFER_SIZE)) exit(EXIT_FAILURE);
+
+		arena_init(&arena);
+		success = render_cached(g_inputs[0], &output, g_threads, &arena);
+		if(!output_close(&output)) success = false;
+		arena_release(&arena);
+	}
+
+	if(g_stats_enabled) stats_report(stderr, start, g_stats_json);
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
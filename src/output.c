@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "output.h"
+
+/*
+ * utf8_encode encodes a single code point as UTF-8.
+ * - glyph:  Code point to encode. Invalid code points are encoded as U+FFFD.
+ * - bytes:  Destination of at least UTF8_MAX_BYTES bytes.
+ *
+ * Returns: Number of bytes written (1 to 4).
+ */
+size_t utf8_encode(wchar_t glyph, char* bytes){
+	unsigned long code = (unsigned long) glyph;
+
+	if((code >= 0xD800 && code <= 0xDFFF) || code > 0x10FFFF) code = 0xFFFD;
+
+	if(code < 0x80){
+		bytes[0] = (char) code;
+		return 1;
+	}
+	if(code < 0x800){
+		bytes[0] = (char) (0xC0 | (code >> 6));
+		bytes[1] = (char) (0x80 | (code & 0x3F));
+		return 2;
+	}
+	if(code < 0x10000){
+		bytes[0] = (char) (0xE0 | (code >> 12));
+		bytes[1] = (char) (0x80 | ((code >> 6) & 0x3F));
+		bytes[2] = (char) (0x80 | (code & 0x3F));
+		return 3;
+	}
+	bytes[0] = (char) (0xF0 | (code >> 18));
+	bytes[1] = (char) (0x80 | ((code >> 12) & 0x3F));
+	bytes[2] = (char) (0x80 | ((code >> 6) & 0x3F));
+	bytes[3] = (char) (0x80 | (code & 0x3F));
+	return 4;
+}
+
+/*
+ * output_open initializes an OutputBuffer.
+ * - out:       Buffer to initialize.
+ * - fd:        Destination file descriptor.
+ * - capacity:  Size of the byte buffer, at least UTF8_MAX_BYTES.
+ *
+ * Returns: true on success, false on allocation failure.
+ */
+bool output_open(OutputBuffer* out, int fd, size_t capacity){
+	if(capacity < UTF8_MAX_BYTES) capacity = UTF8_MAX_BYTES;
+
+	out->fd		= fd;
+	out->length	= 0;
+	out->capacity	= capacity;
+	out->failed	= false;
+	out->data	= (char*) malloc(capacity);
+
+	return out->data != NULL;
+}
+
+/*
+ * output_write_through writes a block to the file descriptor, bypassing the buffer.
+ *
+ * Partial writes and EINTR are retried; any other error marks the buffer as failed.
+ */
+static void output_write_through(OutputBuffer* out, const char* bytes, size_t length){
+	size_t written = 0;
+
+	while(!out->failed && written < length){
+		ssize_t result = write(out->fd, bytes + written, length - written);
+		if(result < 0){
+			if(errno == EINTR) continue;
+			out->failed = true;
+		}else{
+			written += (size_t) result;
+		}
+	}
+}
+
+/*
+ * output_flush writes every buffered byte to the file descriptor.
+ *
+ * Returns: false if any write failed since the buffer was opened.
+ */
+bool output_flush(OutputBuffer* out){
+	output_write_through(out, out->data, out->length);
+
+	out->length = 0;
+	return !out->failed;
+}
+
+/*
+ * output_write appends raw bytes, flushing first if they do not fit.
+ *
+ * Blocks larger than the whole buffer are written straight from the caller's memory,
+ * so a large pre-rendered frame (e.g. a mapped cache entry) is never copied.
+ */
+void output_write(OutputBuffer* out, const void* bytes, size_t length){
+	if(out->length + length > out->capacity) output_flush(out);
+
+	if(length > out->capacity){
+		output_write_through(out, (const char*) bytes, length);
+		return;
+	}
+
+	memcpy(out->data + out->length, bytes, length);
+	out->length += length;
+}
+
+/*
+ * output_glyph_rows appends an ASCII image as UTF-8, one line per row.
+ * - out:    Destination buffer.
+ * - ascii:  Row-major buffer of rows * width glyphs.
+ * - rows:   Number of rows.
+ * - width:  Number of glyphs per row.
+ *
+ * Consecutive identical glyphs are very common (flat areas, backgrounds), so the
+ * encoding of the previous glyph is kept and only re-encoded when the glyph changes.
+ */
+void output_glyph_rows(OutputBuffer* out, const wchar_t* ascii, int rows, int width){
+	wchar_t last_glyph = 0;
+	char encoded[UTF8_MAX_BYTES];
+	size_t encoded_length = utf8_encode(last_glyph, encoded);
+
+	for(int row = 0; row < rows; row++){
+		const wchar_t* glyphs = ascii + (size_t) row * width;
+
+		for(int col = 0; col < width; col++){
+			if(glyphs[col] != last_glyph){
+				last_glyph = glyphs[col];
+				encoded_length = utf8_encode(last_glyph, encoded);
+			}
+			if(out->length + encoded_length > out->capacity) output_flush(out);
+			memcpy(out->data + out->length, encoded, encoded_length);
+			out->length += encoded_length;
+		}
+		output_write(out, "\n", 1);
+	}
+}
+
+/*
+ * output_braille_rows appends Braille dot patterns as UTF-8, one line per row.
+ * - out:    Destination buffer.
+ * - masks:  Row-major buffer of rows * width dot masks, U+2800 + mask being the glyph.
+ * - rows:   Number of rows.
+ * - width:  Number of cells per row.
+ *
+ * All 256 patterns share the lead byte 0xE2 and differ only in the low 8 bits of the
+ * code point, so each cell is three bytes computed with two shifts and no utf8_encode.
+ */
+void output_braille_rows(OutputBuffer* out, const uint8_t* masks, int rows, int width){
+	for(int row = 0; row < rows; row++){
+		const uint8_t* mask = masks + (size_t) row * width;
+
+		for(int col = 0; col < width; col++){
+			if(out->length + 3 > out->capacity) output_flush(out);
+			char* bytes = out->data + out->length;
+			bytes[0] = (char) 0xE2;
+			bytes[1] = (char) (0xA0 | (mask[col] >> 6));
+			bytes[2] = (char) (0x80 | (mask[col] & 0x3F));
+			out->length += 3;
+		}
+		output_write(out, "\n", 1);
+	}
+}
+
+/*
+ * Levels of the 6x6x6 colour cube of the xterm 256-colour palette.
+ */
+static const uint8_t ansi_cube_levels[6] = { 0, 95, 135, 175, 215, 255 };
+
+/*
+ * AnsiTables precomputed 256-colour quantization.
+ * - cube:    Nearest cube level of every 8-bit channel value.
+ * - grey:    Nearest step (0-23) of the grey ramp 8, 18, ..., 238 of every 8-bit grey value.
+ * - square:  Square of every difference between two 8-bit values, indexed by difference + 255.
+ */
+typedef struct AnsiTables{
+	uint8_t cube[256];
+	uint8_t grey[256];
+	uint32_t square[511];
+} AnsiTables;
+
+static AnsiTables ansi_tables;
+static pthread_once_t ansi_tables_once = PTHREAD_ONCE_INIT;
+
+/*
+ * ansi_tables_build fills the 256-colour quantization tables.
+ */
+static void ansi_tables_build(void){
+	for(int value = 0; value < 256; value++){
+		int level = 0;
+		for(int k = 1; k < 6; k++)
+			if(abs(value - ansi_cube_levels[k]) < abs(value - ansi_cube_levels[level])) level = k;
+		ansi_tables.cube[value] = (uint8_t) level;
+
+		int step = (value - 8 + 5) / 10;
+		ansi_tables.grey[value] = (uint8_t) (step < 0 ? 0 : step > 23 ? 23 : step);
+	}
+
+	for(int difference = -255; difference <= 255; difference++)
+		ansi_tables.square[difference + 255] = (uint32_t) (difference * difference);
+}
+
+/*
+ * ansi256_index returns the xterm 256-colour palette entry closest to a pixel.
+ * - pixel:  Colour to quantize; alpha is ignored.
+ *
+ * The nearest cube entry and the nearest grey ramp entry come from per-channel tables;
+ * the one with the smaller squared RGB distance wins. The 16 system colours are never
+ * used since terminals disagree on their values.
+ *
+ * Returns: An index of the 6x6x6 colour cube (16-231) or of the grey ramp (232-255).
+ */
+uint8_t ansi256_index(Pixel pixel){
+	pthread_once(&ansi_tables_once, ansi_tables_build);
+	const AnsiTables* tables = &ansi_tables;
+	const uint32_t* square = tables->square + 255;
+
+	int red = tables->cube[pixel.red], green = tables->cube[pixel.green], blue = tables->cube[pixel.blue];
+	uint32_t cube_distance = square[pixel.red - ansi_cube_levels[red]] + square[pixel.green - ansi_cube_levels[green]] +
+				 square[pixel.blue - ansi_cube_levels[blue]];
+
+	int step = tables->grey[(pixel.red + pixel.green + pixel.blue) / 3];
+	int grey = 8 + 10 * step;
+	uint32_t grey_distance = square[pixel.red - grey] + square[pixel.green - grey] + square[pixel.blue - grey];
+
+	return (uint8_t) (grey_distance < cube_distance ? 232 + step : 16 + 36 * red + 6 * green + blue);
+}
+
+/*
+ * append_decimal writes an 8-bit value in decimal, without leading zeros.
+ *
+ * Returns: Number of bytes written (1 to 3).
+ */
+static inline size_t append_decimal(char* bytes, unsigned value){
+	size_t length = 0;
+
+	if(value >= 100) bytes[length++] = (char) ('0' + value / 100);
+	if(value >= 10) bytes[length++] = (char) ('0' + value / 10 % 10);
+	bytes[length++] = (char) ('0' + value % 10);
+	return length;
+}
+
+/*
+ * Longest colour sequence, ESC[38;2;255;255;255m, plus a glyph.
+ */
+#define COLOR_SEQUENCE_MAX (19 + UTF8_MAX_BYTES)
+
+/*
+ * output_cells appends a run of glyphs, with a foreground colour per glyph if colours are given.
+ * - out:      Destination buffer.
+ * - glyphs:   count glyphs.
+ * - colors:   count colours, one per glyph, or NULL for plain glyphs.
+ * - count:    Number of glyphs.
+ * - mode:     COLOR_TRUECOLOR or COLOR_256; ignored without colours.
+ * - current:  Colour in effect, UINT32_MAX if none; updated as sequences are written.
+ *
+ * Neighbouring cells very often share a colour, and a sequence is several times larger
+ * than the glyph it colours, so a sequence is only emitted when the colour in effect
+ * changes: exact RGB in truecolor mode, palette entry in 256-colour mode. Blank glyphs
+ * (space and the empty Braille pattern) show no foreground and keep the current colour.
+ */
+void output_cells(OutputBuffer* out, const wchar_t* glyphs, const Pixel* colors, int count, ColorMode mode, uint32_t* current){
+	wchar_t last_glyph = 0;
+	char encoded[UTF8_MAX_BYTES];
+	size_t encoded_length = utf8_encode(last_glyph, encoded);
+
+	for(int col = 0; col < count; col++){
+		if(glyphs[col] != last_glyph){
+			last_glyph = glyphs[col];
+			encoded_length = utf8_encode(last_glyph, encoded);
+		}
+		if(out->length + COLOR_SEQUENCE_MAX > out->capacity) output_flush(out);
+		char* bytes = out->data + out->length;
+		size_t length = 0;
+
+		if(colors && last_glyph != L' ' && last_glyph != 0x2800){
+			Pixel pixel = colors[col];
+			uint32_t color = (mode == COLOR_256) ? ansi256_index(pixel) :
+					 (uint32_t) pixel.red << 16 | (uint32_t) pixel.green << 8 | pixel.blue;
+
+			if(color != *current){
+				*current = color;
+				memcpy(bytes, "\x1b[38;", 5);
+				length = 5;
+				if(mode == COLOR_256){
+					memcpy(bytes + length, "5;", 2);
+					length += 2;
+					length += append_decimal(bytes + length, color);
+				}else{
+					memcpy(bytes + length, "2;", 2);
+					length += 2;
+					length += append_decimal(bytes + length, pixel.red);
+					bytes[length++] = ';';
+					length += append_decimal(bytes + length, pixel.green);
+					bytes[length++] = ';';
+					length += append_decimal(bytes + length, pixel.blue);
+				}
+				bytes[length++] = 'm';
+			}
+		}
+
+		memcpy(bytes + length, encoded, encoded_length);
+		out->length += length + encoded_length;
+	}
+}
+
+/*
+ * output_color_rows appends an ASCII image as UTF-8 with a foreground colour per glyph.
+ * - out:     Destination buffer.
+ * - ascii:   Row-major buffer of rows * width glyphs.
+ * - colors:  Row-major buffer of rows * width colours, one per glyph.
+ * - rows:    Number of rows.
+ * - width:   Number of glyphs per row.
+ * - mode:    COLOR_TRUECOLOR or COLOR_256.
+ *
+ * Colour sequences are elided as in output_cells. A row that set a colour ends with a
+ * reset, so rows can be printed on their own.
+ */
+void output_color_rows(OutputBuffer* out, const wchar_t* ascii, const Pixel* colors, int rows, int width, ColorMode mode){
+	for(int row = 0; row < rows; row++){
+		uint32_t current = UINT32_MAX;	// no colour in effect at the start of a row
+
+		output_cells(out, ascii + (size_t) row * width, colors + (size_t) row * width, width, mode, &current);
+		if(current != UINT32_MAX) output_write(out, "\x1b[0m", 4);
+		output_write(out, "\n", 1);
+	}
+}
+
+/*
+ * output_close flushes and releases an OutputBuffer.
+ *
+ * Returns: false if any write failed since the buffer was opened.
+ */
+bool output_close(OutputBuffer* out){
+	bool result = output_flush(out);
+
+	free(out->data);
+	out->data	= NULL;
+	out->capacity	= 0;
+	return result;
+}
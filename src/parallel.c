@@ -0,0 +1,379 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.h"
+
+/*
+ * RowJob one parallel_rows call, queued on the pool until all its bands are claimed.
+ * - function, context: Callback and its state.
+ * - rows, bands:       Range to cover and number of bands it is split into.
+ * - claimed:           Bands handed out so far.
+ * - finished:          Bands completed so far.
+ * - next:              Next job in the pool queue.
+ *
+ * claimed and finished are only accessed with the pool lock held. The job lives on the
+ * stack of the parallel_rows caller, which returns only once every band is finished.
+ */
+typedef struct RowJob{
+	RowBandFunction function;
+	void* context;
+	int rows, bands;
+	int claimed, finished;
+	struct RowJob* next;
+} RowJob;
+
+/*
+ * RowPool process-wide set of worker threads running RowJob bands.
+ * - lock:        Protects every other field and the claimed/finished counters of queued jobs.
+ * - work:        Signalled when a job is queued.
+ * - done:        Broadcast when a job finishes its last band.
+ * - head, tail:  FIFO of jobs that still have unclaimed bands.
+ * - workers:     Number of worker threads started so far; they are never stopped.
+ */
+typedef struct RowPool{
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+	RowJob* head;
+	RowJob* tail;
+	int workers;
+} RowPool;
+
+static RowPool row_pool = {
+	.lock	= PTHREAD_MUTEX_INITIALIZER,
+	.work	= PTHREAD_COND_INITIALIZER,
+	.done	= PTHREAD_COND_INITIALIZER,
+};
+
+/*
+ * row_pool_claim hands out the next band of the oldest queued job, with the lock held.
+ * - job:   Set to the job the band belongs to.
+ * - band:  Set to the band index.
+ *
+ * A job leaves the queue as soon as its last band is claimed.
+ * Returns: false if no job has an unclaimed band.
+ */
+static bool row_pool_claim(RowJob** job, int* band){
+	RowJob* head = row_pool.head;
+	if(!head) return false;
+
+	*job	= head;
+	*band	= head->claimed++;
+	if(head->claimed == head->bands){
+		row_pool.head = head->next;
+		if(!row_pool.head) row_pool.tail = NULL;
+	}
+	return true;
+}
+
+/*
+ * row_pool_run runs one band of a job, entered and left with the lock held.
+ */
+static void row_pool_run(RowJob* job, int band){
+	int row_begin	= (int) ((long long) job->rows * band / job->bands);
+	int row_end	= (int) ((long long) job->rows * (band + 1) / job->bands);
+
+	pthread_mutex_unlock(&row_pool.lock);
+	job->function(job->context, row_begin, row_end);
+	pthread_mutex_lock(&row_pool.lock);
+
+	if(++job->finished == job->bands) pthread_cond_broadcast(&row_pool.done);
+}
+
+static void* row_pool_entry(void* arg){
+	RowJob* job;
+	int band;
+	(void) arg;
+
+	pthread_mutex_lock(&row_pool.lock);
+	for(;;){
+		while(!row_pool_claim(&job, &band)) pthread_cond_wait(&row_pool.work, &row_pool.lock);
+		row_pool_run(job, band);
+	}
+
+	return NULL;
+}
+
+/*
+ * row_pool_grow starts workers until the pool has at least count of them, with the lock held.
+ *
+ * Workers are detached and live until the process exits. A failed spawn is not an
+ * error: the bands it would have run are picked up by the other threads.
+ */
+static void row_pool_grow(int count){
+	pthread_attr_t attributes;
+
+	if(row_pool.workers >= count || pthread_attr_init(&attributes) != 0) return;
+	pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+
+	while(row_pool.workers < count){
+		pthread_t worker;
+		if(pthread_create(&worker, &attributes, row_pool_entry, NULL) != 0) break;
+		row_pool.workers++;
+	}
+
+	pthread_attr_destroy(&attributes);
+}
+
+/*
+ * online_cpu_count returns the number of online processors, or 1 if it cannot be determined.
+ */
+int online_cpu_count(void){
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count < 1) ? 1 : (int) count;
+}
+
+/*
+ * parallel_rows splits [0, rows) into contiguous bands and runs them on a pool of threads.
+ * - rows:      Total number of rows to process.
+ * - threads:   Number of bands, capped to rows. Values below 2 run inline.
+ * - function:  Callback invoked once per band.
+ * - context:   Opaque pointer forwarded to every callback.
+ *
+ * The bands are queued on a process-wide pool, which is grown to threads - 1 workers
+ * on first use and then reused by every later call. The calling thread claims bands
+ * too, and keeps doing so for other queued jobs while its own are finishing, so calls
+ * nested in a band or made from several threads at once always complete, even if
+ * no worker could be spawned. Every row is processed exactly once.
+ */
+void parallel_rows(int rows, int threads, RowBandFunction function, void* context){
+	RowJob* job;
+	int band;
+
+	if(rows <= 0) return;
+	if(threads > rows) threads = rows;
+	if(threads < 2){
+		function(context, 0, rows);
+		return;
+	}
+
+	RowJob own = { .function = function, .context = context, .rows = rows, .bands = threads };
+
+	pthread_mutex_lock(&row_pool.lock);
+	row_pool_grow(threads - 1);
+
+	if(row_pool.tail)	row_pool.tail->next = &own;
+	else			row_pool.head = &own;
+	row_pool.tail = &own;
+	pthread_cond_broadcast(&row_pool.work);
+
+	while(own.finished < own.bands){
+		if(row_pool_claim(&job, &band))	row_pool_run(job, band);
+		else				pthread_cond_wait(&row_pool.done, &row_pool.lock);
+	}
+
+	pthread_mutex_unlock(&row_pool.lock);
+}
+
+/*
+ * TaskQueue shared state of a parallel_tasks call.
+ */
+typedef struct TaskQueue{
+	TaskFunction function;
+	void* context;
+	int count;
+	atomic_int next;
+} TaskQueue;
+
+static void* task_queue_entry(void* arg){
+	TaskQueue* queue = (TaskQueue*) arg;
+
+	for(int task = atomic_fetch_add(&queue->next, 1); task < queue->count; task = atomic_fetch_add(&queue->next, 1))
+		queue->function(queue->context, task);
+
+	return NULL;
+}
+
+/*
+ * parallel_tasks runs count independent tasks on a pool of threads.
+ * - count:     Number of tasks.
+ * - threads:   Number of workers to use, capped to count. Values below 2 run inline.
+ * - function:  Callback invoked once per task.
+ * - context:   Opaque pointer forwarded to every callback.
+ *
+ * Unlike parallel_rows, tasks are handed out one at a time from a shared counter, so
+ * workers stay busy when tasks have very different costs (e.g. images of different
+ * sizes). Every task is run exactly once, even if some workers cannot be spawned.
+ */
+void parallel_tasks(int count, int threads, TaskFunction function, void* context){
+	TaskQueue queue;
+
+	if(count <= 0) return;
+	if(threads > count) threads = count;
+
+	queue.function	= function;
+	queue.context	= context;
+	queue.count	= count;
+	atomic_init(&queue.next, 0);
+
+	pthread_t* workers	= (threads > 1) ? (pthread_t*) malloc(sizeof(pthread_t) * threads) : NULL;
+	int started		= 0;
+
+	if(workers){
+		for(int worker = 1; worker < threads; worker++)
+			if(pthread_create(&workers[started], NULL, task_queue_entry, &queue) == 0) started++;
+	}
+
+	// The calling thread drains the queue too, so it completes even if no worker started
+	task_queue_entry(&queue);
+
+	for(int worker = 0; worker < started; worker++) pthread_join(workers[worker], NULL);
+	free(workers);
+}
+
+/*
+ * row_queue_init prepares an empty RowQueue.
+ * - queue:      Queue to initialise.
+ * - capacity:   Number of slots, at least 1.
+ * - row_bytes:  Size of one slot.
+ *
+ * Returns: false on allocation failure (nothing to destroy then).
+ */
+bool row_queue_init(RowQueue* queue, size_t capacity, size_t row_bytes){
+	memset(queue, 0, sizeof(*queue));
+	queue->rows = (unsigned char*) malloc(capacity * row_bytes + 1);
+	if(!queue->rows) return false;
+
+	if(pthread_mutex_init(&queue->lock, NULL) != 0){
+		free(queue->rows);
+		return false;
+	}
+	if(pthread_cond_init(&queue->wake, NULL) != 0){
+		pthread_mutex_destroy(&queue->lock);
+		free(queue->rows);
+		return false;
+	}
+
+	queue->row_bytes	= row_bytes;
+	queue->capacity		= capacity;
+	atomic_init(&queue->head, 0);
+	atomic_init(&queue->tail, 0);
+	atomic_init(&queue->closed, false);
+	atomic_init(&queue->sleepers, 0);
+	return true;
+}
+
+/*
+ * row_queue_destroy releases the slots and synchronisation objects of a RowQueue.
+ */
+void row_queue_destroy(RowQueue* queue){
+	pthread_cond_destroy(&queue->wake);
+	pthread_mutex_destroy(&queue->lock);
+	free(queue->rows);
+}
+
+/*
+ * row_queue_ready tells whether a producer (a free slot) or a consumer (a published row) can go on.
+ */
+static bool row_queue_ready(RowQueue* queue, bool producer){
+	if(atomic_load(&queue->closed)) return true;
+
+	size_t used = atomic_load(&queue->tail) - atomic_load(&queue->head);
+	return producer ? used < queue->capacity : used > 0;
+}
+
+/*
+ * row_queue_wait blocks until row_queue_ready holds.
+ *
+ * Spins first: in a balanced pipeline the other side is usually a fraction of a row
+ * away. A sleeper registers in sleepers before its last check, and the other side
+ * reads sleepers after its store, so one of the two always sees the other: no wakeup
+ * is lost even though publishing does not take the lock.
+ */
+static void row_queue_wait(RowQueue* queue, bool producer){
+	for(int spin = 0; spin < ROW_QUEUE_SPINS; spin++)
+		if(row_queue_ready(queue, producer)) return;
+
+	pthread_mutex_lock(&queue->lock);
+	atomic_fetch_add(&queue->sleepers, 1);
+	while(!row_queue_ready(queue, producer)) pthread_cond_wait(&queue->wake, &queue->lock);
+	atomic_fetch_sub(&queue->sleepers, 1);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+/*
+ * row_queue_notify wakes the other side if it is asleep.
+ */
+static void row_queue_notify(RowQueue* queue){
+	if(atomic_load(&queue->sleepers) == 0) return;
+
+	pthread_mutex_lock(&queue->lock);
+	pthread_cond_broadcast(&queue->wake);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+/*
+ * row_queue_reserve returns the slot the producer fills next, waiting while the queue is full.
+ *
+ * Returns: The slot, or NULL once the queue is closed.
+ */
+void* row_queue_reserve(RowQueue* queue){
+	row_queue_wait(queue, true);
+	if(atomic_load(&queue->closed)) return NULL;
+
+	return queue->rows + (atomic_load(&queue->tail) % queue->capacity) * queue->row_bytes;
+}
+
+/*
+ * row_queue_publish hands the slot returned by row_queue_reserve to the consumer.
+ */
+void row_queue_publish(RowQueue* queue){
+	atomic_fetch_add(&queue->tail, 1);
+	row_queue_notify(queue);
+}
+
+/*
+ * row_queue_front returns the oldest published row, waiting while the queue is empty.
+ *
+ * Rows published before the queue was closed are still returned.
+ *
+ * Returns: The row, valid until row_queue_pop, or NULL once the queue is closed and drained.
+ */
+const void* row_queue_front(RowQueue* queue){
+	row_queue_wait(queue, false);
+
+	size_t head = atomic_load(&queue->head);
+	if(head == atomic_load(&queue->tail)) return NULL;
+
+	return queue->rows + (head % queue->capacity) * queue->row_bytes;
+}
+
+/*
+ * row_queue_pop gives the row returned by row_queue_front back to the producer.
+ */
+void row_queue_pop(RowQueue* queue){
+	atomic_fetch_add(&queue->head, 1);
+	row_queue_notify(queue);
+}
+
+/*
+ * row_queue_close marks a RowQueue closed and wakes both sides.
+ */
+void row_queue_close(RowQueue* queue){
+	pthread_mutex_lock(&queue->lock);
+	atomic_store(&queue->closed, true);
+	pthread_cond_broadcast(&queue->wake);
+	pthread_mutex_unlock(&queue->lock);
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "pipeline.h"
+#include "parallel.h"
+#include "asciifier.h"
+#include "stats.h"
+
+/*
+ * Pipeline state shared by the three stages of a pipeline_stream call.
+ * - stream:     Scaler, only used by the scaler thread.
+ * - palette:    Palette of the glyphs.
+ * - output:     Writer, only used by the writer thread.
+ * - scaled_row: One scaled row, only used by the scaler thread.
+ * - source:     Decoded rows, from the calling thread to the scaler.
+ * - glyphs:     Glyph rows, from the scaler to the writer.
+ */
+typedef struct Pipeline{
+	LanczosStream* stream;
+	Palette palette;
+	OutputBuffer* output;
+	Pixel* scaled_row;
+	RowQueue source;
+	RowQueue glyphs;
+} Pipeline;
+
+/*
+ * pipeline_scale_entry scaler thread: source rows in, glyph rows out.
+ */
+static void* pipeline_scale_entry(void* arg){
+	Pipeline* pipeline = (Pipeline*) arg;
+	int width = pipeline->stream->width;
+	const Pixel* source_row;
+
+	while((source_row = (const Pixel*) row_queue_front(&pipeline->source))){
+		StatsMark mark = stats_begin();
+		lanczos_stream_push(pipeline->stream, source_row);
+		row_queue_pop(&pipeline->source);
+
+		while(lanczos_stream_pull(pipeline->stream, pipeline->scaled_row)){
+			stats_end(STATS_RENDER, mark);
+			wchar_t* glyph_row = (wchar_t*) row_queue_reserve(&pipeline->glyphs);
+			mark = stats_begin();
+			if(!glyph_row) break;
+
+			asciify_into(pipeline->scaled_row, 1, width, pipeline->palette, glyph_row, 1);
+			row_queue_publish(&pipeline->glyphs);
+		}
+		stats_end(STATS_RENDER, mark);
+	}
+
+	row_queue_close(&pipeline->glyphs);
+	return NULL;
+}
+
+/*
+ * pipeline_write_entry writer thread: prints the glyph rows in order.
+ */
+static void* pipeline_write_entry(void* arg){
+	Pipeline* pipeline = (Pipeline*) arg;
+	int width = pipeline->stream->width;
+	const wchar_t* glyph_row;
+
+	while((glyph_row = (const wchar_t*) row_queue_front(&pipeline->glyphs))){
+		StatsMark mark = stats_begin();
+		output_glyph_rows(pipeline->output, glyph_row, 1, width);
+		stats_end(STATS_OUTPUT, mark);
+		row_queue_pop(&pipeline->glyphs);
+	}
+
+	return NULL;
+}
+
+/*
+ * pipeline_stream renders an image row by row with decode, scale and output on separate threads.
+ * - stream:       Scaler created for the image, nothing pushed yet.
+ * - palette:      Palette of the glyphs.
+ * - reader:       Source of the stream->src_height rows.
+ * - context:      Opaque pointer forwarded to reader.
+ * - output:       Buffered writer receiving the glyph rows; only touched by the writer thread until the call returns.
+ *
+ * The calling thread reads source rows into a queue of PIPELINE_SOURCE_ROWS; a scaler
+ * thread pushes them into the stream and turns every row it can pull into glyphs, in a
+ * queue of PIPELINE_GLYPH_ROWS that a writer thread prints in order. An output row is
+ * scaled as soon as its last source row arrives, so the time of a render approaches that
+ * of its slowest stage instead of the sum of the three.
+ *
+ * The stream is inherently sequential (each output row needs the SAMPLE_SIZE rows
+ * before it in the ring), so there is exactly one scaler; the queues are single
+ * producer, single consumer and pass rows without locking. On a reader failure the
+ * rows already decoded are still scaled and printed, as on the single-threaded path.
+ *
+ * Returns: 1 on success, 0 if the threads could not be started (no row was read: the
+ *          caller can render on one thread instead), -1 if reader failed.
+ */
+int pipeline_stream(LanczosStream* stream, Palette palette, PipelineRowReader reader, void* context, OutputBuffer* output){
+	Pipeline pipeline;
+	pthread_t scaler, writer;
+	size_t source_bytes	= (size_t) stream->src_width * sizeof(Pixel);
+	size_t glyph_bytes	= (size_t) stream->width * sizeof(wchar_t);
+
+	pipeline.stream		= stream;
+	pipeline.palette	= palette;
+	pipeline.output		= output;
+	pipeline.scaled_row	= (Pixel*) malloc((size_t) stream->width * sizeof(Pixel));
+	if(!pipeline.scaled_row) return 0;
+
+	if(!row_queue_init(&pipeline.source, PIPELINE_SOURCE_ROWS, source_bytes)){
+		free(pipeline.scaled_row);
+		return 0;
+	}
+	if(!row_queue_init(&pipeline.glyphs, PIPELINE_GLYPH_ROWS, glyph_bytes)){
+		row_queue_destroy(&pipeline.source);
+		free(pipeline.scaled_row);
+		return 0;
+	}
+
+	bool started = pthread_create(&scaler, NULL, pipeline_scale_entry, &pipeline) == 0;
+	if(started && pthread_create(&writer, NULL, pipeline_write_entry, &pipeline) != 0){
+		// The scaler exits on the empty, closed source queue without touching the stream
+		row_queue_close(&pipeline.source);
+		pthread_join(scaler, NULL);
+		started = false;
+	}
+
+	bool failed = false;
+	for(int row = 0; started && row < stream->src_height; row++){
+		Pixel* source_row = (Pixel*) row_queue_reserve(&pipeline.source);
+		if(!source_row) break;
+
+		StatsMark mark = stats_begin();
+		failed = !reader(context, row, source_row);
+		stats_end(STATS_DECODE, mark);
+		if(failed) break;
+
+		row_queue_publish(&pipeline.source);
+	}
+
+	if(started){
+		row_queue_close(&pipeline.source);
+		pthread_join(scaler, NULL);
+		pthread_join(writer, NULL);
+	}
+
+	row_queue_destroy(&pipeline.source);
+	row_queue_destroy(&pipeline.glyphs);
+	free(pipeline.scaled_row);
+
+	if(!started) return 0;
+	return failed ? -1 : 1;
+}
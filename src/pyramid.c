@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include "pyramid.h"
+
+/*
+ * pyramid_level_for returns the pyramid level an output size is resampled from.
+ * - image:          Source image.
+ * - width, height:  Output size.
+ *
+ * Level k is (width >> k) x (height >> k): successive halvings truncate like one shift.
+ *
+ * Returns: 0 for original_image, k for pyramid[k - 1].
+ */
+int pyramid_level_for(const AsciiImageObject* image, int width, int height){
+	int level = 0;
+
+	while(level < PYRAMID_MAX_LEVELS &&
+	      (image->width >> (level + 1)) >= width && (image->width >> (level + 1)) > 0 &&
+	      (image->height >> (level + 1)) >= height && (image->height >> (level + 1)) > 0) level++;
+
+	return level;
+}
+
+/*
+ * pyramid_view describes a level as an AsciiImageObject usable by the scalers.
+ * - image:  Image owning the pyramid.
+ * - level:  0 for original_image, k for pyramid[k - 1]; must already be built.
+ * - view:   Receives a view sharing the pixels of the level; it owns nothing.
+ */
+void pyramid_view(const AsciiImageObject* image, int level, AsciiImageObject* view){
+	view->scale		= 1;
+	view->edited_image	= NULL;
+	view->ascii_image	= NULL;
+	view->pyramid		= NULL;
+	view->pyramid_levels	= 0;
+
+	if(level == 0){
+		view->width		= image->width;
+		view->height		= image->height;
+		view->original_image	= image->original_image;
+	}else{
+		view->width		= image->pyramid[level - 1].width;
+		view->height		= image->pyramid[level - 1].height;
+		view->original_image	= image->pyramid[level - 1].pixels;
+	}
+}
+
+/*
+ * pyramid_build makes sure the first levels of the pyramid exist.
+ * - image:     Image owning the pyramid.
+ * - levels:    Number of levels wanted; capped to PYRAMID_MAX_LEVELS and to 1x1 pixel.
+ * - threads:   Number of worker threads used for each reduction.
+ * - variant:   Scaler implementation to use.
+ *
+ * Each level is the Lanczos 2x reduction of the previous one, so building level k
+ * only reads a quarter of the pixels of level k - 1 and the whole pyramid costs
+ * about a third of original_image in memory and one pass over it in time.
+ *
+ * Returns: false on memory allocation failure; the levels built so far are kept.
+ */
+bool pyramid_build(AsciiImageObject* image, int levels, int threads, LanczosVariant variant){
+	if(levels > PYRAMID_MAX_LEVELS) levels = PYRAMID_MAX_LEVELS;
+
+	if(!image->pyramid && levels > 0){
+		image->pyramid = (PyramidLevel*) calloc(PYRAMID_MAX_LEVELS, sizeof(PyramidLevel));
+		if(!image->pyramid) return false;
+	}
+
+	while(image->pyramid_levels < levels){
+		AsciiImageObject previous;
+		pyramid_view(image, image->pyramid_levels, &previous);
+		if(previous.width < 2 || previous.height < 2) break;
+
+		Pixel* pixels = lanczos_scale(&previous, 2, threads, variant);
+		if(!pixels) return false;
+
+		PyramidLevel* level = &image->pyramid[image->pyramid_levels];
+		level->width	= previous.width / 2;
+		level->height	= previous.height / 2;
+		level->pixels	= pixels;
+		image->pyramid_levels++;
+	}
+
+	return true;
+}
+
+/*
+ * pyramid_free releases every pyramid level of an image.
+ */
+void pyramid_free(AsciiImageObject* image){
+	for(int level = 0; level < image->pyramid_levels; level++) free(image->pyramid[level].pixels);
+	free(image->pyramid);
+	image->pyramid		= NULL;
+	image->pyramid_levels	= 0;
+}
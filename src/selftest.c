@@ -0,0 +1,621 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <png.h>
+#include "commons.h"
+#include "lanczos.h"
+#include "asciifier.h"
+#include "box.h"
+#include "shape.h"
+#include "output.h"
+#include "yascii.h"
+#include "selftest.h"
+
+static const char* variant_names[LANCZOS_VARIANT_COUNT] = { "auto", "scalar", "sse2", "avx2", "fixed" };
+static const char* palette_names[PALETTE_COUNT] = { "braille", "block", "dense", "smooth" };
+
+/*
+ * synthetic_image fills an AsciiImageObject with deterministic test content.
+ * - width, height: Image size in pixels.
+ * - seed:          Seed of the pseudo random noise.
+ *
+ * The picture mixes smooth gradients, LCG noise and saturated 0/255 blocks so both
+ * the interpolation and the clamping paths are exercised.
+ *
+ * Returns: A newly allocated image, or NULL on allocation failure.
+ */
+static AsciiImageObject* synthetic_image(int width, int height, uint32_t seed){
+	AsciiImageObject* image = (AsciiImageObject*) malloc(sizeof(AsciiImageObject));
+	if(!image) return NULL;
+
+	image->width		= width;
+	image->height		= height;
+	image->scale		= 1;
+	image->edited_image	= NULL;
+	image->ascii_image	= NULL;
+	image->pyramid		= NULL;
+	image->pyramid_levels	= 0;
+	image->mapping		= NULL;
+	image->mapping_size	= 0;
+	image->borrowed		= false;
+	image->original_image	= (Pixel*) malloc(sizeof(Pixel) * (size_t) width * height);
+	if(!image->original_image){
+		free(image);
+		return NULL;
+	}
+
+	for(int row = 0; row < height; row++){
+		for(int col = 0; col < width; col++){
+			Pixel* pixel = &image->original_image[(size_t) row * width + col];
+			seed = seed * 1103515245u + 12345u;
+
+			if(((row / 16) + (col / 16)) % 5 == 0){
+				uint8_t level = ((row / 16) % 2) ? 255 : 0;
+				pixel->red = pixel->green = pixel->blue = level;
+				pixel->alpha = 255 - level;
+			}else{
+				pixel->red	= (uint8_t) (col * 255 / (width > 1 ? width - 1 : 1));
+				pixel->green	= (uint8_t) (row * 255 / (height > 1 ? height - 1 : 1));
+				pixel->blue	= (uint8_t) (seed >> 24);
+				pixel->alpha	= (uint8_t) (seed >> 16);
+			}
+		}
+	}
+
+	return image;
+}
+
+/*
+ * glyph_table_test compares the integer glyph lookup against the double precision reference.
+ *
+ * Every one of the 2^24 RGB values is checked for every palette.
+ * Returns: number of palettes with at least one mismatch.
+ */
+static int glyph_table_test(void){
+	int failures = 0;
+
+	for(int palette = 0; palette < PALETTE_COUNT; palette++){
+		const GlyphMap* map = glyph_map((Palette) palette);
+		long mismatches = 0;
+		Pixel pixel = { 0, 0, 0, 255 };
+
+		for(int red = 0; red < 256; red++){
+			for(int green = 0; green < 256; green++){
+				for(int blue = 0; blue < 256; blue++){
+					pixel.red	= (uint8_t) red;
+					pixel.green	= (uint8_t) green;
+					pixel.blue	= (uint8_t) blue;
+					if(glyph_lookup(map, pixel) != glyph_reference(map, pixel)) mismatches++;
+				}
+			}
+		}
+
+		printf("glyphs %-8s all 2^24 RGB values  mismatches = %ld  %s\n", palette_names[palette], mismatches, mismatches ? "FAIL" : "ok");
+		if(mismatches) failures++;
+	}
+
+	return failures;
+}
+
+/*
+ * shape_table_test checks the shape lookup on flat cells and on a few unambiguous shapes.
+ *
+ * A flat grey cell must map exactly like glyph_lookup for all 256 levels and every
+ * palette, and white bands on black must pick the glyph drawing that band.
+ * Returns: number of failed cases.
+ */
+static int shape_table_test(void){
+	static const struct {
+		Palette palette;
+		uint8_t grey[SHAPE_CELLS];
+		wchar_t expected;
+	} shapes[] = {
+		{ BLOCK,	{ 255, 255, 0, 0, 0, 0 },	L'▀' },
+		{ BLOCK,	{ 0, 0, 0, 0, 255, 255 },	L'▄' },
+		{ BLOCK,	{ 0, 255, 0, 255, 0, 255 },	L'▐' },
+		{ DENSE,	{ 0, 0, 255, 255, 0, 0 },	L'-' },
+		{ DENSE,	{ 0, 0, 0, 0, 255, 255 },	L'.' },
+		{ BRAILLE,	{ 255, 0, 255, 0, 255, 0 },	L'⢸' },
+	};
+	int failures = 0;
+
+	for(int palette = 0; palette < PALETTE_COUNT; palette++){
+		const ShapeMap* map = shape_map((Palette) palette);
+		long mismatches = 0;
+
+		for(int grey = 0; grey < 256; grey++){
+			Pixel pixel = { (uint8_t) grey, (uint8_t) grey, (uint8_t) grey, 255 };
+			uint32_t luma[SHAPE_CELLS];
+
+			for(int k = 0; k < SHAPE_CELLS; k++) luma[k] = shape_luma(map->glyphs, pixel);
+			if(shape_lookup(map, luma, pixel) != glyph_lookup(map->glyphs, pixel)) mismatches++;
+		}
+
+		printf("shapes %-8s flat cells  mismatches = %ld  %s\n", palette_names[palette], mismatches, mismatches ? "FAIL" : "ok");
+		if(mismatches) failures++;
+	}
+
+	for(size_t c = 0; c < sizeof(shapes) / sizeof(shapes[0]); c++){
+		const ShapeMap* map = shape_map(shapes[c].palette);
+		uint32_t luma[SHAPE_CELLS], sum = 0;
+
+		for(int k = 0; k < SHAPE_CELLS; k++){
+			Pixel pixel = { shapes[c].grey[k], shapes[c].grey[k], shapes[c].grey[k], 255 };
+			luma[k] = shape_luma(map->glyphs, pixel);
+			sum += shapes[c].grey[k];
+		}
+
+		uint8_t grey = (uint8_t) ((sum + SHAPE_CELLS / 2) / SHAPE_CELLS);
+		Pixel mean = { grey, grey, grey, 255 };
+		wchar_t glyph = shape_lookup(map, luma, mean);
+
+		printf("shapes case %zu  expected U+%04X got U+%04X  %s\n", c, (unsigned) shapes[c].expected, (unsigned) glyph,
+		       glyph == shapes[c].expected ? "ok" : "FAIL");
+		if(glyph != shapes[c].expected) failures++;
+	}
+
+	return failures;
+}
+
+/*
+ * box_filter_test compares box_resize against a naive per-cell mean.
+ * - image:     Source image.
+ * - scale:     Downscale factor, may be fractional.
+ * - threads:   Number of worker threads used by box_resize.
+ *
+ * Cell boundaries are recomputed independently from the rounded dst * src / dst_size
+ * formula and every cell must match exactly.
+ * Returns: 1 if the case failed, 0 otherwise.
+ */
+static int box_filter_test(const AsciiImageObject* image, double scale, int threads){
+	int width = resample_size(image->width, scale), height = resample_size(image->height, scale);
+	if(width == 0 || height == 0) return 0;
+
+	Pixel* candidate = box_resize((AsciiImageObject*) image, width, height, threads);
+	long mismatches = candidate ? 0 : 1;
+
+	for(int row = 0; candidate && row < height; row++){
+		int y0 = (int)(((int64_t) row * image->height * 2 + height) / ((int64_t) height * 2));
+		int y1 = (int)(((int64_t) (row + 1) * image->height * 2 + height) / ((int64_t) height * 2));
+
+		for(int col = 0; col < width; col++){
+			int x0 = (int)(((int64_t) col * image->width * 2 + width) / ((int64_t) width * 2));
+			int x1 = (int)(((int64_t) (col + 1) * image->width * 2 + width) / ((int64_t) width * 2));
+			uint64_t sums[4] = { 0, 0, 0, 0 }, area = (uint64_t) (x1 - x0) * (y1 - y0);
+
+			for(int y = y0; y < y1; y++){
+				for(int x = x0; x < x1; x++){
+					const Pixel* pixel = &image->original_image[(size_t) y * image->width + x];
+					sums[0] += pixel->red;
+					sums[1] += pixel->green;
+					sums[2] += pixel->blue;
+					sums[3] += pixel->alpha;
+				}
+			}
+
+			const uint8_t* actual = (const uint8_t*) &candidate[(size_t) row * width + col];
+			for(int c = 0; c < 4; c++)
+				if(actual[c] != (sums[c] + area / 2) / area) mismatches++;
+		}
+	}
+
+	printf("box    %4dx%-4d /%-5g mismatches = %ld  %s\n", image->width, image->height, scale, mismatches, mismatches ? "FAIL" : "ok");
+	free(candidate);
+	return mismatches ? 1 : 0;
+}
+
+/*
+ * phase_taps computes the reference taps of one output coordinate at a fractional ratio.
+ * - src_size, dst_size:  Axis sizes.
+ * - dst:                 Output coordinate.
+ * - index, weight:       Receive SAMPLE_SIZE source coordinates and normalized weights.
+ *
+ * Lanczos-2 stretched by LANCZOS_PHASE_STRETCH, at the real distance from the source
+ * position, around the nearest source sample; taps outside the image get weight 0.
+ */
+static void phase_taps(int src_size, int dst_size, int dst, int* index, double* weight){
+	const double pi = 3.14159265358979323846;
+	double position = dst * (double) src_size / dst_size, sum = 0;
+	int center = (int) floor(position + 0.5);
+
+	for(int k = 0; k < SAMPLE_SIZE; k++){
+		double x = (center + k - KERNEL_RADIUS - position) * LANCZOS_PHASE_STRETCH;
+		index[k]	= center + k - KERNEL_RADIUS;
+		weight[k]	= x == 0 ? 1 : fabs(x) >= 2 ? 0 : sin(pi * x) * sin(pi * x / 2) / (pi * pi * x * x / 2);
+		sum += weight[k];
+	}
+	for(int k = 0; k < SAMPLE_SIZE; k++)
+		weight[k] = (index[k] < 0 || index[k] >= src_size) ? 0 : weight[k] / sum;
+}
+
+/*
+ * RowCollector LanczosRowSink state copying every scaled row into a frame.
+ */
+typedef struct RowCollector{
+	Pixel* frame;
+	int width;
+} RowCollector;
+
+static void collect_row(void* context, int row, const Pixel* pixels, int width){
+	RowCollector* collector = (RowCollector*) context;
+	memcpy(collector->frame + (size_t) row * collector->width, pixels, sizeof(Pixel) * width);
+}
+
+/*
+ * fractional_lanczos_test resizes an image by a non-integer ratio with every Lanczos variant.
+ * - image:     Source image.
+ * - scale:     Fractional downscale factor.
+ * - threads:   Number of worker threads used by the scaler.
+ *
+ * Every variant must be within 1 LSB of a direct double precision evaluation of the
+ * phase-dependent taps (phase_taps), so output samples sit at their real, evenly spaced
+ * source positions. Sizes that an integer factor would also give are skipped.
+ * Returns: number of failed cases.
+ */
+static int fractional_lanczos_test(AsciiImageObject* image, double scale, int threads){
+	int width = resample_size(image->width, scale), height = resample_size(image->height, scale);
+	if(width == 0 || height == 0) return 0;
+	if(image->width / (image->width / width) == width && image->height / (image->height / height) == height) return 0;
+
+	Pixel* frame		= (Pixel*) malloc(sizeof(Pixel) * (size_t) width * height);
+	double* reference	= (double*) malloc(sizeof(double) * 4 * (size_t) width * height);
+	int failures = 0;
+
+	if(!frame || !reference){
+		free(frame);
+		free(reference);
+		return 1;
+	}
+
+	for(int row = 0; row < height; row++){
+		int row_index[SAMPLE_SIZE], col_index[SAMPLE_SIZE];
+		double row_weight[SAMPLE_SIZE], col_weight[SAMPLE_SIZE];
+		phase_taps(image->height, height, row, row_index, row_weight);
+
+		for(int col = 0; col < width; col++){
+			double sums[4] = { 0, 0, 0, 0 };
+			phase_taps(image->width, width, col, col_index, col_weight);
+
+			for(int i = 0; i < SAMPLE_SIZE; i++){
+				if(row_weight[i] == 0) continue;
+				for(int j = 0; j < SAMPLE_SIZE; j++){
+					if(col_weight[j] == 0) continue;
+					const uint8_t* pixel = (const uint8_t*) &image->original_image[(size_t) row_index[i] * image->width + col_index[j]];
+					for(int c = 0; c < 4; c++) sums[c] += row_weight[i] * col_weight[j] * pixel[c];
+				}
+			}
+			for(int c = 0; c < 4; c++)
+				reference[((size_t) row * width + col) * 4 + c] = sums[c] > 255 ? 255 : sums[c] < 0 ? 0 : sums[c];
+		}
+	}
+
+	for(int variant = LANCZOS_SCALAR; variant < LANCZOS_VARIANT_COUNT; variant++){
+		if(!lanczos_variant_supported((LanczosVariant) variant)) continue;
+
+		RowCollector collector = { frame, width };
+		double max_error = 256;
+
+		if(lanczos_resize_rows(image, width, height, threads, (LanczosVariant) variant, collect_row, &collector)){
+			const uint8_t* actual = (const uint8_t*) frame;
+			max_error = 0;
+			for(size_t i = 0; i < (size_t) width * height * 4; i++){
+				double error = fabs(reference[i] - actual[i]);
+				if(error > max_error) max_error = error;
+			}
+		}
+
+		printf("%-6s %4dx%-4d /%-5g fractional max |diff| = %4.2f  %s\n", variant_names[variant], image->width, image->height,
+		       scale, max_error, max_error < 1.5 ? "ok" : "FAIL");
+		if(max_error >= 1.5) failures++;
+	}
+
+	free(frame);
+	free(reference);
+	return failures;
+}
+
+/*
+ * PngBuffer in-memory PNG file filled by png_buffer_write.
+ */
+typedef struct PngBuffer{
+	unsigned char* data;
+	size_t length;
+	size_t capacity;
+} PngBuffer;
+
+/*
+ * png_buffer_write libpng write callback appending to a PngBuffer.
+ */
+static void png_buffer_write(png_structp png_ptr, png_bytep data, png_size_t size){
+	PngBuffer* buffer = (PngBuffer*) png_get_io_ptr(png_ptr);
+
+	if(buffer->length + size > buffer->capacity){
+		size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+		while(capacity < buffer->length + size) capacity *= 2;
+
+		unsigned char* grown = (unsigned char*) realloc(buffer->data, capacity);
+		if(!grown) png_error(png_ptr, "out of memory");
+		buffer->data		= grown;
+		buffer->capacity	= capacity;
+	}
+
+	memcpy(buffer->data + buffer->length, data, size);
+	buffer->length += size;
+}
+
+/*
+ * png_buffer_flush libpng flush callback; there is nothing to flush in memory.
+ */
+static void png_buffer_flush(png_structp png_ptr){
+	(void) png_ptr;
+}
+
+/*
+ * encode_png encodes an image as an 8-bit RGBA PNG held in memory.
+ * - image:  Image to encode.
+ * - size:   Receives the size of the PNG in bytes.
+ *
+ * Returns: A newly allocated buffer holding the PNG, or NULL on failure.
+ */
+static unsigned char* encode_png(const AsciiImageObject* image, size_t* size){
+	PngBuffer buffer = { NULL, 0, 0 };
+	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+
+	if(!png_ptr || !info_ptr || setjmp(png_jmpbuf(png_ptr))){
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		free(buffer.data);
+		return NULL;
+	}
+
+	png_set_write_fn(png_ptr, &buffer, png_buffer_write, png_buffer_flush);
+	png_set_compression_level(png_ptr, 1);
+	png_set_IHDR(png_ptr, info_ptr, (png_uint_32) image->width, (png_uint_32) image->height, 8, PNG_COLOR_TYPE_RGBA,
+		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png_ptr, info_ptr);
+	for(int row = 0; row < image->height; row++)
+		png_write_row(png_ptr, (png_const_bytep) (image->original_image + (size_t) row * image->width));
+	png_write_end(png_ptr, NULL);
+
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	*size = buffer.length;
+	return buffer.data;
+}
+
+/*
+ * library_test renders an image through libyascii and checks it against the CLI pipeline.
+ * - image:     Source image.
+ * - scale:     Integer downscale factor.
+ * - palette:   Palette to render with.
+ * - threads:   Number of worker threads used by the renders.
+ *
+ * yascii_render_rgba, and yascii_render_png on the image encoded as PNG, must give the
+ * bytes of asciify_scaled written by output_glyph_rows. A buffer one byte short must
+ * fail with YASCII_ERROR_BUFFER_TOO_SMALL and report the required length, and the PNG
+ * cut in half must fail with YASCII_ERROR_DECODE.
+ * Returns: number of failed checks.
+ */
+static int library_test(AsciiImageObject* image, int scale, Palette palette, int threads){
+	int rows = image->height / scale, width = image->width / scale;
+	if(rows == 0 || width == 0) return 0;
+
+	YasciiOptions options = { palette, scale, threads, LANCZOS_AUTO };
+	size_t bound = yascii_output_bound(image->width, image->height, scale);
+	size_t png_size = 0, length = 0;
+	wchar_t* glyphs = asciify_scaled(image, scale, palette, threads, LANCZOS_AUTO);
+	unsigned char* png = encode_png(image, &png_size);
+	YasciiContext* context = yascii_context_create();
+	char* output = (char*) malloc(bound);
+	OutputBuffer expected;
+	bool rgba = false, decoded = false, short_buffer = false, truncated = false;
+
+	// The buffer holds the whole frame, so nothing is ever written to the invalid descriptor
+	if(glyphs && png && context && output && output_open(&expected, -1, bound)){
+		output_glyph_rows(&expected, glyphs, rows, width);
+
+		rgba = !expected.failed &&
+		       yascii_render_rgba(context, image->original_image, image->width, image->height, &options, output, bound, &length) == YASCII_OK &&
+		       length == expected.length && memcmp(output, expected.data, length) == 0;
+		decoded = !expected.failed &&
+			  yascii_render_png(context, png, png_size, &options, output, bound, &length) == YASCII_OK &&
+			  length == expected.length && memcmp(output, expected.data, length) == 0;
+		short_buffer = yascii_render_rgba(context, image->original_image, image->width, image->height, &options, output,
+						  expected.length - 1, &length) == YASCII_ERROR_BUFFER_TOO_SMALL && length == expected.length;
+		truncated = yascii_render_png(context, png, png_size / 2, &options, output, bound, &length) == YASCII_ERROR_DECODE;
+		free(expected.data);
+	}
+
+	int failures = !rgba + !decoded + !short_buffer + !truncated;
+	printf("libyascii %4dx%-4d /%d  rgba %s  png %s  short buffer %s  truncated png %s  %s\n", image->width, image->height, scale,
+	       rgba ? "ok" : "FAIL", decoded ? "ok" : "FAIL", short_buffer ? "ok" : "FAIL", truncated ? "ok" : "FAIL",
+	       failures ? "FAIL" : "ok");
+
+	free(glyphs);
+	free(png);
+	free(output);
+	yascii_context_destroy(context);
+	return failures;
+}
+
+/*
+ * empty_frame_test renders an image at scales that leave no cell along one or both axes.
+ * - image:     Source image.
+ * - threads:   Number of worker threads used by the scaler.
+ *
+ * The box filter and RESAMPLE_AUTO (which picks it at such scales) must render an
+ * empty frame instead of dividing by the zero cell count.
+ * Returns: number of failed cases.
+ */
+static int empty_frame_test(AsciiImageObject* image, int threads){
+	static const ResampleFilter filters[] = { RESAMPLE_BOX, RESAMPLE_AUTO };
+	static const char* filter_names[] = { "box", "auto" };
+	double larger = image->width > image->height ? image->width : image->height;
+	double scales[] = { image->height + 1, larger * 2 };
+	int failures = 0;
+
+	for(size_t f = 0; f < sizeof(filters) / sizeof(filters[0]); f++){
+		for(size_t s = 0; s < sizeof(scales) / sizeof(scales[0]); s++){
+			wchar_t glyph;
+			bool rendered = asciify_resampled_into(image, scales[s], DENSE, &glyph, NULL, threads, LANCZOS_AUTO, filters[f], false);
+
+			printf("%-6s %4dx%-4d /%-6g %dx%d cells  %s\n", filter_names[f], image->width, image->height, scales[s],
+			       resample_size(image->width, scales[s]), resample_size(image->height, scales[s]), rendered ? "ok" : "FAIL");
+			if(!rendered) failures++;
+		}
+	}
+
+	return failures;
+}
+
+/*
+ * thread_count_test renders an image on one thread and on several, and compares the frames.
+ * - image:     Source image.
+ * - threads:   Number of threads of the parallel render, at least 2.
+ *
+ * Glyphs and colours must be byte-identical for the Lanczos and box filters and for the
+ * shape lookup. Every render reuses the same worker pool.
+ * Returns: number of failed cases.
+ */
+static int thread_count_test(AsciiImageObject* image, int threads){
+	static const char* mode_names[] = { "lanczos", "box", "shape" };
+	static const double scales[] = { 1, 2.5, 3 };
+	int failures = 0;
+
+	for(size_t s = 0; s < sizeof(scales) / sizeof(scales[0]); s++){
+		size_t cells = (size_t) resample_size(image->width, scales[s]) * resample_size(image->height, scales[s]);
+		if(cells == 0) continue;
+
+		for(int mode = 0; mode < 3; mode++){
+			ResampleFilter filter = mode == 1 ? RESAMPLE_BOX : RESAMPLE_LANCZOS;
+			wchar_t* glyphs[2]	= { malloc(cells * sizeof(wchar_t)), malloc(cells * sizeof(wchar_t)) };
+			Pixel* colors[2]	= { malloc(cells * sizeof(Pixel)), malloc(cells * sizeof(Pixel)) };
+			bool identical		= glyphs[0] && glyphs[1] && colors[0] && colors[1];
+
+			for(int run = 0; identical && run < 2; run++){
+				int count = run ? threads : 1;
+				identical = mode == 2
+					? asciify_shapes_into(image, scales[s], DENSE, glyphs[run], colors[run], count, LANCZOS_AUTO, filter, false, NULL)
+					: asciify_resampled_into(image, scales[s], DENSE, glyphs[run], colors[run], count, LANCZOS_AUTO, filter, false);
+			}
+			identical = identical && memcmp(glyphs[0], glyphs[1], cells * sizeof(wchar_t)) == 0
+				&& memcmp(colors[0], colors[1], cells * sizeof(Pixel)) == 0;
+
+			printf("%-7s %4dx%-4d /%-4g -j 1 vs -j %d  %s\n", mode_names[mode], image->width, image->height, scales[s], threads,
+			       identical ? "ok" : "FAIL");
+			if(!identical) failures++;
+			free(glyphs[0]);
+			free(glyphs[1]);
+			free(colors[0]);
+			free(colors[1]);
+		}
+	}
+
+	return failures;
+}
+
+/*
+ * run_self_test checks every supported scaler variant against the scalar reference.
+ * - threads: Number of worker threads used by each scaling call.
+ *
+ * Deterministic synthetic RGBA images of several sizes are downscaled by several
+ * factors with each SIMD variant available on the running CPU. Every output channel
+ * must be within 1 LSB of the double precision scalar result. The integer glyph lookup
+ * tables must also map every RGB value exactly like the double precision formula, and
+ * the box filter must match a naive per-cell mean at integer and fractional factors.
+ * Lanczos at fractional factors must match a direct evaluation of the phase-dependent taps.
+ * libyascii must render the bytes of the CLI pipeline from RGBA and PNG input, report the
+ * required length when the output buffer is too small and reject a truncated PNG.
+ * Scales larger than the image must give an empty frame with the box and auto filters.
+ * The shape lookup must map flat grey cells like the luma tables and pick the glyph
+ * drawing a white band on black.
+ * Frames rendered with -j 1 and with several threads must be byte-identical.
+ *
+ * A line per case is printed to stdout.
+ * Returns: EXIT_SUCCESS if every case passed, EXIT_FAILURE otherwise.
+ */
+int run_self_test(int threads){
+	static const int sizes[][2] = { {1, 1}, {7, 5}, {64, 48}, {333, 217}, {1023, 769} };
+	static const int scales[] = { 1, 2, 3, 5, 8 };
+	static const double box_scales[] = { 1, 2.5, 3, 7.75, 16, 300 };
+	static const double fractional_scales[] = { 1.5, 2.5, 3.3 };
+	int failures = 0;
+
+	for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++){
+		AsciiImageObject* image = synthetic_image(sizes[s][0], sizes[s][1], (uint32_t) s + 1);
+		if(!image){
+			fprintf(stderr, "Out of memory\n");
+			return EXIT_FAILURE;
+		}
+
+		for(size_t f = 0; f < sizeof(scales) / sizeof(scales[0]); f++){
+			int scale = scales[f];
+			int width = image->width / scale, height = image->height / scale;
+			if(width == 0 || height == 0) continue;
+
+			Pixel* reference = lanczos_scale(image, scale, threads, LANCZOS_SCALAR);
+
+			for(int variant = LANCZOS_SSE2; variant < LANCZOS_VARIANT_COUNT; variant++){
+				if(!lanczos_variant_supported((LanczosVariant) variant)){
+					printf("%-6s %4dx%-4d /%d  skipped (unsupported CPU)\n", variant_names[variant], image->width, image->height, scale);
+					continue;
+				}
+
+				Pixel* candidate = lanczos_scale(image, scale, threads, (LanczosVariant) variant);
+				int max_error = 256;
+
+				if(reference && candidate){
+					const uint8_t* expected = (const uint8_t*) reference;
+					const uint8_t* actual	= (const uint8_t*) candidate;
+					max_error = 0;
+					for(size_t i = 0; i < (size_t) width * height * 4; i++){
+						int error = abs((int) expected[i] - (int) actual[i]);
+						if(error > max_error) max_error = error;
+					}
+				}
+
+				printf("%-6s %4dx%-4d /%d  max |diff| = %3d  %s\n", variant_names[variant], image->width, image->height, scale,
+				       max_error, max_error <= 1 ? "ok" : "FAIL");
+				if(max_error > 1) failures++;
+				free(candidate);
+			}
+
+			free(reference);
+			failures += library_test(image, scale, (Palette) (f % PALETTE_COUNT), threads);
+		}
+
+		for(size_t f = 0; f < sizeof(box_scales) / sizeof(box_scales[0]); f++)
+			failures += box_filter_test(image, box_scales[f], threads);
+		for(size_t f = 0; f < sizeof(fractional_scales) / sizeof(fractional_scales[0]); f++)
+			failures += fractional_lanczos_test(image, fractional_scales[f], threads);
+		failures += empty_frame_test(image, threads);
+		failures += thread_count_test(image, threads > 1 ? threads : 4);
+
+		free(image->original_image);
+		free(image);
+	}
+
+	failures += glyph_table_test();
+	failures += shape_table_test();
+
+	printf("%s: %d failure(s)\n", failures ? "FAIL" : "PASS", failures);
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,464 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "server.h"
+#include "decoder.h"
+#include "input.h"
+#include "asciifier.h"
+#include "output.h"
+#include "parallel.h"
+#include "pyramid.h"
+#include "arena.h"
+
+#define SERVER_OUTPUT_BUFFER_SIZE (1 << 16)
+
+/*
+ * ImageEntry a decoded image resident in the daemon.
+ * - path, mtime, size, inode:  Identity of the file the image was decoded from.
+ * - image:      Decoded RGBA image, read concurrently by every request using it.
+ * - bytes:      Memory accounted to the entry.
+ * - references: Requests currently rendering from the image.
+ * - cached:     Whether the entry is still linked in the LRU list.
+ * - prev, next: LRU links, most recently used first.
+ *
+ * An entry evicted while in use is unlinked at once and freed by its last user.
+ */
+typedef struct ImageEntry{
+	char* path;
+	struct timespec mtime;
+	off_t size;
+	ino_t inode;
+	AsciiImageObject* image;
+	size_t bytes;
+	int references;
+	bool cached;
+	struct ImageEntry* prev;
+	struct ImageEntry* next;
+} ImageEntry;
+
+/*
+ * ImageCache LRU of decoded images bounded by total size.
+ */
+typedef struct ImageCache{
+	pthread_mutex_t lock;
+	ImageEntry* head;
+	ImageEntry* tail;
+	size_t bytes;
+	size_t limit;
+} ImageCache;
+
+/*
+ * Server state shared by every worker.
+ */
+typedef struct Server{
+	int listen_fd;
+	LanczosVariant variant;
+	ResampleFilter filter;
+	bool pyramid;
+	ImageCache cache;
+} Server;
+
+/*
+ * entry_free releases an entry that is neither linked nor referenced.
+ */
+static void entry_free(ImageEntry* entry){
+	image_struct_free(entry->image);
+	free(entry->path);
+	free(entry);
+}
+
+/*
+ * cache_unlink removes an entry from the LRU list. Called with the lock held.
+ */
+static void cache_unlink(ImageCache* cache, ImageEntry* entry){
+	if(entry->prev) entry->prev->next = entry->next;
+	else cache->head = entry->next;
+	if(entry->next) entry->next->prev = entry->prev;
+	else cache->tail = entry->prev;
+
+	entry->prev = entry->next = NULL;
+	entry->cached = false;
+	cache->bytes -= entry->bytes;
+}
+
+/*
+ * cache_push_front links an entry as the most recently used. Called with the lock held.
+ */
+static void cache_push_front(ImageCache* cache, ImageEntry* entry){
+	entry->prev = NULL;
+	entry->next = cache->head;
+	if(cache->head) cache->head->prev = entry;
+	else cache->tail = entry;
+	cache->head = entry;
+
+	entry->cached = true;
+	cache->bytes += entry->bytes;
+}
+
+/*
+ * cache_evict drops least recently used entries until the cache fits its limit.
+ * Called with the lock held; entries still in use are freed by cache_release.
+ */
+static void cache_evict(ImageCache* cache){
+	while(cache->bytes > cache->limit && cache->tail){
+		ImageEntry* victim = cache->tail;
+		cache_unlink(cache, victim);
+		if(victim->references == 0) entry_free(victim);
+	}
+}
+
+/*
+ * cache_acquire returns the decoded image of a file, decoding it on a miss.
+ * - server: Server state owning the image cache.
+ * - path:   Absolute path of the PNG file.
+ * - info:   stat() of the file, identifying the version to serve.
+ *
+ * Decoding runs without the lock, so a slow image never blocks hits on other ones.
+ * With pyramids enabled every level is built before the entry is published: readers
+ * then never extend a pyramid another thread is reading.
+ * Two workers missing on the same file may both decode it; the second insertion
+ * simply replaces the first.
+ *
+ * Returns: A referenced entry to hand back to cache_release, or NULL if decoding failed.
+ */
+static ImageEntry* cache_acquire(Server* server, const char* path, const struct stat* info){
+	ImageCache* cache = &server->cache;
+
+	pthread_mutex_lock(&cache->lock);
+	for(ImageEntry* entry = cache->head; entry; entry = entry->next){
+		if(strcmp(entry->path, path) != 0) continue;
+
+		if(entry->inode == info->st_ino && entry->size == info->st_size &&
+		   entry->mtime.tv_sec == info->st_mtim.tv_sec && entry->mtime.tv_nsec == info->st_mtim.tv_nsec){
+			cache_unlink(cache, entry);
+			cache_push_front(cache, entry);
+			entry->references++;
+			pthread_mutex_unlock(&cache->lock);
+			return entry;
+		}
+
+		// The file changed on disk: the resident version is stale
+		cache_unlink(cache, entry);
+		if(entry->references == 0) entry_free(entry);
+		break;
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	ImageEntry* entry = (ImageEntry*) calloc(1, sizeof(ImageEntry));
+	if(!entry) return NULL;
+
+	entry->path	= strdup(path);
+	entry->image	= entry->path ? decode_png(path) : NULL;
+	if(entry->image && server->pyramid && !pyramid_build(entry->image, PYRAMID_MAX_LEVELS, 1, server->variant)){
+		image_struct_free(entry->image);
+		entry->image = NULL;
+	}
+	if(!entry->image){
+		free(entry->path);
+		free(entry);
+		return NULL;
+	}
+
+	entry->mtime		= info->st_mtim;
+	entry->size		= info->st_size;
+	entry->inode		= info->st_ino;
+	entry->bytes		= sizeof(ImageEntry) + sizeof(Pixel) * (size_t) entry->image->width * entry->image->height;
+	for(int level = 0; level < entry->image->pyramid_levels; level++)
+		entry->bytes += sizeof(Pixel) * (size_t) entry->image->pyramid[level].width * entry->image->pyramid[level].height;
+	entry->references	= 1;
+
+	// Images larger than the whole budget are served once and never kept
+	if(entry->bytes > cache->limit) return entry;
+
+	pthread_mutex_lock(&cache->lock);
+	for(ImageEntry* other = cache->head; other; other = other->next){
+		if(strcmp(other->path, path) == 0){
+			cache_unlink(cache, other);
+			if(other->references == 0) entry_free(other);
+			break;
+		}
+	}
+	cache_push_front(cache, entry);
+	cache_evict(cache);
+	pthread_mutex_unlock(&cache->lock);
+
+	return entry;
+}
+
+/*
+ * cache_release drops a reference taken by cache_acquire.
+ */
+static void cache_release(ImageCache* cache, ImageEntry* entry){
+	pthread_mutex_lock(&cache->lock);
+	bool orphan = --entry->references == 0 && !entry->cached;
+	pthread_mutex_unlock(&cache->lock);
+
+	if(orphan) entry_free(entry);
+}
+
+/*
+ * serve_error writes an "ERR <message>" response line.
+ */
+static void serve_error(OutputBuffer* out, const char* message){
+	output_write(out, "ERR ", 4);
+	output_write(out, message, strlen(message));
+	output_write(out, "\n", 1);
+}
+
+/*
+ * serve_render answers a single request line.
+ * - server:   Server state.
+ * - request:  Request line, without the trailing newline.
+ * - out:      Buffer in front of the client socket.
+ * - arena:    Arena of the connection, the glyph buffer is carved from it and it is reset afterwards.
+ */
+static void serve_render(Server* server, char* request, OutputBuffer* out, Arena* arena){
+	int palette, consumed = 0;
+	double scale;
+	struct stat info;
+
+	if(sscanf(request, "%d %lf %n", &palette, &scale, &consumed) != 2 || consumed == 0 ||
+	   palette < 0 || palette >= PALETTE_COUNT || !(scale >= 1 && scale <= 65535)){
+		serve_error(out, "malformed request");
+		return;
+	}
+
+	const char* path = request + consumed;
+	if(path[0] != '/' || stat(path, &info) != 0 || !S_ISREG(info.st_mode)){
+		serve_error(out, "cannot access file");
+		return;
+	}
+
+	ImageEntry* entry = cache_acquire(server, path, &info);
+	if(!entry){
+		serve_error(out, "cannot decode file");
+		return;
+	}
+
+	AsciiImageObject* image = entry->image;
+	int rows	= resample_size(image->height, scale);
+	int cols	= resample_size(image->width, scale);
+	wchar_t* ascii	= (wchar_t*) arena_alloc(arena, (size_t) rows * cols * sizeof(wchar_t));
+
+	if(ascii && asciify_resampled_into(image, scale, (Palette) palette, ascii, NULL, 1, server->variant, server->filter,
+					   server->pyramid)){
+		char status[32];
+		int length = snprintf(status, sizeof(status), "OK %d\n", rows);
+
+		output_write(out, status, (size_t) length);
+		output_glyph_rows(out, ascii, rows, cols);
+	}else{
+		serve_error(out, "out of memory");
+	}
+
+	arena_reset(arena);
+	cache_release(&server->cache, entry);
+}
+
+/*
+ * serve_connection answers every request of a client until it disconnects.
+ * - arena:    Arena of the worker serving the connection.
+ */
+static void serve_connection(Server* server, int client_fd, Arena* arena){
+	FILE* requests = fdopen(client_fd, "r");
+	OutputBuffer out;
+	char* line = NULL;
+	size_t line_capacity = 0;
+	ssize_t length;
+
+	if(!requests){
+		close(client_fd);
+		return;
+	}
+	if(!output_open(&out, client_fd, SERVER_OUTPUT_BUFFER_SIZE)){
+		fclose(requests);
+		return;
+	}
+
+	while(!out.failed && (length = getline(&line, &line_capacity, requests)) > 0){
+		if(line[length - 1] == '\n') line[--length] = '\0';
+		serve_render(server, line, &out, arena);
+		output_flush(&out);
+	}
+
+	free(line);
+	output_close(&out);
+	fclose(requests);
+}
+
+/*
+ * serve_worker accepts and serves connections forever; one worker per concurrent client.
+ */
+static void serve_worker(void* context, int worker){
+	Server* server = (Server*) context;
+	Arena arena;
+	(void) worker;
+
+	// Lives as long as the worker: requests of every connection reuse the same glyph memory
+	arena_init(&arena);
+	for(;;){
+		int client_fd = accept(server->listen_fd, NULL, NULL);
+		if(client_fd < 0){
+			if(errno == EINTR || errno == ECONNABORTED) continue;
+			perror("accept");
+			arena_release(&arena);
+			return;
+		}
+		serve_connection(server, client_fd, &arena);
+	}
+}
+
+/*
+ * socket_address fills a sockaddr_un with a filesystem path.
+ *
+ * Returns: false if the path does not fit.
+ */
+static bool socket_address(struct sockaddr_un* address, const char* socket_path){
+	memset(address, 0, sizeof(*address));
+	address->sun_family = AF_UNIX;
+	if(strlen(socket_path) >= sizeof(address->sun_path)){
+		fprintf(stderr, "%s: Socket path too long\n", socket_path);
+		return false;
+	}
+	strcpy(address->sun_path, socket_path);
+	return true;
+}
+
+/*
+ * serve runs the render daemon on a Unix domain socket; it only returns on setup failure.
+ * - socket_path:   Filesystem path of the listening socket. A stale socket file is replaced.
+ * - memory_limit:  Upper bound, in bytes, on the decoded images kept resident.
+ * - workers:       Number of connections served concurrently.
+ * - variant:       Scaler implementation used for every request.
+ * - filter:        Resampling filter used for every request.
+ * - pyramid:       Keep a 2x reduction pyramid of every image and resample from it.
+ *
+ * Decoded images stay resident in an LRU keyed by path, mtime, size and inode, so a
+ * repeated request only pays for scaling and glyph mapping. Memory is bounded by
+ * memory_limit for the resident images plus one in-flight render per worker.
+ *
+ * Returns: EXIT_FAILURE if the socket cannot be set up.
+ */
+int serve(const char* socket_path, size_t memory_limit, int workers, LanczosVariant variant, ResampleFilter filter, bool pyramid){
+	struct sockaddr_un address;
+	struct stat info;
+	Server server;
+
+	if(!socket_address(&address, socket_path)) return EXIT_FAILURE;
+
+	// A client closing early must not kill the daemon while a response is written
+	signal(SIGPIPE, SIG_IGN);
+
+	if(lstat(socket_path, &info) == 0 && S_ISSOCK(info.st_mode)) unlink(socket_path);
+
+	server.listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(server.listen_fd < 0 ||
+	   bind(server.listen_fd, (struct sockaddr*) &address, sizeof(address)) != 0 ||
+	   listen(server.listen_fd, SERVER_BACKLOG) != 0){
+		perror(socket_path);
+		if(server.listen_fd >= 0) close(server.listen_fd);
+		return EXIT_FAILURE;
+	}
+
+	server.variant		= variant;
+	server.filter		= filter;
+	server.pyramid		= pyramid;
+	server.cache.head	= NULL;
+	server.cache.tail	= NULL;
+	server.cache.bytes	= 0;
+	server.cache.limit	= memory_limit;
+	pthread_mutex_init(&server.cache.lock, NULL);
+
+	parallel_tasks(workers, workers, serve_worker, &server);
+
+	close(server.listen_fd);
+	pthread_mutex_destroy(&server.cache.lock);
+	return EXIT_FAILURE;
+}
+
+/*
+ * serve_request asks a running daemon for a render and copies the glyph rows to stdout.
+ * - socket_path:   Socket of the daemon.
+ * - input_path:    Image to render; relative paths are resolved against the current directory.
+ * - palette:       Palette to render with.
+ * - scale:         Downscale factor, may be fractional.
+ *
+ * Returns: EXIT_SUCCESS, or EXIT_FAILURE if the daemon cannot be reached or reports an error.
+ */
+int serve_request(const char* socket_path, const char* input_path, Palette palette, double scale){
+	struct sockaddr_un address;
+	char absolute_path[PATH_MAX];
+
+	if(!socket_address(&address, socket_path)) return EXIT_FAILURE;
+	if(!realpath(input_path, absolute_path)){
+		fprintf(stderr, "%s: Error while reading file\n", input_path);
+		return EXIT_FAILURE;
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0 || connect(fd, (struct sockaddr*) &address, sizeof(address)) != 0){
+		perror(socket_path);
+		if(fd >= 0) close(fd);
+		return EXIT_FAILURE;
+	}
+
+	FILE* stream = fdopen(fd, "r+");
+	if(!stream){
+		close(fd);
+		return EXIT_FAILURE;
+	}
+
+	fprintf(stream, "%d %.17g %s\n", (int) palette, scale, absolute_path);
+	fflush(stream);
+
+	char* line = NULL;
+	size_t line_capacity = 0;
+	ssize_t length = getline(&line, &line_capacity, stream);
+	int result = EXIT_FAILURE;
+
+	int rows, consumed = 0;
+
+	if(length > 0 && sscanf(line, "OK %d\n%n", &rows, &consumed) == 1 && consumed == length && rows >= 0){
+		while(rows > 0 && (length = getline(&line, &line_capacity, stream)) > 0 && line[length - 1] == '\n'){
+			fwrite(line, 1, (size_t) length, stdout);
+			rows--;
+		}
+		if(rows == 0) result = EXIT_SUCCESS;
+		else fprintf(stderr, "%s: Connection closed by the server\n", socket_path);
+	}else if(length > 0){
+		fprintf(stderr, "%s: %s", input_path, line);
+	}else{
+		fprintf(stderr, "%s: Connection closed by the server\n", socket_path);
+	}
+
+	free(line);
+	fclose(stream);
+	return result;
+}
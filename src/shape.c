@@ -0,0 +1,327 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wchar.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "shape.h"
+
+/*
+ * ShapeCoverage ink of a glyph over the sub-cells of a cell.
+ * -glyph:     Character.
+ * -quarters:  Ink of each sub-cell, row by row, from 0 (blank) to 4 (solid).
+ *
+ * Block elements and shades are exact. Text glyphs are measured by eye on a
+ * typical monospace font; only the relative ink of their sub-cells matters, since
+ * palette glyphs are scaled to the tone of their palette position.
+ */
+typedef struct ShapeCoverage{
+	wchar_t glyph;
+	uint8_t quarters[SHAPE_CELLS];
+} ShapeCoverage;
+
+static const ShapeCoverage shape_coverage[] = {
+	{ L' ', { 0, 0, 0, 0, 0, 0 } },
+	{ L'.', { 0, 0, 0, 0, 1, 1 } },
+	{ L',', { 0, 0, 0, 0, 2, 1 } },
+	{ L':', { 0, 0, 1, 1, 1, 1 } },
+	{ L';', { 0, 0, 1, 1, 2, 1 } },
+	{ L'-', { 0, 0, 2, 2, 0, 0 } },
+	{ L'=', { 0, 0, 2, 2, 2, 2 } },
+	{ L'+', { 1, 1, 3, 3, 1, 1 } },
+	{ L'*', { 2, 2, 2, 2, 0, 0 } },
+	{ L'#', { 2, 2, 3, 3, 2, 2 } },
+	{ L'%', { 3, 1, 2, 2, 1, 3 } },
+	{ L'@', { 2, 2, 4, 4, 3, 3 } },
+	{ L'?', { 2, 3, 1, 2, 1, 0 } },
+	{ L'0', { 3, 3, 2, 2, 3, 3 } },
+	{ L'S', { 3, 2, 3, 3, 2, 3 } },
+	{ L'░', { 1, 1, 1, 1, 1, 1 } },
+	{ L'▒', { 2, 2, 2, 2, 2, 2 } },
+	{ L'▓', { 3, 3, 3, 3, 3, 3 } },
+	{ L'█', { 4, 4, 4, 4, 4, 4 } },
+	{ L'▀', { 4, 4, 2, 2, 0, 0 } },
+	{ L'▄', { 0, 0, 2, 2, 4, 4 } },
+	{ L'▌', { 4, 0, 4, 0, 4, 0 } },
+	{ L'▐', { 0, 4, 0, 4, 0, 4 } },
+	{ L'▘', { 4, 0, 2, 0, 0, 0 } },
+	{ L'▝', { 0, 4, 0, 2, 0, 0 } },
+	{ L'▖', { 0, 0, 2, 0, 4, 0 } },
+	{ L'▗', { 0, 0, 0, 2, 0, 4 } },
+	{ L'▚', { 4, 0, 2, 2, 0, 4 } },
+	{ L'▞', { 0, 4, 2, 2, 4, 0 } },
+	{ L'▙', { 4, 0, 4, 2, 4, 4 } },
+	{ L'▛', { 4, 4, 4, 2, 4, 0 } },
+	{ L'▜', { 4, 4, 2, 4, 0, 4 } },
+	{ L'▟', { 0, 4, 2, 4, 4, 4 } },
+};
+
+/*
+ * Glyphs a palette may use in shape mode on top of its own: the block palette gets
+ * the half and quadrant blocks, the Braille palette every dot pattern.
+ */
+static const wchar_t* shape_extras[PALETTE_COUNT] = {
+	L"",
+	L"▀▄▌▐▘▝▖▗▚▞▙▛▜▟",
+	L"",
+	L"",
+};
+
+#define BRAILLE_BASE		0x2800
+#define BRAILLE_PATTERNS	256
+
+/*
+ * Mean absolute deviation, in 8-bit luminance, a cell of each contrast level is
+ * reconstructed with; the centres of the SHAPE_CONTRAST_* ranges.
+ */
+static const double shape_contrast_centre[4] = { 0, 20, 50, 100 };
+
+/*
+ * Bits of the left and right Braille dot of each of the four dot rows.
+ */
+static const uint8_t braille_left_bit[4]	= { 0, 1, 2, 6 };
+static const uint8_t braille_right_bit[4]	= { 3, 4, 5, 7 };
+
+/*
+ * braille_column_bits returns the pattern bits of one column of dots.
+ * -column:  0 for the left column, 1 for the right one.
+ * -dots:    Bit r set for a raised dot in row r.
+ */
+static unsigned braille_column_bits(int column, unsigned dots){
+	const uint8_t* bit = column ? braille_right_bit : braille_left_bit;
+	unsigned bits = 0;
+
+	for(int row = 0; row < 4; row++) bits |= (dots >> row & 1) << bit[row];
+	return bits;
+}
+
+/*
+ * glyph_coverage fills the sub-cell ink of a glyph, from 0 to 1.
+ * -glyph:     Character.
+ * -coverage:  Receives SHAPE_CELLS values.
+ *
+ * Braille patterns are split exactly: dot row r spans [r / 4, (r + 1) / 4) of the cell
+ * and sub-row s spans [s / 3, (s + 1) / 3), each sub-cell takes the overlapping part
+ * of every raised dot of its column.
+ *
+ * Returns: false if the coverage of the glyph is unknown.
+ */
+static bool glyph_coverage(wchar_t glyph, double coverage[SHAPE_CELLS]){
+	if(glyph >= BRAILLE_BASE && glyph < BRAILLE_BASE + BRAILLE_PATTERNS){
+		unsigned bits = (unsigned) (glyph - BRAILLE_BASE);
+
+		for(int k = 0; k < SHAPE_CELLS; k++) coverage[k] = 0;
+		for(int row = 0; row < 4; row++){
+			for(int sub = 0; sub < SHAPE_ROWS; sub++){
+				// overlap of [3 * row, 3 * row + 3) and [4 * sub, 4 * sub + 4) in twelfths
+				int low = 3 * row > 4 * sub ? 3 * row : 4 * sub;
+				int high = 3 * row + 3 < 4 * sub + 4 ? 3 * row + 3 : 4 * sub + 4;
+				if(high <= low) continue;
+
+				double share = (double) (high - low) / 4;
+				if(bits >> braille_left_bit[row] & 1) coverage[sub * SHAPE_COLS] += share;
+				if(bits >> braille_right_bit[row] & 1) coverage[sub * SHAPE_COLS + 1] += share;
+			}
+		}
+		return true;
+	}
+
+	for(size_t entry = 0; entry < sizeof(shape_coverage) / sizeof(shape_coverage[0]); entry++){
+		if(shape_coverage[entry].glyph != glyph) continue;
+		for(int k = 0; k < SHAPE_CELLS; k++) coverage[k] = shape_coverage[entry].quarters[k] / 4.0;
+		return true;
+	}
+	return false;
+}
+
+/*
+ * ShapeCandidate glyph considered by the table builder.
+ * -glyph:  Character.
+ * -luma:   Luminance of each sub-cell the glyph stands for, from 0 to 1.
+ */
+typedef struct ShapeCandidate{
+	wchar_t glyph;
+	double luma[SHAPE_CELLS];
+} ShapeCandidate;
+
+static ShapeMap shape_maps[PALETTE_COUNT];
+static atomic_bool shape_maps_built[PALETTE_COUNT];
+static pthread_mutex_t shape_maps_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * shape_candidates lists the glyphs of a palette with the luminance they stand for.
+ * -palette:     Palette enum value.
+ * -candidates:  Receives up to palette size + BRAILLE_PATTERNS entries.
+ *
+ * Glyph i of a palette of n keeps its tone i / (n - 1), spread over its sub-cells in
+ * proportion to their ink, so shape matching never changes the brightness a palette
+ * assigns to a glyph. Ink is bright when the palette gets denser towards its end and
+ * dark otherwise (the Braille palette). Extra glyphs stand for their ink alone.
+ *
+ * Returns: Number of candidates.
+ */
+static int shape_candidates(Palette palette, ShapeCandidate* candidates){
+	const wchar_t* glyphs = ascii_palettes[palette];
+	int size = (int) wcslen(glyphs), count = 0;
+	double first[SHAPE_CELLS], last[SHAPE_CELLS], first_ink = 0, last_ink = 0;
+
+	glyph_coverage(glyphs[0], first);
+	glyph_coverage(glyphs[size - 1], last);
+	for(int k = 0; k < SHAPE_CELLS; k++){
+		first_ink += first[k];
+		last_ink += last[k];
+	}
+	bool dark_ink = first_ink > last_ink;
+
+	for(int i = 0; i < size; i++){
+		double coverage[SHAPE_CELLS], ink = 0;
+		double tone = size > 1 ? (double) i / (size - 1) : 0;
+		double strength = dark_ink ? 1 - tone : tone;
+		ShapeCandidate* candidate = &candidates[count++];
+
+		if(!glyph_coverage(glyphs[i], coverage))
+			for(int k = 0; k < SHAPE_CELLS; k++) coverage[k] = 0;
+		for(int k = 0; k < SHAPE_CELLS; k++) ink += coverage[k] / SHAPE_CELLS;
+
+		candidate->glyph = glyphs[i];
+		for(int k = 0; k < SHAPE_CELLS; k++){
+			double amount = ink > 0 ? coverage[k] * strength / ink : strength;
+			amount = amount > 1 ? 1 : amount;
+			candidate->luma[k] = dark_ink ? 1 - amount : amount;
+		}
+	}
+
+	const wchar_t* extras = shape_extras[palette];
+	int extra_count = palette == BRAILLE ? BRAILLE_PATTERNS : (int) wcslen(extras);
+
+	for(int i = 0; i < extra_count; i++){
+		double coverage[SHAPE_CELLS];
+		ShapeCandidate* candidate = &candidates[count];
+
+		candidate->glyph = palette == BRAILLE ? (wchar_t) (BRAILLE_BASE + i) : extras[i];
+		if(!glyph_coverage(candidate->glyph, coverage)) continue;
+		for(int k = 0; k < SHAPE_CELLS; k++) candidate->luma[k] = dark_ink ? 1 - coverage[k] : coverage[k];
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * shape_map_build fills the shape table of a palette.
+ *
+ * Each index is turned back into a cell: every sub-cell at the quantized mean, those
+ * in the mask raised and the others lowered so that the mean is kept and the mean
+ * absolute deviation is the centre of the contrast level. The entry is the candidate
+ * with the least squared error against that cell; earlier candidates win ties, so the
+ * palette glyphs are preferred over the extras. Flat cells never reach the table, so
+ * contrast level 0 is left empty.
+ *
+ * The error of a Braille pattern is the sum of the errors of its two dot columns, so
+ * the best of the 256 patterns is the best left column next to the best right one.
+ */
+static void shape_map_build(Palette palette, ShapeMap* map){
+	static ShapeCandidate candidates[32 + BRAILLE_PATTERNS];
+	int count = shape_candidates(palette, candidates);
+	int palette_size = (int) wcslen(ascii_palettes[palette]);
+	int searched = palette == BRAILLE ? palette_size : count;
+
+	map->glyphs = glyph_map(palette);
+
+	for(int index = 1 << (SHAPE_CELLS + SHAPE_MEAN_BITS); index < SHAPE_INDEX_SIZE; index++){
+		int level = index & ((1 << SHAPE_MEAN_BITS) - 1);
+		int mask = (index >> SHAPE_MEAN_BITS) & ((1 << SHAPE_CELLS) - 1);
+		int contrast = index >> (SHAPE_CELLS + SHAPE_MEAN_BITS);
+		double mean = (level + 0.5) / (1 << SHAPE_MEAN_BITS);
+		double deviation = shape_contrast_centre[contrast] / 255 * SHAPE_CELLS / 2;
+		double cell[SHAPE_CELLS];
+		int raised = 0;
+
+		for(int k = 0; k < SHAPE_CELLS; k++) raised += mask >> k & 1;
+		for(int k = 0; k < SHAPE_CELLS; k++){
+			double value = mean;
+			if(raised > 0 && raised < SHAPE_CELLS)
+				value += (mask >> k & 1) ? deviation / raised : -deviation / (SHAPE_CELLS - raised);
+			cell[k] = value < 0 ? 0 : value > 1 ? 1 : value;
+		}
+
+		double best_error = SHAPE_CELLS + 1;
+		wchar_t best = candidates[0].glyph;
+		for(int c = 0; c < searched; c++){
+			double error = 0;
+			for(int k = 0; k < SHAPE_CELLS && error < best_error; k++){
+				double diff = candidates[c].luma[k] - cell[k];
+				error += diff * diff;
+			}
+			if(error < best_error){
+				best_error = error;
+				best = candidates[c].glyph;
+			}
+		}
+
+		if(palette == BRAILLE){
+			double pattern_error = 0;
+			unsigned pattern = 0;
+
+			for(int column = 0; column < SHAPE_COLS; column++){
+				double column_error = SHAPE_CELLS + 1;
+				unsigned column_bits = 0;
+
+				for(unsigned dots = 0; dots < 16; dots++){
+					unsigned bits = braille_column_bits(column, dots);
+					const double* luma = candidates[palette_size + bits].luma;
+					double error = 0;
+
+					for(int sub = 0; sub < SHAPE_ROWS; sub++){
+						double diff = luma[sub * SHAPE_COLS + column] - cell[sub * SHAPE_COLS + column];
+						error += diff * diff;
+					}
+					if(error < column_error){
+						column_error = error;
+						column_bits = bits;
+					}
+				}
+				pattern_error += column_error;
+				pattern |= column_bits;
+			}
+
+			if(pattern_error < best_error) best = (wchar_t) (BRAILLE_BASE + pattern);
+		}
+		map->shape_glyph[index] = best;
+	}
+}
+
+/*
+ * shape_map returns the shape table of a palette.
+ * -palette:  Palette enum value.
+ *
+ * The table of a palette is built once, on first use of that palette, and is safe to
+ * share between threads.
+ */
+const ShapeMap* shape_map(Palette palette){
+	if(!atomic_load(&shape_maps_built[palette])){
+		pthread_mutex_lock(&shape_maps_lock);
+		if(!atomic_load(&shape_maps_built[palette])){
+			shape_map_build(palette, &shape_maps[palette]);
+			atomic_store(&shape_maps_built[palette], true);
+		}
+		pthread_mutex_unlock(&shape_maps_lock);
+	}
+	return &shape_maps[palette];
+}
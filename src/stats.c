@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "stats.h"
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define STATS_HAVE_HEAP 1
+#else
+#define STATS_HAVE_HEAP 0
+#endif
+
+bool g_stats_enabled = false;
+
+static const char* stage_names[STATS_STAGE_COUNT] = { "header", "decode", "render", "output" };
+
+/*
+ * Per-stage accumulators, summed over every file and thread.
+ */
+static atomic_llong stage_ns[STATS_STAGE_COUNT];
+static atomic_llong stage_bytes[STATS_STAGE_COUNT];
+static atomic_llong stage_calls[STATS_STAGE_COUNT];
+
+/*
+ * stats_mark takes a snapshot of the clock and of the heap usage.
+ *
+ * Heap usage is the glibc arena plus mmap-ed blocks in use (mallinfo2); it is left
+ * at 0 on other C libraries and the byte columns then stay empty.
+ */
+StatsMark stats_mark(void){
+	struct timespec ts;
+	StatsMark mark;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	mark.ns = (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#if STATS_HAVE_HEAP
+	struct mallinfo2 info = mallinfo2();
+	mark.heap = (int64_t) (info.uordblks + info.hblkhd);
+#else
+	mark.heap = 0;
+#endif
+	return mark;
+}
+
+/*
+ * stats_record adds the time and heap growth since a mark to a stage.
+ * Safe to call from several threads at once.
+ */
+void stats_record(StatsStage stage, StatsMark mark){
+	StatsMark now = stats_mark();
+
+	atomic_fetch_add(&stage_ns[stage], (long long) (now.ns - mark.ns));
+	atomic_fetch_add(&stage_bytes[stage], (long long) (now.heap - mark.heap));
+	atomic_fetch_add(&stage_calls[stage], 1);
+}
+
+/*
+ * stats_report prints every stage, the total wall time and the peak RSS.
+ * - stream:  Destination, stderr in the CLI.
+ * - start:   Mark taken when the program started.
+ * - json:    Print a single JSON object instead of the text table.
+ *
+ * "heap" is the net heap growth of the stage: memory still held when it ended.
+ */
+void stats_report(FILE* stream, StatsMark start, bool json){
+	StatsMark end = stats_mark();
+	struct rusage usage;
+	long peak_kib = 0;
+
+	if(getrusage(RUSAGE_SELF, &usage) == 0) peak_kib = usage.ru_maxrss;	// kilobytes on Linux
+	double total_ms = (double) (end.ns - start.ns) / 1e6;
+
+	if(json){
+		fprintf(stream, "{\"stages\": {");
+		for(int stage = 0; stage < STATS_STAGE_COUNT; stage++){
+			fprintf(stream, "%s\"%s\": {\"ms\": %.3f, \"heap_bytes\": %lld, \"calls\": %lld}", stage ? ", " : "",
+				stage_names[stage], (double) atomic_load(&stage_ns[stage]) / 1e6,
+				(long long) atomic_load(&stage_bytes[stage]), (long long) atomic_load(&stage_calls[stage]));
+		}
+		fprintf(stream, "}, \"total_ms\": %.3f, \"peak_rss_kib\": %ld}\n", total_ms, peak_kib);
+		return;
+	}
+
+	fprintf(stream, "%-8s %10s %12s\n", "stage", "ms", "heap KiB");
+	for(int stage = 0; stage < STATS_STAGE_COUNT; stage++){
+		fprintf(stream, "%-8s %10.3f %12.1f\n", stage_names[stage], (double) atomic_load(&stage_ns[stage]) / 1e6,
+			(double) atomic_load(&stage_bytes[stage]) / 1024.0);
+	}
+	fprintf(stream, "%-8s %10.3f\npeak RSS %8.1f MiB\n", "total", total_ms, (double) peak_kib / 1024.0);
+}
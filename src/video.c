@@ -0,0 +1,388 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "video.h"
+#include "asciifier.h"
+
+/*
+ * Unchanged cells shorter than this between two changed runs are rewritten rather than
+ * skipped: a cursor move costs more bytes than a few glyphs.
+ */
+#define VIDEO_RUN_GAP 4
+
+/*
+ * Interval, in milliseconds, at which blocked threads check for SIGINT.
+ */
+#define VIDEO_POLL_MS 100
+
+static volatile sig_atomic_t video_interrupted = 0;
+
+/*
+ * video_on_interrupt SIGINT handler: asks both threads to stop.
+ */
+static void video_on_interrupt(int signal_number){
+	(void) signal_number;
+	video_interrupted = 1;
+}
+
+/*
+ * video_now returns a monotonic timestamp in nanoseconds.
+ */
+static uint64_t video_now(void){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+/*
+ * VideoFeed triple buffer between the reader thread and the renderer.
+ * - fd:           Frame source.
+ * - frame_bytes:  Size of one frame.
+ * - slots:        VIDEO_SLOTS frame buffers.
+ * - reading:      Slot the reader is filling; owned by the reader.
+ * - ready:        Slot holding the latest complete frame, valid when has_ready is set.
+ * - shown:        Slot the renderer is drawing; owned by the renderer.
+ * - has_ready:    A complete frame is waiting in ready.
+ * - ready_time:   When that frame was complete.
+ * - received:     Complete frames read.
+ * - dropped:      Complete frames replaced by a newer one before being rendered.
+ * - finished:     The reader stopped (end of stream, error or interrupt).
+ * - failed:       The reader stopped on a read error or a truncated frame.
+ * - lock, available: Protect and signal every field above that is not owned by one side.
+ *
+ * The reader always has a free slot to fill, so it never waits for the renderer; a
+ * slow terminal only makes the renderer skip to the most recent frame.
+ */
+typedef struct VideoFeed{
+	int fd;
+	size_t frame_bytes;
+	Pixel* slots[VIDEO_SLOTS];
+	int reading, ready, shown;
+	bool has_ready;
+	uint64_t ready_time;
+	long received, dropped;
+	bool finished, failed;
+	pthread_mutex_t lock;
+	pthread_cond_t available;
+} VideoFeed;
+
+/*
+ * video_read_frame reads exactly one frame, waking up regularly to check for SIGINT.
+ *
+ * Returns: 1 for a complete frame, 0 at the end of the stream (or on interrupt) before
+ *          any byte of the frame, -1 on a read error or a frame cut short.
+ */
+static int video_read_frame(int fd, unsigned char* frame, size_t frame_bytes){
+	size_t filled = 0;
+
+	while(filled < frame_bytes){
+		struct pollfd source = { fd, POLLIN, 0 };
+
+		if(video_interrupted) return 0;
+		int ready = poll(&source, 1, VIDEO_POLL_MS);
+		if(ready < 0 && errno != EINTR) return -1;
+		if(ready <= 0) continue;
+
+		ssize_t count = read(fd, frame + filled, frame_bytes - filled);
+		if(count < 0){
+			if(errno == EINTR || errno == EAGAIN) continue;
+			return -1;
+		}
+		if(count == 0) return filled == 0 ? 0 : -1;
+		filled += (size_t) count;
+	}
+	return 1;
+}
+
+/*
+ * video_reader thread body: reads frames and publishes each one as the latest.
+ */
+static void* video_reader(void* context){
+	VideoFeed* feed = (VideoFeed*) context;
+	int result;
+
+	while((result = video_read_frame(feed->fd, (unsigned char*) feed->slots[feed->reading], feed->frame_bytes)) > 0){
+		uint64_t now = video_now();
+
+		pthread_mutex_lock(&feed->lock);
+		int slot = feed->ready;
+		feed->ready = feed->reading;
+		feed->reading = slot;
+		if(feed->has_ready) feed->dropped++;
+		feed->has_ready = true;
+		feed->ready_time = now;
+		feed->received++;
+		pthread_cond_signal(&feed->available);
+		pthread_mutex_unlock(&feed->lock);
+	}
+
+	pthread_mutex_lock(&feed->lock);
+	feed->finished = true;
+	feed->failed = result < 0;
+	pthread_cond_signal(&feed->available);
+	pthread_mutex_unlock(&feed->lock);
+	return NULL;
+}
+
+/*
+ * video_next_frame waits for a frame newer than the one shown and swaps it in.
+ * - arrival:  Set to the time the frame was complete.
+ *
+ * Returns: false once the reader finished and every frame was shown, or on interrupt.
+ */
+static bool video_next_frame(VideoFeed* feed, uint64_t* arrival){
+	pthread_mutex_lock(&feed->lock);
+	while(!feed->has_ready && !feed->finished && !video_interrupted){
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += VIDEO_POLL_MS * 1000000L;
+		if(deadline.tv_nsec >= 1000000000L){
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+		pthread_cond_timedwait(&feed->available, &feed->lock, &deadline);
+	}
+
+	bool available = feed->has_ready && !video_interrupted;
+	if(available){
+		int slot = feed->shown;
+		feed->shown = feed->ready;
+		feed->ready = slot;
+		feed->has_ready = false;
+		*arrival = feed->ready_time;
+	}
+	pthread_mutex_unlock(&feed->lock);
+	return available;
+}
+
+/*
+ * VideoGrid glyphs and colours of one rendered frame.
+ */
+typedef struct VideoGrid{
+	wchar_t* glyphs;
+	Pixel* colors;
+} VideoGrid;
+
+/*
+ * video_cell_changed compares a cell of two frames, colours compared as they are printed.
+ */
+static inline bool video_cell_changed(const VideoGrid* now, const VideoGrid* before, size_t cell, ColorMode color){
+	if(now->glyphs[cell] != before->glyphs[cell]) return true;
+	if(color == COLOR_NONE) return false;
+
+	Pixel a = now->colors[cell], b = before->colors[cell];
+	if(color == COLOR_256) return ansi256_index(a) != ansi256_index(b);
+	return a.red != b.red || a.green != b.green || a.blue != b.blue;
+}
+
+/*
+ * video_paint writes the cells of a frame that differ from the previous one.
+ * - out:     Terminal output.
+ * - now:     Frame to show.
+ * - before:  Frame currently on screen, or NULL to paint everything.
+ * - rows, cols: Grid size.
+ * - color:   Colour output mode.
+ *
+ * Changed cells are grouped in runs along each row; runs separated by fewer than
+ * VIDEO_RUN_GAP unchanged cells are merged. Each run costs one cursor move.
+ */
+static void video_paint(OutputBuffer* out, const VideoGrid* now, const VideoGrid* before, int rows, int cols, ColorMode color){
+	uint32_t current = UINT32_MAX;
+
+	for(int row = 0; row < rows; row++){
+		size_t base = (size_t) row * cols;
+		int col = 0;
+
+		while(col < cols){
+			if(before && !video_cell_changed(now, before, base + col, color)){
+				col++;
+				continue;
+			}
+
+			int start = col, end = col + 1;
+			while(end < cols){
+				int gap = 0;
+				while(before && end + gap < cols && gap < VIDEO_RUN_GAP && !video_cell_changed(now, before, base + end + gap, color)) gap++;
+				if(gap == VIDEO_RUN_GAP || end + gap == cols) break;
+				end += gap + 1;
+			}
+
+			char move[32];
+			int length = snprintf(move, sizeof(move), "\x1b[%d;%dH", row + 1, start + 1);
+			output_write(out, move, (size_t) length);
+			output_cells(out, now->glyphs + base + start, color == COLOR_NONE ? NULL : now->colors + base + start,
+				     end - start, color, &current);
+			col = end;
+		}
+	}
+
+	if(current != UINT32_MAX) output_write(out, "\x1b[0m", 4);
+}
+
+/*
+ * video_play renders a stream of raw RGBA frames from a file descriptor as live terminal video.
+ * - fd:             Source of width * height * 4 byte frames, RGBA, rows top to bottom
+ *                   (e.g. ffmpeg -f rawvideo -pix_fmt rgba).
+ * - width, height:  Frame size in pixels.
+ * - scale:          Downscale factor, at least 1; may be fractional.
+ * - palette:        Palette every frame is rendered with.
+ * - color:          Colour output mode, COLOR_NONE for glyphs only.
+ * - threads:        Number of worker threads used to scale each frame.
+ * - variant:        Scaler implementation.
+ * - filter:         Resampling filter.
+ *
+ * Every buffer (frame slots, glyph and colour grids, output) is allocated once and
+ * reused for the whole stream. The latency of a frame is the time from its last byte
+ * being read to its update being written to the terminal.
+ *
+ * Returns: EXIT_SUCCESS, or EXIT_FAILURE on a read error, a truncated frame or allocation failure.
+ */
+int video_play(int fd, int width, int height, double scale, Palette palette, ColorMode color, int threads,
+	       LanczosVariant variant, ResampleFilter filter){
+	int rows = resample_size(height, scale), cols = resample_size(width, scale);
+	size_t cells = (size_t) rows * cols;
+	VideoFeed feed;
+	VideoGrid grids[2];
+	OutputBuffer out;
+	long latency_buckets[VIDEO_LATENCY_BUCKETS + 1] = { 0 };
+	bool success = true;
+
+	if(rows <= 0 || cols <= 0){
+		fprintf(stderr, "Frames of %dx%d are empty at scale %g\n", width, height, scale);
+		return EXIT_FAILURE;
+	}
+
+	memset(&feed, 0, sizeof(feed));
+	feed.fd		 = fd;
+	feed.frame_bytes = (size_t) width * height * sizeof(Pixel);
+	feed.reading	 = 0;
+	feed.ready	 = 1;
+	feed.shown	 = 2;
+	for(int slot = 0; slot < VIDEO_SLOTS; slot++) feed.slots[slot] = (Pixel*) malloc(feed.frame_bytes);
+	for(int grid = 0; grid < 2; grid++){
+		grids[grid].glyphs = (wchar_t*) malloc(cells * sizeof(wchar_t));
+		grids[grid].colors = (Pixel*) malloc(cells * sizeof(Pixel));
+	}
+
+	bool allocated = output_open(&out, STDOUT_FILENO, OUTPUT_BUFFER_SIZE);
+	for(int slot = 0; slot < VIDEO_SLOTS; slot++) allocated = allocated && feed.slots[slot];
+	for(int grid = 0; grid < 2; grid++) allocated = allocated && grids[grid].glyphs && grids[grid].colors;
+
+	struct sigaction action, previous;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = video_on_interrupt;
+	sigemptyset(&action.sa_mask);
+	video_interrupted = 0;
+
+	pthread_t reader;
+	bool started = false;
+	if(allocated){
+		pthread_mutex_init(&feed.lock, NULL);
+		pthread_cond_init(&feed.available, NULL);
+		sigaction(SIGINT, &action, &previous);
+		started = pthread_create(&reader, NULL, video_reader, &feed) == 0;
+	}
+
+	long shown = 0;
+	uint64_t first_shown = 0, last_shown = 0, latency_total = 0, latency_max = 0, arrival;
+	int current = 0;
+
+	if(started){
+		output_write(&out, "\x1b[?25l\x1b[2J", 10);
+
+		while(video_next_frame(&feed, &arrival)){
+			AsciiImageObject image;
+			memset(&image, 0, sizeof(image));
+			image.width		= width;
+			image.height		= height;
+			image.scale		= 1;
+			image.original_image	= feed.slots[feed.shown];
+
+			if(!asciify_resampled_into(&image, scale, palette, grids[current].glyphs,
+						   color == COLOR_NONE ? NULL : grids[current].colors, threads, variant, filter, false)){
+				success = false;
+				break;
+			}
+
+			video_paint(&out, &grids[current], shown ? &grids[1 - current] : NULL, rows, cols, color);
+			if(!output_flush(&out)){
+				success = false;
+				break;
+			}
+			current = 1 - current;
+
+			last_shown = video_now();
+			if(shown++ == 0) first_shown = last_shown;
+			uint64_t latency = last_shown - arrival;
+			latency_total += latency;
+			if(latency > latency_max) latency_max = latency;
+			uint64_t bucket = latency / 1000000u;
+			latency_buckets[bucket < VIDEO_LATENCY_BUCKETS ? bucket : VIDEO_LATENCY_BUCKETS]++;
+		}
+
+		video_interrupted = 1;	// stops the reader if the renderer gave up first
+		pthread_join(reader, NULL);
+
+		char restore[32];
+		int length = snprintf(restore, sizeof(restore), "\x1b[%d;1H\x1b[?25h", rows + 1);
+		output_write(&out, restore, (size_t) length);
+		output_flush(&out);
+
+		if(feed.failed){
+			fprintf(stderr, "Error while reading frames of %dx%d RGBA\n", width, height);
+			success = false;
+		}
+
+		if(shown){
+			long p95 = 0, seen = 0;
+			while(p95 < VIDEO_LATENCY_BUCKETS && (seen += latency_buckets[p95]) * 100 < shown * 95) p95++;
+			double seconds = (double) (last_shown - first_shown) / 1e9;
+
+			fprintf(stderr, "%ld frames shown, %ld dropped, %.1f fps, latency mean %.1f ms, p95 < %ld ms, max %.1f ms\n",
+				shown, feed.dropped, shown > 1 && seconds > 0 ? (double) (shown - 1) / seconds : 0.0,
+				(double) latency_total / (double) shown / 1e6, p95 + 1, (double) latency_max / 1e6);
+		}
+		sigaction(SIGINT, &previous, NULL);
+	}else{
+		fprintf(stderr, "Out of memory\n");
+		success = false;
+		if(allocated) sigaction(SIGINT, &previous, NULL);
+	}
+
+	if(allocated){
+		pthread_mutex_destroy(&feed.lock);
+		pthread_cond_destroy(&feed.available);
+	}
+	output_close(&out);
+	for(int slot = 0; slot < VIDEO_SLOTS; slot++) free(feed.slots[slot]);
+	for(int grid = 0; grid < 2; grid++){
+		free(grids[grid].glyphs);
+		free(grids[grid].colors);
+	}
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2025  Oliver Quin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <png.h>
+#include "yascii.h"
+#include "asciifier.h"
+#include "decoder.h"
+#include "output.h"
+
+/*
+ * YasciiContext scratch state reused across renders.
+ * - image:            Source image handed to the scaler; original_image points either
+ *                     to pixels (owned) or to the caller's RGBA buffer.
+ * - pixels:           Decoded PNG pixels, pixel_capacity Pixels long.
+ * - glyphs:           Glyph frame, glyph_capacity wchar_t long.
+ * - png, png_size, png_offset: In-memory PNG being decoded.
+ */
+struct YasciiContext{
+	AsciiImageObject image;
+	Pixel* pixels;
+	size_t pixel_capacity;
+	wchar_t* glyphs;
+	size_t glyph_capacity;
+	const unsigned char* png;
+	size_t png_size, png_offset;
+};
+
+static const char* status_strings[] = {
+	"success",
+	"invalid argument",
+	"not a PNG file",
+	"corrupt or truncated PNG",
+	"out of memory",
+	"output buffer too small"
+};
+
+/*
+ * yascii_context_create allocates an empty rendering context.
+ *
+ * Returns: The context, or NULL on memory allocation failure.
+ */
+YasciiContext* yascii_context_create(void){
+	return (YasciiContext*) calloc(1, sizeof(YasciiContext));
+}
+
+/*
+ * yascii_context_destroy releases a context and its scratch buffers; NULL is accepted.
+ */
+void yascii_context_destroy(YasciiContext* context){
+	if(!context) return;
+	free(context->pixels);
+	free(context->glyphs);
+	free(context);
+}
+
+/*
+ * yascii_output_bound returns an upper bound of the output size of a render.
+ */
+size_t yascii_output_bound(int width, int height, int scale_factor){
+	if(width <= 0 || height <= 0 || scale_factor < 1) return 0;
+	return (size_t) (height / scale_factor) * ((size_t) (width / scale_factor) * UTF8_MAX_BYTES + 1);
+}
+
+/*
+ * yascii_status_string returns a static, human readable description of a status code.
+ */
+const char* yascii_status_string(YasciiStatus status){
+	if(status < YASCII_OK || status > YASCII_ERROR_BUFFER_TOO_SMALL) return "unknown status";
+	return status_strings[status];
+}
+
+/*
+ * grow_buffer makes sure a scratch buffer holds at least count elements.
+ * - buffer:        Current buffer, NULL when none was allocated yet.
+ * - capacity:      Elements buffer holds; updated when it grows.
+ *
+ * The buffer is returned rather than written through a void** so the caller's typed
+ * pointer is never accessed as another pointer type.
+ *
+ * Returns: The buffer, moved if it had to grow, or NULL on memory allocation failure;
+ *          the old buffer is then kept.
+ */
+static void* grow_buffer(void* buffer, size_t* capacity, size_t count, size_t element_size){
+	if(buffer && count <= *capacity) return buffer;
+
+	void* grown = realloc(buffer, (count ? count : 1) * element_size);
+	if(!grown) return NULL;
+
+	*capacity = count ? count : 1;
+	return grown;
+}
+
+/*
+ * render_glyphs runs the fused scale and glyph pass on context->image and encodes the frame.
+ */
+static YasciiStatus render_glyphs(YasciiContext* context, const YasciiOptions* options, char* output, size_t capacity, size_t* length){
+	int rows	= context->image.height / options->scale_factor;
+	int width	= context->image.width / options->scale_factor;
+	size_t cells	= (size_t) rows * width;
+
+	*length = 0;
+	if(cells == 0) return YASCII_OK;
+
+	wchar_t* frame = (wchar_t*) grow_buffer(context->glyphs, &context->glyph_capacity, cells, sizeof(wchar_t));
+	if(!frame) return YASCII_ERROR_MEMORY;
+	context->glyphs = frame;
+
+	if(!asciify_scaled_into(&context->image, options->scale_factor, options->palette, context->glyphs,
+				options->threads, options->variant)) return YASCII_ERROR_MEMORY;
+
+	// Encode while it fits, keep counting past the end to report the required size
+	wchar_t last_glyph = 0;
+	char encoded[UTF8_MAX_BYTES];
+	size_t encoded_length = utf8_encode(last_glyph, encoded);
+	size_t used = 0;
+
+	for(int row = 0; row < rows; row++){
+		const wchar_t* glyphs = context->glyphs + (size_t) row * width;
+
+		for(int col = 0; col < width; col++){
+			if(glyphs[col] != last_glyph){
+				last_glyph = glyphs[col];
+				encoded_length = utf8_encode(last_glyph, encoded);
+			}
+			if(used + encoded_length <= capacity) memcpy(output + used, encoded, encoded_length);
+			used += encoded_length;
+		}
+		if(used < capacity) output[used] = '\n';
+		used++;
+	}
+
+	*length = used;
+	return used <= capacity ? YASCII_OK : YASCII_ERROR_BUFFER_TOO_SMALL;
+}
+
+/*
+ * options_valid checks the arguments shared by every render call.
+ */
+static bool options_valid(const YasciiContext* context, const YasciiOptions* options, const char* output, size_t capacity, const size_t* length){
+	return context && options && length && (output || capacity == 0) &&
+	       options->palette >= 0 && options->palette < PALETTE_COUNT &&
+	       options->scale_factor >= 1 &&
+	       options->variant >= LANCZOS_AUTO && options->variant < LANCZOS_VARIANT_COUNT;
+}
+
+/*
+ * yascii_render_rgba renders raw 8-bit RGBA pixels.
+ *
+ * The caller's pixels are scaled in place of original_image: nothing is copied.
+ *
+ * Returns: YASCII_OK or an error code.
+ */
+YasciiStatus yascii_render_rgba(YasciiContext* context, const Pixel* pixels, int width, int height, const YasciiOptions* options,
+	char* output, size_t capacity, size_t* length){
+	if(!options_valid(context, options, output, capacity, length) || !pixels || width <= 0 || height <= 0) return YASCII_ERROR_ARGUMENT;
+
+	context->image.width		= width;
+	context->image.height		= height;
+	context->image.scale		= 1;
+	context->image.original_image	= (Pixel*) pixels;	// only read by the scaler
+
+	return render_glyphs(context, options, output, capacity, length);
+}
+
+/*
+ * png_memory_read libpng read callback serving the in-memory PNG of the context.
+ */
+static void png_memory_read(png_structp png_ptr, png_bytep data, png_size_t size){
+	YasciiContext* context = (YasciiContext*) png_get_io_ptr(png_ptr);
+
+	if(size > context->png_size - context->png_offset) png_error(png_ptr, "unexpected end of data");
+	memcpy(data, context->png + context->png_offset, size);
+	context->png_offset += size;
+}
+
+/*
+ * png_silent_error libpng error callback: unwinds to the setjmp of the render call without printing.
+ */
+static void png_silent_error(png_structp png_ptr, png_const_charp message){
+	(void) message;
+	png_longjmp(png_ptr, 1);
+}
+
+/*
+ * png_silent_warning libpng warning callback: libraries do not write to stderr.
+ */
+static void png_silent_warning(png_structp png_ptr, png_const_charp message){
+	(void) png_ptr;
+	(void) message;
+}
+
+/*
+ * yascii_render_png renders a PNG held in memory.
+ *
+ * libpng read structs cannot be rewound to a new stream, so a fresh pair is created per
+ * call; the decoded pixels go into the context's reusable buffer, straight from libpng.
+ *
+ * Returns: YASCII_OK or an error code.
+ */
+YasciiStatus yascii_render_png(YasciiContext* context, const void* png, size_t size, const YasciiOptions* options,
+	char* output, size_t capacity, size_t* length){
+	if(!options_valid(context, options, output, capacity, length) || !png) return YASCII_ERROR_ARGUMENT;
+	if(size < PNG_HEADER_SIZE || png_sig_cmp((png_const_bytep) png, 0, PNG_HEADER_SIZE)) return YASCII_ERROR_NOT_PNG;
+
+	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, png_silent_error, png_silent_warning);
+	png_infop info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+	if(!png_ptr || !info_ptr){
+		if(png_ptr) png_destroy_read_struct(&png_ptr, NULL, NULL);
+		return YASCII_ERROR_MEMORY;
+	}
+
+	if(setjmp(png_jmpbuf(png_ptr))){
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		return YASCII_ERROR_DECODE;
+	}
+
+	context->png		= (const unsigned char*) png;
+	context->png_size	= size;
+	context->png_offset	= PNG_HEADER_SIZE;
+	png_set_read_fn(png_ptr, context, png_memory_read);
+	png_set_sig_bytes(png_ptr, PNG_HEADER_SIZE);
+	png_read_info(png_ptr, info_ptr);
+
+	int width	= (int) png_get_image_width(png_ptr, info_ptr);
+	int height	= (int) png_get_image_height(png_ptr, info_ptr);
+
+	Pixel* pixels = (Pixel*) grow_buffer(context->pixels, &context->pixel_capacity, (size_t) width * height, sizeof(Pixel));
+	if(!pixels){
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		return YASCII_ERROR_MEMORY;
+	}
+	context->pixels = pixels;
+
+	context->image.width		= width;
+	context->image.height		= height;
+	context->image.scale		= 1;
+	context->image.original_image	= context->pixels;
+	image_struct_init(&context->image, png_ptr, info_ptr);
+
+	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+	context->png = NULL;
+
+	return render_glyphs(context, options, output, capacity, length);
+}